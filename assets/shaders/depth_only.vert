@@ -0,0 +1,32 @@
+#version 460
+
+layout (location = 0) in vec3 vPosition;
+
+layout(set = 0, binding = 0) uniform  CameraBuffer{
+    mat4 view;
+    mat4 proj;
+	mat4 viewproj;
+} cameraData;
+
+struct ObjectData{
+	mat4 model;
+	vec4 sphereBounds;
+	uvec4 drawInfo;
+};
+
+//all object matrices
+layout(std140,set = 1, binding = 0) readonly buffer ObjectBuffer{
+
+	ObjectData objects[];
+} objectBuffer;
+
+//the shaded pass tests for equal depth, both shaders have to produce the
+//exact same position
+invariant gl_Position;
+
+void main()
+{
+	mat4 modelMatrix = objectBuffer.objects[gl_BaseInstance].model;
+	mat4 transformMatrix = (cameraData.viewproj * modelMatrix);
+	gl_Position = transformMatrix * vec4(vPosition, 1.0f);
+}
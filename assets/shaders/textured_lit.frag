@@ -3,6 +3,9 @@
 //shader input
 layout (location = 0) in vec3 inColor;
 layout (location = 1) in vec2 texCoord;
+layout (location = 2) in vec3 inWorldPos;
+layout (location = 3) in vec3 inNormal;
+layout (location = 4) in float inViewDepth;
 
 //output write
 layout (location = 0) out vec4 outFragColor;
@@ -13,12 +16,65 @@ layout(set = 0, binding = 1) uniform  SceneData{
 	vec4 ambientColor;
 	vec4 sunlightDirection; //w for sun power
 	vec4 sunlightColor;
+	vec4 clusterScale; //xy clusters per pixel, z depth slice scale, w bias
 } sceneData;
 
+//must match vk_clusteredLighting.h
+const uint CLUSTER_X = 16;
+const uint CLUSTER_Y = 9;
+const uint CLUSTER_Z = 24;
+const uint CLUSTER_STRIDE = 256;
+
+struct Light {
+	vec4 positionRadius; //w is the range
+	vec4 colorIntensity;
+	vec4 directionCone; //w is the cosine of the spot cone, -1 for point lights
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer LightBuffer {
+	Light lights[];
+} lightBuffer;
+
+layout(std430, set = 0, binding = 3) readonly buffer ClusterBuffer {
+	uint data[];
+} clusterBuffer;
+
+//sum of the lights of the fragment's cluster
+vec3 cluster_lighting(vec3 worldPos, vec3 normal, float viewDepth)
+{
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * sceneData.clusterScale.xy), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+	float slice = log(max(viewDepth, 1e-4f)) * sceneData.clusterScale.z + sceneData.clusterScale.w;
+	uint z = uint(clamp(slice, 0.0f, float(CLUSTER_Z - 1)));
+
+	uint base = (tile.x + tile.y * CLUSTER_X + z * CLUSTER_X * CLUSTER_Y) * CLUSTER_STRIDE;
+	uint count = clusterBuffer.data[base];
+
+	vec3 n = normalize(normal);
+	vec3 result = vec3(0.0f);
+	for (uint i = 0; i < count; i++) {
+		Light light = lightBuffer.lights[clusterBuffer.data[base + 1 + i]];
+
+		vec3 toLight = light.positionRadius.xyz - worldPos;
+		float dist = length(toLight);
+		vec3 l = toLight / max(dist, 1e-4f);
+
+		//inverse square, windowed to reach zero at the range
+		float window = clamp(1.0f - pow(dist / light.positionRadius.w, 4.0f), 0.0f, 1.0f);
+		float attenuation = window * window / (dist * dist + 1.0f);
+
+		float cone = light.directionCone.w;
+		float spot = smoothstep(cone, min(cone + 0.05f, 1.0f), dot(-l, light.directionCone.xyz));
+
+		result += light.colorIntensity.rgb * light.colorIntensity.w * attenuation * spot * max(dot(n, l), 0.0f);
+	}
+	return result;
+}
+
 layout(set = 2, binding = 0) uniform sampler2D tex1;
 
 void main() 
 {
 	vec3 color = texture(tex1,texCoord).xyz;
-	outFragColor = vec4(color,1.0f);
+	vec3 lighting = cluster_lighting(inWorldPos, inNormal, inViewDepth);
+	outFragColor = vec4(color + color * lighting,1.0f);
 }
\ No newline at end of file
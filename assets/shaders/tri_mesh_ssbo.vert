@@ -7,6 +7,10 @@ layout (location = 3) in vec2 vTexCoord;
 
 layout (location = 0) out vec3 outColor;
 layout (location = 1) out vec2 texCoord;
+layout (location = 2) out vec3 outWorldPos;
+layout (location = 3) out vec3 outNormal;
+//positive distance in front of the camera, selects the cluster depth slice
+layout (location = 4) out float outViewDepth;
 
 layout(set = 0, binding = 0) uniform  CameraBuffer{   
     mat4 view;
@@ -16,6 +20,8 @@ layout(set = 0, binding = 0) uniform  CameraBuffer{
 
 struct ObjectData{
 	mat4 model;
+	vec4 sphereBounds;
+	uvec4 drawInfo;
 }; 
 
 //all object matrices
@@ -31,6 +37,9 @@ layout( push_constant ) uniform constants
  mat4 render_matrix;
 } PushConstants;
 
+//must match depth_only.vert for the depth prepass
+invariant gl_Position;
+
 void main() 
 {	
 	mat4 modelMatrix = objectBuffer.objects[gl_BaseInstance].model;
@@ -38,4 +47,10 @@ void main()
 	gl_Position = transformMatrix * vec4(vPosition, 1.0f);
 	outColor = vColor;
 	texCoord = vTexCoord;
+
+	vec4 worldPos = modelMatrix * vec4(vPosition, 1.0f);
+	outWorldPos = worldPos.xyz;
+	//transforms only scale uniformly
+	outNormal = mat3(modelMatrix) * vNormal;
+	outViewDepth = -(cameraData.view * worldPos).z;
 }
@@ -0,0 +1,64 @@
+#ifndef E7C3B1D9_2A64_4F8E_8D15_5B9F0C4A7E23
+#define E7C3B1D9_2A64_4F8E_8D15_5B9F0C4A7E23
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+
+// Picks the render scale from measured GPU frame time. GPU cost is assumed to
+// be proportional to the pixel count, so the scale moves by the square root of
+// the budget ratio. The measured time is smoothed and the step damped to keep
+// the scale from oscillating, and small errors inside the dead band are
+// ignored.
+class DynamicResolution {
+ public:
+  void init(float targetFrameMs, float minScale, float maxScale = 1.0f) {
+    assert(targetFrameMs > 0.0f);
+    assert(minScale > 0.0f && minScale <= maxScale);
+    _targetMs = targetFrameMs;
+    _minScale = minScale;
+    _maxScale = maxScale;
+    _scale = maxScale;
+    _smoothedMs = 0.0f;
+  }
+
+  // Feeds the GPU time of a finished frame and returns the new scale
+  float update(float gpuMs) {
+    _lastMs = gpuMs;
+    _smoothedMs = _smoothedMs == 0.0f
+                      ? gpuMs
+                      : _smoothedMs + SMOOTHING * (gpuMs - _smoothedMs);
+
+    const float ratio = _targetMs / std::max(_smoothedMs, 0.01f);
+    if (std::abs(ratio - 1.0f) < DEAD_BAND) return _scale;
+
+    const float ideal = _scale * std::sqrt(ratio);
+    _scale = std::clamp(_scale + GAIN * (ideal - _scale), _minScale, _maxScale);
+
+    return _scale;
+  }
+
+  float scale(void) const { return _scale; }
+  float target_ms(void) const { return _targetMs; }
+  float last_ms(void) const { return _lastMs; }
+  float smoothed_ms(void) const { return _smoothedMs; }
+
+ private:
+  // Weight of the newest sample in the moving average
+  static constexpr float SMOOTHING = 0.1f;
+  // Fraction of the distance to the ideal scale covered each frame
+  static constexpr float GAIN = 0.25f;
+  // Relative error that is tolerated without a change
+  static constexpr float DEAD_BAND = 0.05f;
+
+  float _targetMs{16.6f};
+  float _minScale{0.5f};
+  float _maxScale{1.0f};
+
+  float _scale{1.0f};
+  float _lastMs{0.0f};
+  float _smoothedMs{0.0f};
+};
+
+#endif /* E7C3B1D9_2A64_4F8E_8D15_5B9F0C4A7E23 */
@@ -0,0 +1,242 @@
+#ifndef C38E5A21_D74F_4B19_9A6E_0F2B7D4C1E85
+#define C38E5A21_D74F_4B19_9A6E_0F2B7D4C1E85
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-frame timing over a rolling window of frames. CPU time is the work of a
+// frame without the time spent blocked on its fence, GPU time comes from the
+// profiler and the present interval is the time between two presents (or two
+// submits when headless). Percentiles are read from fixed-width histograms
+// that are kept up to date as frames enter and leave the window, so reporting
+// never sorts.
+class FrameStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Metrics that are unknown for a frame are stored as this value
+  static constexpr float NO_SAMPLE = -1.0f;
+
+  enum Metric { CPU = 0, GPU, PRESENT, METRIC_COUNT };
+
+  struct Summary {
+    uint32_t frames{0};
+    float minMs{0.0f};
+    float avgMs{0.0f};
+    float p50Ms{0.0f};
+    float p95Ms{0.0f};
+    float p99Ms{0.0f};
+    float maxMs{0.0f};
+    uint32_t overBudget{0};
+  };
+
+  void init(float budgetMs, uint32_t windowSize = 1024) {
+    assert(budgetMs > 0.0f);
+    assert(windowSize > 0);
+    _budgetMs = budgetMs;
+    _records.assign(windowSize, FrameRecord{});
+    _next = 0;
+    _count = 0;
+    _frame = 0;
+    for (auto& histogram : _histograms) histogram.assign(BUCKET_COUNT, 0);
+    for (auto& total : _overBudgetTotal) total = 0;
+  }
+
+  void frame_begin(void) {
+    _frameStart = Clock::now();
+    _waitMs = 0.0f;
+  }
+
+  // Time between wait_begin and wait_end is not counted as CPU work
+  void wait_begin(void) { _waitStart = Clock::now(); }
+
+  void wait_end(void) { _waitMs += elapsed_ms(_waitStart, Clock::now()); }
+
+  void presented(void) {
+    const Clock::time_point now = Clock::now();
+    _presentMs = _hasPresented ? elapsed_ms(_lastPresent, now) : NO_SAMPLE;
+    _lastPresent = now;
+    _hasPresented = true;
+  }
+
+  // Pass NO_SAMPLE when the GPU time of the frame isn't known
+  void frame_end(float gpuMs) {
+    FrameRecord record;
+    record.frame = _frame++;
+    record.ms[CPU] =
+        std::max(elapsed_ms(_frameStart, Clock::now()) - _waitMs, 0.0f);
+    record.ms[GPU] = gpuMs;
+    record.ms[PRESENT] = _presentMs;
+    _presentMs = NO_SAMPLE;
+
+    // Evict the oldest frame once the window is full
+    if (_count == _records.size()) {
+      remove(_records[_next]);
+    } else {
+      _count++;
+    }
+
+    _records[_next] = record;
+    add(record);
+    _next = (_next + 1) % _records.size();
+  }
+
+  Summary summary(Metric metric) const {
+    Summary result;
+    float sum = 0.0f;
+
+    for (uint32_t i = 0; i < _count; i++) {
+      const float ms = _records[i].ms[metric];
+      if (ms < 0.0f) continue;
+
+      if (result.frames == 0) {
+        result.minMs = ms;
+        result.maxMs = ms;
+      }
+      result.minMs = std::min(result.minMs, ms);
+      result.maxMs = std::max(result.maxMs, ms);
+      sum += ms;
+      result.frames++;
+      if (ms > _budgetMs) result.overBudget++;
+    }
+
+    if (result.frames == 0) return result;
+
+    result.avgMs = sum / result.frames;
+    result.p50Ms = percentile(metric, result, 0.50f);
+    result.p95Ms = percentile(metric, result, 0.95f);
+    result.p99Ms = percentile(metric, result, 0.99f);
+
+    return result;
+  }
+
+  // Frames over budget since init, not just inside the window
+  uint64_t over_budget_total(Metric metric) const {
+    return _overBudgetTotal[metric];
+  }
+
+  float budget_ms(void) const { return _budgetMs; }
+
+  void print(const char* label) const {
+    static const char* names[METRIC_COUNT] = {"CPU", "GPU", "Present"};
+
+    printf("%s, last %u frames, budget %.2f ms\n", label, _count, _budgetMs);
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+      const Summary stats = summary(static_cast<Metric>(metric));
+      if (stats.frames == 0) continue;
+
+      printf(
+          "  %-8s min %6.2f avg %6.2f p50 %6.2f p95 %6.2f p99 %6.2f "
+          "max %6.2f ms, %u over budget\n",
+          names[metric], stats.minMs, stats.avgMs, stats.p50Ms, stats.p95Ms,
+          stats.p99Ms, stats.maxMs, stats.overBudget);
+    }
+  }
+
+  // Writes the frames in the window, oldest first. Unknown values are empty.
+  bool write_csv(const std::string& filename) const {
+    FILE* file = fopen(filename.c_str(), "w");
+    if (file == nullptr) {
+      fprintf(stderr, "Failed to open %s\n", filename.c_str());
+      return false;
+    }
+
+    fprintf(file, "frame,cpu_ms,gpu_ms,present_ms\n");
+
+    const uint32_t first = _count == _records.size() ? _next : 0;
+    for (uint32_t i = 0; i < _count; i++) {
+      const FrameRecord& record = _records[(first + i) % _records.size()];
+      fprintf(file, "%llu", static_cast<unsigned long long>(record.frame));
+      for (int metric = 0; metric < METRIC_COUNT; metric++) {
+        if (record.ms[metric] < 0.0f) {
+          fprintf(file, ",");
+        } else {
+          fprintf(file, ",%.4f", record.ms[metric]);
+        }
+      }
+      fprintf(file, "\n");
+    }
+
+    const bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+  }
+
+ private:
+  // 0.05 ms buckets cover 0 to 100 ms, the last bucket takes everything above
+  static constexpr float BUCKET_MS = 0.05f;
+  static constexpr uint32_t BUCKET_COUNT = 2001;
+
+  struct FrameRecord {
+    uint64_t frame{0};
+    float ms[METRIC_COUNT]{NO_SAMPLE, NO_SAMPLE, NO_SAMPLE};
+  };
+
+  static float elapsed_ms(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<float, std::milli>(end - begin).count();
+  }
+
+  static uint32_t bucket(float ms) {
+    return std::min(static_cast<uint32_t>(ms / BUCKET_MS), BUCKET_COUNT - 1);
+  }
+
+  void add(const FrameRecord& record) {
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+      const float ms = record.ms[metric];
+      if (ms < 0.0f) continue;
+      _histograms[metric][bucket(ms)]++;
+      if (ms > _budgetMs) _overBudgetTotal[metric]++;
+    }
+  }
+
+  void remove(const FrameRecord& record) {
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+      const float ms = record.ms[metric];
+      if (ms < 0.0f) continue;
+      _histograms[metric][bucket(ms)]--;
+    }
+  }
+
+  // Upper edge of the bucket holding the requested rank, kept inside the
+  // exact range of the window
+  float percentile(Metric metric, const Summary& stats, float fraction) const {
+    const uint32_t rank = std::max(
+        static_cast<uint32_t>(fraction * stats.frames + 0.999f), 1u);
+
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+      seen += _histograms[metric][i];
+      if (seen >= rank) {
+        const float edge = (i + 1) * BUCKET_MS;
+        return std::clamp(edge, stats.minMs, stats.maxMs);
+      }
+    }
+    return stats.maxMs;
+  }
+
+  float _budgetMs{16.6f};
+
+  std::vector<FrameRecord> _records;
+  uint32_t _next{0};
+  uint32_t _count{0};
+  uint64_t _frame{0};
+
+  std::vector<uint32_t> _histograms[METRIC_COUNT];
+  uint64_t _overBudgetTotal[METRIC_COUNT]{};
+
+  Clock::time_point _frameStart;
+  Clock::time_point _waitStart;
+  float _waitMs{0.0f};
+
+  Clock::time_point _lastPresent;
+  bool _hasPresented{false};
+  float _presentMs{NO_SAMPLE};
+};
+
+#endif /* C38E5A21_D74F_4B19_9A6E_0F2B7D4C1E85 */
@@ -0,0 +1,119 @@
+#ifndef A9D4F7B2_1C58_4E36_B0A7_8E3C5F1D9B64
+#define A9D4F7B2_1C58_4E36_B0A7_8E3C5F1D9B64
+
+#include <assert.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// 32 bit reference to an item of a HandlePool<T>: the slot index in the low
+// bits and the slot's generation in the high bits. Freeing a slot bumps its
+// generation, so handles to the old item stop resolving instead of reaching
+// whatever reuses the slot. The default handle is null.
+template <typename T>
+struct Handle {
+  static constexpr uint32_t INDEX_BITS = 20;
+  static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+  static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+  uint32_t value{0};
+
+  uint32_t index(void) const { return value & INDEX_MASK; }
+  uint32_t generation(void) const { return value >> INDEX_BITS; }
+
+  bool is_null(void) const { return value == 0; }
+
+  bool operator==(const Handle& other) const { return value == other.value; }
+  bool operator!=(const Handle& other) const { return value != other.value; }
+};
+
+// Items stored contiguously by slot with a free list of released slots.
+// Lookups are an index and a generation compare. Pointers returned by get()
+// are only valid until the next create(), keep handles instead.
+//
+// Every create, destroy and non-const get bumps the pool's version and
+// stamps the slot with it. A copy of the items taken at some version only
+// needs the slots stamped later to catch up.
+template <typename T>
+class HandlePool {
+ public:
+  Handle<T> create(T&& item) {
+    uint32_t index;
+    if (!_freeSlots.empty()) {
+      index = _freeSlots.back();
+      _freeSlots.pop_back();
+      _items[index] = std::move(item);
+      _slotVersions[index] = ++_version;
+    } else {
+      index = static_cast<uint32_t>(_items.size());
+      assert(index <= Handle<T>::INDEX_MASK);
+      _items.push_back(std::move(item));
+      // Generation 0 is left out so no live handle is null
+      _generations.push_back(1);
+      _slotVersions.push_back(++_version);
+    }
+
+    _live++;
+    return {(_generations[index] << Handle<T>::INDEX_BITS) | index};
+  }
+
+  // Releases the slot, the handle and any copies of it turn stale
+  void destroy(Handle<T> handle) {
+    if (!valid(handle)) return;
+
+    const uint32_t index = handle.index();
+    _items[index] = T();
+    _slotVersions[index] = ++_version;
+
+    uint32_t& generation = _generations[index];
+    generation = (generation + 1) & Handle<T>::GENERATION_MASK;
+    if (generation == 0) generation = 1;
+
+    _freeSlots.push_back(index);
+    _live--;
+  }
+
+  bool valid(Handle<T> handle) const {
+    const uint32_t index = handle.index();
+    return !handle.is_null() && index < _items.size() &&
+           _generations[index] == handle.generation();
+  }
+
+  // Null for stale handles. Counts as a change of the item.
+  T* get(Handle<T> handle) {
+    if (!valid(handle)) return nullptr;
+    _slotVersions[handle.index()] = ++_version;
+    return &_items[handle.index()];
+  }
+
+  const T* get(Handle<T> handle) const {
+    return valid(handle) ? &_items[handle.index()] : nullptr;
+  }
+
+  // Items that are alive
+  uint32_t size(void) const { return _live; }
+
+  // Slots, live or free. Handle indices are below this.
+  uint32_t capacity(void) const {
+    return static_cast<uint32_t>(_items.size());
+  }
+
+  // Items by slot index, free slots hold a default constructed item
+  const T* data(void) const { return _items.data(); }
+
+  uint64_t version(void) const { return _version; }
+
+  // Pool version at the last change of a slot
+  uint64_t slot_version(uint32_t index) const { return _slotVersions[index]; }
+
+ private:
+  std::vector<T> _items;
+  std::vector<uint32_t> _generations;
+  std::vector<uint32_t> _freeSlots;
+  std::vector<uint64_t> _slotVersions;
+  uint32_t _live{0};
+  uint64_t _version{0};
+};
+
+#endif /* A9D4F7B2_1C58_4E36_B0A7_8E3C5F1D9B64 */
@@ -0,0 +1,244 @@
+#include "jobSystem.h"
+
+namespace {
+
+// The system the current thread belongs to and the deque it owns
+thread_local const JobSystem* tlsSystem = nullptr;
+thread_local uint32_t tlsDeque = 0;
+
+constexpr uint32_t QUEUE_CAPACITY = 4096;
+
+// Rounds a worker spends looking for work before it goes to sleep
+constexpr uint32_t IDLE_SPINS = 64;
+
+}  // namespace
+
+bool JobSystem::WorkDeque::push(Job* job) {
+  const int64_t bottom = _bottom.load(std::memory_order_relaxed);
+  const int64_t top = _top.load(std::memory_order_acquire);
+  if (bottom - top >= CAPACITY) return false;
+
+  _jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+  _bottom.store(bottom + 1, std::memory_order_release);
+  return true;
+}
+
+Job* JobSystem::WorkDeque::pop() {
+  const int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+  _bottom.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = _top.load(std::memory_order_relaxed);
+
+  if (top > bottom) {
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  Job* job = _jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    // The last job, a thief may be taking it at the same time
+    if (!_top.compare_exchange_strong(top, top + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+Job* JobSystem::WorkDeque::steal() {
+  int64_t top = _top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t bottom = _bottom.load(std::memory_order_acquire);
+  if (top >= bottom) return nullptr;
+
+  Job* job = _jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return job;
+}
+
+void JobSystem::init(uint32_t workerCount) {
+  _dequeCount = workerCount + 1;
+  _deques.reset(new WorkDeque[_dequeCount]);
+  _injected.init(QUEUE_CAPACITY);
+  _mainJobs.init(QUEUE_CAPACITY);
+  _queued = 0;
+  _sleeping = 0;
+  _stop = false;
+
+  tlsSystem = this;
+  tlsDeque = 0;
+
+  for (uint32_t i = 0; i < workerCount; i++) {
+    _workers.emplace_back([this, i]() { worker_main(i + 1); });
+  }
+}
+
+void JobSystem::shutdown() {
+  // Whatever is queued may still be waited on
+  while (Job* job = find_job(0)) execute(job);
+  run_main_thread_jobs();
+
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    _stop = true;
+  }
+  _wake.notify_all();
+
+  for (std::thread& worker : _workers) worker.join();
+  _workers.clear();
+
+  if (tlsSystem == this) tlsSystem = nullptr;
+}
+
+bool JobSystem::on_main_thread() const {
+  return tlsSystem == this && tlsDeque == 0;
+}
+
+void JobSystem::run(Job* job, JobCounter* counter) {
+  job->counter = counter;
+  if (counter) counter->_pending.fetch_add(1, std::memory_order_relaxed);
+  submit(job);
+}
+
+void JobSystem::run_on_main_thread(Job* job, JobCounter* counter) {
+  job->counter = counter;
+  if (counter) counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+  if (on_main_thread()) {
+    execute(job);
+    return;
+  }
+  // The main thread drains the queue whenever it waits
+  while (!_mainJobs.try_push(std::move(job))) std::this_thread::yield();
+}
+
+void JobSystem::run_after(JobCounter* dependency, Job* job,
+                          JobCounter* counter) {
+  job->counter = counter;
+  if (counter) counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> lock(dependency->_mutex);
+    if (dependency->_pending.load(std::memory_order_relaxed) > 0) {
+      dependency->_continuations.push_back(job);
+      return;
+    }
+  }
+  submit(job);
+}
+
+void JobSystem::wait(JobCounter* counter) {
+  const bool mainThread = on_main_thread();
+  const uint32_t self = tlsSystem == this ? tlsDeque : UINT32_MAX;
+
+  while (!counter->done()) {
+    if (mainThread && run_main_thread_jobs() > 0) continue;
+
+    if (Job* job = find_job(self)) {
+      execute(job);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  // The last finish may still hold the lock
+  std::lock_guard<std::mutex> lock(counter->_mutex);
+}
+
+uint32_t JobSystem::run_main_thread_jobs() {
+  uint32_t count = 0;
+  Job* job;
+  while (_mainJobs.try_pop(&job)) {
+    execute(job);
+    count++;
+  }
+  return count;
+}
+
+void JobSystem::submit(Job* job) {
+  const bool pushed = tlsSystem == this && _deques[tlsDeque].push(job);
+  if (!pushed) {
+    // Full deques spill too, running the job here instead could deadlock a
+    // job that waits on its siblings
+    while (!_injected.try_push(std::move(job))) {
+      if (Job* other = find_job(tlsSystem == this ? tlsDeque : UINT32_MAX)) {
+        execute(other);
+      }
+    }
+  }
+
+  _queued.fetch_add(1, std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_seq_cst) > 0) {
+    {
+      // A worker between checking the count and sleeping would miss the
+      // notify otherwise
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+    }
+    _wake.notify_one();
+  }
+}
+
+Job* JobSystem::find_job(uint32_t self) {
+  Job* job = nullptr;
+  if (self < _dequeCount) job = _deques[self].pop();
+  if (job == nullptr) _injected.try_pop(&job);
+
+  // Start stealing after the own deque, so thieves spread over the victims
+  for (uint32_t i = 1; job == nullptr && i <= _dequeCount; i++) {
+    const uint32_t victim = (self + i) % _dequeCount;
+    if (victim != self) job = _deques[victim].steal();
+  }
+
+  if (job) _queued.fetch_sub(1, std::memory_order_relaxed);
+  return job;
+}
+
+void JobSystem::execute(Job* job) {
+  // The job may be freed by a waiter as soon as the counter drops
+  JobCounter* counter = job->counter;
+  job->function(*job);
+  if (counter) finish(counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+  std::vector<Job*> continuations;
+  {
+    std::lock_guard<std::mutex> lock(counter->_mutex);
+    if (counter->_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      continuations.swap(counter->_continuations);
+    }
+  }
+  for (Job* job : continuations) submit(job);
+}
+
+void JobSystem::worker_main(uint32_t index) {
+  tlsSystem = this;
+  tlsDeque = index;
+
+  uint32_t idle = 0;
+  while (!_stop) {
+    if (Job* job = find_job(index)) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+
+    if (++idle < IDLE_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    _sleeping.fetch_add(1, std::memory_order_seq_cst);
+    _wake.wait(lock, [this]() {
+      return _stop || _queued.load(std::memory_order_seq_cst) > 0;
+    });
+    _sleeping.fetch_sub(1, std::memory_order_relaxed);
+    idle = 0;
+  }
+}
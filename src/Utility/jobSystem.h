@@ -0,0 +1,187 @@
+#ifndef F2B86D41_3A9C_4E57_9D12_6C4E8A0B3F75
+#define F2B86D41_3A9C_4E57_9D12_6C4E8A0B3F75
+
+#include "mpmcQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class JobCounter;
+
+// A unit of work. The submitter owns the job and keeps it alive until the
+// counter it was run with reaches zero. begin and end are free for the
+// function to use, parallel_for passes its chunk through them.
+struct Job {
+  void (*function)(Job& job){nullptr};
+  void* context{nullptr};
+  size_t begin{0};
+  size_t end{0};
+
+  // Set by the job system
+  JobCounter* counter{nullptr};
+};
+
+// Unfinished jobs of a group. Waiting on it, or chaining jobs behind it with
+// JobSystem::run_after, is how dependencies are expressed. Only reuse or
+// destroy a counter after JobSystem::wait returned for it.
+class JobCounter {
+ public:
+  bool done(void) const {
+    return _pending.load(std::memory_order_acquire) == 0;
+  }
+
+ private:
+  friend class JobSystem;
+
+  std::atomic<uint32_t> _pending{0};
+
+  // Guards the last decrement as well, so a finished counter is never
+  // touched again once wait has seen it reach zero
+  std::mutex _mutex;
+  std::vector<Job*> _continuations;
+};
+
+// Work-stealing scheduler shared by the engine's subsystems. Every worker
+// thread, and the thread that called init, owns a deque: it pushes and pops
+// its own jobs at the bottom while idle workers steal the oldest ones from
+// the top of the others. Threads that aren't part of the system (the render
+// thread) submit through a shared queue instead.
+//
+// Jobs that must run on the thread that called init, like anything touching
+// SDL, go to a separate queue drained by run_main_thread_jobs and by waits
+// on that thread.
+class JobSystem {
+ public:
+  // The calling thread becomes the main thread and joins in while it waits
+  void init(uint32_t workerCount);
+
+  // Runs whatever is still queued, then joins the workers
+  void shutdown(void);
+
+  // Workers plus the main thread
+  uint32_t thread_count(void) const {
+    return static_cast<uint32_t>(_workers.size()) + 1;
+  }
+
+  // True on the thread that called init
+  bool on_main_thread(void) const;
+
+  void run(Job* job, JobCounter* counter);
+
+  // Jobs that are queued on the main thread
+  void run_on_main_thread(Job* job, JobCounter* counter);
+
+  // Runs job once everything counted by dependency finished. The job is
+  // counted by counter from now on.
+  void run_after(JobCounter* dependency, Job* job, JobCounter* counter);
+
+  // Runs other jobs until the counter reaches zero
+  void wait(JobCounter* counter);
+
+  // Main thread only, returns the number of jobs run
+  uint32_t run_main_thread_jobs(void);
+
+  // Splits [begin, end) into chunks of at least minChunkSize items, a few
+  // per thread so stealing can even out uneven chunks, and runs
+  // func(chunkBegin, chunkEnd) on each. The caller runs the first chunk and
+  // helps with the rest. Small ranges run inline.
+  template <typename Func>
+  void parallel_for(size_t begin, size_t end, size_t minChunkSize,
+                    Func&& func);
+
+ private:
+  // Chase-Lev deque of fixed capacity. Only the owner pushes and pops,
+  // any thread may steal.
+  class WorkDeque {
+   public:
+    bool push(Job* job);
+    Job* pop(void);
+    Job* steal(void);
+
+   private:
+    static constexpr int64_t CAPACITY = 4096;
+
+    std::atomic<Job*> _jobs[CAPACITY] = {};
+    alignas(64) std::atomic<int64_t> _top{0};
+    alignas(64) std::atomic<int64_t> _bottom{0};
+  };
+
+  void submit(Job* job);
+  Job* find_job(uint32_t self);
+  void execute(Job* job);
+  void finish(JobCounter* counter);
+  void worker_main(uint32_t index);
+
+  // Slot 0 is the main thread's, worker i owns slot i + 1
+  std::unique_ptr<WorkDeque[]> _deques;
+  uint32_t _dequeCount{0};
+
+  // From threads without a deque, and overflow of full deques
+  MpmcQueue<Job*> _injected;
+  MpmcQueue<Job*> _mainJobs;
+
+  std::vector<std::thread> _workers;
+
+  // Queued jobs outside the main queue. Idle workers sleep while it is zero,
+  // submitters only take the lock when someone sleeps.
+  std::atomic<int32_t> _queued{0};
+  std::atomic<uint32_t> _sleeping{0};
+  std::mutex _sleepMutex;
+  std::condition_variable _wake;
+  std::atomic<bool> _stop{false};
+};
+
+template <typename Func>
+void JobSystem::parallel_for(size_t begin, size_t end, size_t minChunkSize,
+                             Func&& func) {
+  constexpr size_t CHUNKS_PER_THREAD = 4;
+  constexpr size_t MAX_CHUNKS = 256;
+
+  const size_t count = end > begin ? end - begin : 0;
+  if (count == 0) return;
+
+  minChunkSize = std::max<size_t>(minChunkSize, 1);
+  const size_t chunkCount = std::min(
+      {size_t(thread_count()) * CHUNKS_PER_THREAD, MAX_CHUNKS,
+       (count + minChunkSize - 1) / minChunkSize});
+
+  if (chunkCount <= 1) {
+    func(begin, end);
+    return;
+  }
+
+  const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+  using FuncType = typename std::remove_reference<Func>::type;
+  Job jobs[MAX_CHUNKS];
+  JobCounter counter;
+
+  // Pushed last to first, so the caller pops them back in order
+  for (size_t chunk = chunkCount - 1; chunk > 0; chunk--) {
+    const size_t chunkBegin = begin + chunk * chunkSize;
+    if (chunkBegin >= end) continue;
+
+    Job& job = jobs[chunk];
+    job.function = [](Job& self) {
+      (*static_cast<FuncType*>(self.context))(self.begin, self.end);
+    };
+    job.context = const_cast<void*>(static_cast<const void*>(&func));
+    job.begin = chunkBegin;
+    job.end = std::min(end, chunkBegin + chunkSize);
+    run(&job, &counter);
+  }
+
+  func(begin, std::min(end, begin + chunkSize));
+
+  wait(&counter);
+}
+
+#endif /* F2B86D41_3A9C_4E57_9D12_6C4E8A0B3F75 */
@@ -0,0 +1,112 @@
+#ifndef F2A94C17_6E3B_4D8A_B5C0_1D7E9A3F8B62
+#define F2A94C17_6E3B_4D8A_B5C0_1D7E9A3F8B62
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Measures how long it takes for sampled input to reach the GPU. Every frame
+// records when input was sampled, when its commands were submitted and when
+// vkQueuePresentKHR returned. Completion is taken when the CPU waits on the
+// frame's fence before reusing its slot, which is exact when the CPU had to
+// block and an upper bound otherwise.
+//
+// prepared() and completed() belong to the thread that samples input, the
+// other two may come from a render thread as long as it is done with the
+// slot before the slot is prepared again.
+class LatencyTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void init(uint32_t frameCount, float reportIntervalSec = 1.0f) {
+    assert(frameCount > 0);
+    _slots.assign(frameCount, Slot{});
+    _reportIntervalSec = reportIntervalSec;
+    _intervalStart = Clock::now();
+  }
+
+  void input_sampled(void) { _pendingInput = Clock::now(); }
+
+  // The slot's frame takes the input sampled last
+  void prepared(uint32_t slot) { _slots[slot].input = _pendingInput; }
+
+  void submitted(uint32_t slot) {
+    _slots[slot].submit = Clock::now();
+    _slots[slot].inFlight = true;
+  }
+
+  void presented(uint32_t slot) { _slots[slot].present = Clock::now(); }
+
+  // Call right after waiting on the fence of the slot
+  void completed(uint32_t slot) {
+    Slot& frame = _slots[slot];
+    if (!frame.inFlight) return;
+    frame.inFlight = false;
+
+    const Clock::time_point now = Clock::now();
+    add_sample(_interval, frame, now);
+    add_sample(_total, frame, now);
+
+    const double elapsed =
+        std::chrono::duration<double>(now - _intervalStart).count();
+    if (elapsed >= _reportIntervalSec) {
+      print("Latency", _interval);
+      _interval = Stats{};
+      _intervalStart = now;
+    }
+  }
+
+  // Averages over the whole run
+  void print_summary(const char* label) const { print(label, _total); }
+
+ private:
+  struct Slot {
+    Clock::time_point input, submit, present;
+    bool inFlight{false};
+  };
+
+  struct Stats {
+    uint64_t frames{0};
+    double submitSum{0.0}, presentSum{0.0}, completeSum{0.0};
+    double completeMax{0.0};
+  };
+
+  static double ms(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+  }
+
+  static void add_sample(Stats& stats, const Slot& frame,
+                         Clock::time_point completion) {
+    const double complete = ms(frame.input, completion);
+    stats.frames++;
+    stats.submitSum += ms(frame.input, frame.submit);
+    stats.presentSum += ms(frame.input, frame.present);
+    stats.completeSum += complete;
+    stats.completeMax = std::max(stats.completeMax, complete);
+  }
+
+  static void print(const char* label, const Stats& stats) {
+    if (stats.frames == 0) return;
+    const double n = static_cast<double>(stats.frames);
+    printf(
+        "%s: input->submit %.2f ms, input->present %.2f ms, input->gpu done "
+        "%.2f ms (max %.2f) over %llu frames\n",
+        label, stats.submitSum / n, stats.presentSum / n,
+        stats.completeSum / n, stats.completeMax,
+        static_cast<unsigned long long>(stats.frames));
+  }
+
+  std::vector<Slot> _slots;
+  Clock::time_point _pendingInput{};
+  Clock::time_point _intervalStart{};
+  float _reportIntervalSec{1.0f};
+
+  Stats _interval;
+  Stats _total;
+};
+
+#endif /* F2A94C17_6E3B_4D8A_B5C0_1D7E9A3F8B62 */
@@ -0,0 +1,92 @@
+#ifndef C8E2A5F1_7B39_4D06_A4C3_9F1E6B2D8A57
+#define C8E2A5F1_7B39_4D06_A4C3_9F1E6B2D8A57
+
+#include <assert.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free queue for any number of producer and consumer threads
+// (Dmitry Vyukov's design). Every cell carries a sequence number that tells
+// whether it is ready to be written or read in the current lap around the
+// ring, so pushes and pops only contend on one atomic counter each. Full and
+// empty queues fail instead of blocking.
+template <typename T>
+class MpmcQueue {
+ public:
+  // Capacity must be a power of two
+  void init(size_t capacity) {
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+    _cells.reset(new Cell[capacity]);
+    _mask = capacity - 1;
+    for (size_t i = 0; i < capacity; i++) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    _enqueuePos.store(0, std::memory_order_relaxed);
+    _dequeuePos.store(0, std::memory_order_relaxed);
+  }
+
+  size_t capacity(void) const { return _mask + 1; }
+
+  bool try_push(T&& value) {
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = _cells[pos & _mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (_enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full, the cell still holds last lap's value
+      } else {
+        pos = _enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_pop(T* out) {
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = _cells[pos & _mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (_dequeuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          *out = std::move(cell.value);
+          cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // empty, the cell hasn't been written this lap
+      } else {
+        pos = _dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> _cells;
+  size_t _mask{0};
+
+  // Producers and consumers each hammer their own cache line
+  alignas(64) std::atomic<size_t> _enqueuePos{0};
+  alignas(64) std::atomic<size_t> _dequeuePos{0};
+};
+
+#endif /* C8E2A5F1_7B39_4D06_A4C3_9F1E6B2D8A57 */
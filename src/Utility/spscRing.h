@@ -0,0 +1,85 @@
+#ifndef E4A17C3B_9D62_4F85_B1E8_2C6F0A5D7B93
+#define E4A17C3B_9D62_4F85_B1E8_2C6F0A5D7B93
+
+#include <assert.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free ring for exactly one producer and one consumer thread.
+// Items stay in the ring and are reused: the producer fills the next free
+// item in place and publishes it, the consumer reads the oldest published
+// item in place and releases it. Each side only stores to its own index and
+// keeps a cached copy of the other one, so the shared lines are only read
+// again when the ring looks full or empty.
+template <typename T>
+class SpscRing {
+ public:
+  // Capacity must be a power of two. Not thread safe, call before either
+  // side runs.
+  void init(size_t capacity) {
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+    _items.reset(new T[capacity]);
+    _mask = capacity - 1;
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    _cachedHead = 0;
+    _cachedTail = 0;
+  }
+
+  size_t capacity(void) const { return _mask + 1; }
+
+  // Producer: the next free item, null when the ring is full. It keeps
+  // whatever it held the last time around.
+  T* claim(void) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _cachedHead > _mask) {
+      _cachedHead = _head.load(std::memory_order_acquire);
+      if (tail - _cachedHead > _mask) return nullptr;
+    }
+    return &_items[tail & _mask];
+  }
+
+  // Producer: hands the claimed item to the consumer
+  void publish(void) {
+    _tail.store(_tail.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  // Consumer: the oldest published item, null when the ring is empty
+  T* front(void) {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _cachedTail) {
+      _cachedTail = _tail.load(std::memory_order_acquire);
+      if (head == _cachedTail) return nullptr;
+    }
+    return &_items[head & _mask];
+  }
+
+  // Consumer: gives the front item back to the producer
+  void pop(void) {
+    _head.store(_head.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  // Safe from either side, the answer may be stale by the time it returns
+  bool empty(void) const {
+    return _head.load(std::memory_order_acquire) ==
+           _tail.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::unique_ptr<T[]> _items;
+  size_t _mask{0};
+
+  // Consumer side: its index and its cached copy of the tail
+  alignas(64) std::atomic<size_t> _head{0};
+  size_t _cachedTail{0};
+
+  // Producer side: its index and its cached copy of the head
+  alignas(64) std::atomic<size_t> _tail{0};
+  size_t _cachedHead{0};
+};
+
+#endif /* E4A17C3B_9D62_4F85_B1E8_2C6F0A5D7B93 */
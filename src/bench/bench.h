@@ -0,0 +1,88 @@
+#ifndef A6E2F4B8_1D3C_4E7A_9B5F_08C4D2E6A193
+#define A6E2F4B8_1D3C_4E7A_9B5F_08C4D2E6A193
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Minimal in-tree benchmark harness. A benchmark is a function taking a
+// State and looping on keep_running(); the harness keeps calling the body
+// until enough time has been measured.
+namespace bench {
+
+class State {
+ public:
+  State(int64_t arg, double minSeconds) : _arg(arg), _minSeconds(minSeconds) {}
+
+  int64_t arg(void) const { return _arg; }
+
+  bool keep_running(void);
+
+  // Excludes per-iteration setup from the measurement
+  void pause_timing(void);
+  void resume_timing(void);
+
+  // Items handled by one iteration, used to report throughput
+  void set_items_per_iteration(int64_t items) { _itemsPerIteration = items; }
+
+  uint64_t iterations(void) const { return _iterations; }
+  double seconds(void) const { return _elapsed.count(); }
+  int64_t items_per_iteration(void) const { return _itemsPerIteration; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  int64_t _arg;
+  double _minSeconds;
+
+  uint64_t _iterations{0};
+  int64_t _itemsPerIteration{0};
+  bool _started{false};
+  bool _paused{false};
+
+  Clock::time_point _start;
+  std::chrono::duration<double> _elapsed{0.0};
+};
+
+using Function = void (*)(State&);
+
+int register_benchmark(const char* name, Function function,
+                       std::vector<int64_t> args);
+
+// Job system for benchmarks of multithreaded engine code, started on first
+// use. It has a worker per hardware thread besides the caller's, and at
+// least one, so jobs make progress while a benchmark polls for results.
+// run_all shuts it down after the last benchmark.
+JobSystem& default_jobs(void);
+
+// Runs every registered benchmark whose name contains filter. With a json
+// path the results are also written there in the Google Benchmark JSON
+// layout, so its compare.py can diff two builds.
+int run_all(const std::string& filter, const std::string& jsonPath);
+
+// Keeps the compiler from discarding a value computed by a benchmark. On
+// GCC and Clang the empty asm claims to read the value and clobber memory.
+// Elsewhere the address goes to a volatile pointer, which can't be elided.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static const void* volatile sink;
+  sink = &value;
+#endif
+}
+
+}  // namespace bench
+
+#define BENCHMARK_CONCAT_INNER(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_INNER(a, b)
+
+#define BENCHMARK(function, ...)                                      \
+  static int BENCHMARK_CONCAT(function##_registered_, __LINE__) =     \
+      bench::register_benchmark(#function, function, {__VA_ARGS__});
+
+#endif /* A6E2F4B8_1D3C_4E7A_9B5F_08C4D2E6A193 */
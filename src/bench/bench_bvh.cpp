@@ -0,0 +1,161 @@
+#include "bench.h"
+
+#include "camera/frustum.h"
+#include "scene/bvh.h"
+
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// Same scatter as frustum_cull_objects, so the culling numbers compare
+static void scatter_objects(uint32_t count, std::vector<uint32_t>* outIds,
+                            std::vector<Aabb>* outBounds) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+
+  outIds->resize(count);
+  outBounds->resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    const glm::vec3 center(position(rng), position(rng) * 0.1f, position(rng));
+    (*outIds)[i] = i;
+    (*outBounds)[i] = sphere_bounds(glm::vec4(center, 1.5f));
+  }
+}
+
+static Frustum bench_frustum(void) {
+  glm::mat4 projection =
+      glm::perspective(glm::radians(70.0f), 2.0f, 0.1f, 200.0f);
+  projection[1][1] *= -1;
+  const glm::mat4 view =
+      glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f, 10.0f, -1.0f),
+                  glm::vec3(0.0f, 1.0f, 0.0f));
+  return Frustum(projection * view);
+}
+
+static void bvh_build(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+  std::vector<uint32_t> ids;
+  std::vector<Aabb> bounds;
+  scatter_objects(count, &ids, &bounds);
+
+  Bvh bvh;
+  while (state.keep_running()) {
+    bvh.build(ids.data(), bounds.data(), count);
+    bench::do_not_optimize(bvh);
+  }
+
+  state.set_items_per_iteration(count);
+}
+BENCHMARK(bvh_build, 100000, 1000000);
+
+// Items are all objects in the scene, not just the visible ones, so the
+// throughput compares with the linear test of frustum_cull_objects
+static void bvh_frustum_cull(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+  std::vector<uint32_t> ids;
+  std::vector<Aabb> bounds;
+  scatter_objects(count, &ids, &bounds);
+
+  Bvh bvh;
+  bvh.build(ids.data(), bounds.data(), count);
+
+  const Frustum frustum = bench_frustum();
+  std::vector<uint32_t> visible;
+  while (state.keep_running()) {
+    visible.clear();
+    bvh.query_frustum(frustum, &visible);
+    bench::do_not_optimize(visible.data());
+  }
+
+  state.set_items_per_iteration(count);
+}
+BENCHMARK(bvh_frustum_cull, 100000, 1000000);
+
+// Every 100th object moves a little each iteration, as animated objects do
+static void bvh_refit(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+  std::vector<uint32_t> ids;
+  std::vector<Aabb> bounds;
+  scatter_objects(count, &ids, &bounds);
+
+  Bvh bvh;
+  bvh.build(ids.data(), bounds.data(), count);
+
+  float offset = 0.0f;
+  while (state.keep_running()) {
+    offset = offset > 1.0f ? -1.0f : offset + 0.01f;
+    for (uint32_t i = 0; i < count; i += 100) {
+      Aabb moved = bounds[i];
+      moved.min.y += offset;
+      moved.max.y += offset;
+      bvh.set_bounds(ids[i], moved);
+    }
+    bvh.refit();
+  }
+
+  state.set_items_per_iteration((count + 99) / 100);
+}
+BENCHMARK(bvh_refit, 100000, 1000000);
+
+// 1000 rays from random points in random directions, as picking would cast
+static void bvh_raycast(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+  std::vector<uint32_t> ids;
+  std::vector<Aabb> bounds;
+  scatter_objects(count, &ids, &bounds);
+
+  Bvh bvh;
+  bvh.build(ids.data(), bounds.data(), count);
+
+  constexpr uint32_t RAYS = 1000;
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+  std::vector<glm::vec3> origins(RAYS);
+  std::vector<glm::vec3> directions(RAYS);
+  for (uint32_t i = 0; i < RAYS; i++) {
+    origins[i] = glm::vec3(position(rng), position(rng) * 0.1f, position(rng));
+    directions[i] = glm::normalize(
+        glm::vec3(position(rng), position(rng) * 0.1f, position(rng)));
+  }
+
+  while (state.keep_running()) {
+    for (uint32_t i = 0; i < RAYS; i++) {
+      BvhHit hit;
+      bvh.raycast(origins[i], directions[i], 200.0f, &hit);
+      bench::do_not_optimize(hit);
+    }
+  }
+
+  state.set_items_per_iteration(RAYS);
+}
+BENCHMARK(bvh_raycast, 100000, 1000000);
+
+// Closest object to 1000 random points
+static void bvh_nearest(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+  std::vector<uint32_t> ids;
+  std::vector<Aabb> bounds;
+  scatter_objects(count, &ids, &bounds);
+
+  Bvh bvh;
+  bvh.build(ids.data(), bounds.data(), count);
+
+  constexpr uint32_t POINTS = 1000;
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+  std::vector<glm::vec3> points(POINTS);
+  for (glm::vec3& point : points) {
+    point = glm::vec3(position(rng), position(rng) * 0.1f, position(rng));
+  }
+
+  while (state.keep_running()) {
+    for (const glm::vec3& point : points) {
+      BvhHit hit;
+      bvh.nearest(point, FLT_MAX, &hit);
+      bench::do_not_optimize(hit);
+    }
+  }
+
+  state.set_items_per_iteration(POINTS);
+}
+BENCHMARK(bvh_nearest, 100000, 1000000);
@@ -0,0 +1,96 @@
+#include "bench.h"
+
+#include "camera/camera.h"
+#include "camera/cameraPath.h"
+#include "camera/frustum.h"
+
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// Runs arg first person camera updates with movement and mouse look
+static void camera_update_first_person(bench::State& state) {
+  const int64_t updates = state.arg();
+
+  CameraPositioner_FirstPerson positioner(glm::vec3(0.0f, 10.0f, 0.0f),
+                                          glm::vec3(0.0f, 10.0f, -1.0f),
+                                          glm::vec3(0.0f, 1.0f, 0.0f));
+  positioner._movement._forward = true;
+  positioner._movement._right = true;
+
+  glm::vec2 mouse(0.0f);
+  while (state.keep_running()) {
+    for (int64_t i = 0; i < updates; i++) {
+      mouse.x += 0.001f;
+      positioner.update(1.0 / 60.0, mouse, true);
+      bench::do_not_optimize(positioner.getViewMatrix());
+    }
+  }
+
+  state.set_items_per_iteration(updates);
+}
+BENCHMARK(camera_update_first_person, 1000);
+
+// Samples a 100 keyframe path arg times, as the benchmark mode does
+static void camera_path_sample(bench::State& state) {
+  const int64_t samples = state.arg();
+
+  CameraPath path;
+  for (int i = 0; i < 100; i++) {
+    const float angle = i * 0.1f;
+    path.add_keyframe({float(i), glm::vec3(std::cos(angle), 0.0f, i),
+                       glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f))});
+  }
+
+  CameraPositioner_Path positioner;
+  positioner.setPath(&path);
+
+  const float step = path.duration() / samples;
+  while (state.keep_running()) {
+    for (int64_t i = 0; i < samples; i++) {
+      positioner.setTime(i * step);
+      bench::do_not_optimize(positioner.getViewMatrix());
+    }
+  }
+
+  state.set_items_per_iteration(samples);
+}
+BENCHMARK(camera_path_sample, 1000);
+
+// Tests arg objects scattered around the camera against the view frustum,
+// including moving their model space bounds to world space
+static void frustum_cull_objects(bench::State& state) {
+  const size_t count = static_cast<size_t>(state.arg());
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+
+  std::vector<glm::mat4> transforms(count);
+  for (glm::mat4& transform : transforms) {
+    transform = glm::translate(
+        glm::mat4(1.0f),
+        glm::vec3(position(rng), position(rng) * 0.1f, position(rng)));
+  }
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(70.0f), 2.0f, 0.1f, 200.0f);
+  projection[1][1] *= -1;
+  const glm::mat4 view =
+      glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f, 10.0f, -1.0f),
+                  glm::vec3(0.0f, 1.0f, 0.0f));
+
+  std::vector<glm::vec4> spheres(count);
+  std::vector<uint8_t> visible(count);
+
+  while (state.keep_running()) {
+    const Frustum frustum(projection * view);
+    for (size_t i = 0; i < count; i++) {
+      spheres[i] = transform_sphere(transforms[i], glm::vec3(0.0f), 1.5f);
+    }
+    bench::do_not_optimize(
+        frustum.cull_spheres(spheres.data(), count, visible.data()));
+  }
+
+  state.set_items_per_iteration(static_cast<int64_t>(count));
+}
+BENCHMARK(frustum_cull_objects, 1000, 100000, 1000000);
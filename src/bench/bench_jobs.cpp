@@ -0,0 +1,36 @@
+#include "bench.h"
+
+#include "Utility/jobSystem.h"
+
+#include <cmath>
+#include <vector>
+
+// parallel_for over 1M items on arg threads, the caller included. Every item
+// does about as much math as transforming a bounding sphere, so the numbers
+// show how the scheduler scales rather than memory bandwidth.
+static void jobs_parallel_for(bench::State& state) {
+  constexpr size_t COUNT = 1000000;
+  constexpr size_t MIN_CHUNK = 4096;
+
+  JobSystem jobs;
+  jobs.init(static_cast<uint32_t>(state.arg()) - 1);
+
+  std::vector<float> input(COUNT);
+  std::vector<float> output(COUNT);
+  for (size_t i = 0; i < COUNT; i++) input[i] = static_cast<float>(i) * 0.001f;
+
+  while (state.keep_running()) {
+    jobs.parallel_for(0, COUNT, MIN_CHUNK, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        const float x = input[i];
+        output[i] = std::sqrt(x * x + 1.0f) * std::sin(x) + std::cos(x * 0.5f);
+      }
+    });
+    bench::do_not_optimize(output.data());
+  }
+
+  jobs.shutdown();
+
+  state.set_items_per_iteration(COUNT);
+}
+BENCHMARK(jobs_parallel_for, 1, 2, 4, 8, 16);
@@ -0,0 +1,195 @@
+#include "bench.h"
+
+#include "Utility/jobSystem.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <ctime>
+#include <thread>
+
+namespace {
+
+struct Registered {
+  const char* name;
+  bench::Function function;
+  std::vector<int64_t> args;
+};
+
+std::vector<Registered>& registry() {
+  static std::vector<Registered> benchmarks;
+  return benchmarks;
+}
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double secondsPerIteration;
+  double itemsPerSecond;
+};
+
+constexpr double MIN_SECONDS = 0.5;
+
+#if defined(NDEBUG)
+constexpr const char* BUILD_TYPE = "release";
+#else
+constexpr const char* BUILD_TYPE = "debug";
+#endif
+
+bool write_json(const std::string& path, const std::vector<Result>& results) {
+  FILE* file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Failed to open %s\n", path.c_str());
+    return false;
+  }
+
+  char date[64];
+  const std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+  fprintf(file, "{\n  \"context\": {\n");
+  fprintf(file, "    \"date\": \"%s\",\n", date);
+  fprintf(file, "    \"num_cpus\": %u,\n",
+          std::thread::hardware_concurrency());
+  fprintf(file, "    \"library_build_type\": \"%s\"\n", BUILD_TYPE);
+  fprintf(file, "  },\n  \"benchmarks\": [\n");
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& result = results[i];
+    const double nanoseconds = result.secondsPerIteration * 1e9;
+    fprintf(file,
+            "    {\"name\": \"%s\", \"run_name\": \"%s\", "
+            "\"run_type\": \"iteration\", \"iterations\": %llu, "
+            "\"real_time\": %.3f, \"cpu_time\": %.3f, "
+            "\"time_unit\": \"ns\", \"items_per_second\": %.3f}%s\n",
+            result.name.c_str(), result.name.c_str(),
+            static_cast<unsigned long long>(result.iterations), nanoseconds,
+            nanoseconds, result.itemsPerSecond,
+            i + 1 == results.size() ? "" : ",");
+  }
+
+  fprintf(file, "  ]\n}\n");
+
+  const bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
+
+JobSystem defaultJobs;
+bool defaultJobsStarted = false;
+
+}  // namespace
+
+JobSystem& bench::default_jobs() {
+  if (!defaultJobsStarted) {
+    defaultJobs.init(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    defaultJobsStarted = true;
+  }
+  return defaultJobs;
+}
+
+bool bench::State::keep_running() {
+  if (!_started) {
+    _started = true;
+    _start = Clock::now();
+    return true;
+  }
+
+  _iterations++;
+
+  if (!_paused) {
+    const Clock::time_point now = Clock::now();
+    _elapsed += now - _start;
+    _start = now;
+  }
+
+  return _elapsed.count() < _minSeconds;
+}
+
+void bench::State::pause_timing() {
+  _elapsed += Clock::now() - _start;
+  _paused = true;
+}
+
+void bench::State::resume_timing() {
+  _paused = false;
+  _start = Clock::now();
+}
+
+int bench::register_benchmark(const char* name, Function function,
+                              std::vector<int64_t> args) {
+  if (args.empty()) args.push_back(0);
+  registry().push_back({name, function, std::move(args)});
+  return 0;
+}
+
+int bench::run_all(const std::string& filter, const std::string& jsonPath) {
+  std::vector<Result> results;
+
+  printf("%-40s %12s %14s %16s\n", "benchmark", "iterations", "time/iter",
+         "items/s");
+
+  for (const Registered& benchmark : registry()) {
+    if (std::string(benchmark.name).find(filter) == std::string::npos) {
+      continue;
+    }
+
+    for (int64_t arg : benchmark.args) {
+      State state(arg, MIN_SECONDS);
+      benchmark.function(state);
+
+      const std::string name =
+          std::string(benchmark.name) + "/" + std::to_string(arg);
+
+      // Benchmarks return without running when their input is missing, a
+      // zero sample would read as a real result
+      if (state.iterations() == 0) {
+        printf("%-40s %12s\n", name.c_str(), "skipped");
+        continue;
+      }
+
+      const double perIteration = state.seconds() / state.iterations();
+      const double itemsPerSecond =
+          state.seconds() > 0.0
+              ? state.items_per_iteration() * state.iterations() /
+                    state.seconds()
+              : 0.0;
+
+      printf("%-40s %12llu %11.3f ms %16.0f\n", name.c_str(),
+             static_cast<unsigned long long>(state.iterations()),
+             perIteration * 1000.0, itemsPerSecond);
+
+      results.push_back(
+          {name, state.iterations(), perIteration, itemsPerSecond});
+    }
+  }
+
+  if (defaultJobsStarted) {
+    defaultJobs.shutdown();
+    defaultJobsStarted = false;
+  }
+
+  if (!jsonPath.empty()) {
+    if (!write_json(jsonPath, results)) return 1;
+    printf("Wrote %zu results to %s\n", results.size(), jsonPath.c_str());
+  }
+
+  return 0;
+}
+
+// vulkan_guide_bench [filter] [--json results.json]
+int main(int argc, char* argv[]) {
+  std::string filter;
+  std::string jsonPath;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--json" && i + 1 < argc) {
+      jsonPath = argv[++i];
+    } else {
+      filter = arg;
+    }
+  }
+
+  return bench::run_all(filter, jsonPath);
+}
@@ -0,0 +1,40 @@
+#include "bench.h"
+
+#include "vk_mesh.h"
+
+#include <stdio.h>
+
+// Set by CMake, the engine copies the same models next to its executable
+#ifndef BENCH_ASSET_DIR
+#define BENCH_ASSET_DIR "../assets"
+#endif
+
+static const char* OBJ_FILES[] = {
+    "/models/monkey_smooth/monkey_smooth.obj",
+    "/models/lost_empire/lost_empire.obj",
+};
+
+// Parses the OBJ selected by arg, items are the vertices produced
+static void mesh_load_obj(bench::State& state) {
+  const std::string filename =
+      std::string(BENCH_ASSET_DIR) + OBJ_FILES[state.arg()];
+
+  // Skips the benchmark when the model isn't there. Warnings, like a
+  // missing .mtl, are the same every time and only reported here.
+  Mesh probe;
+  std::string warning;
+  if (!probe.load_from_obj(filename, &warning)) {
+    fprintf(stderr, "Skipping, failed to load %s\n", filename.c_str());
+    return;
+  }
+  if (!warning.empty()) fprintf(stderr, "%s", warning.c_str());
+
+  while (state.keep_running()) {
+    Mesh mesh;
+    mesh.load_from_obj(filename, &warning);
+    bench::do_not_optimize(mesh._vertices.data());
+  }
+
+  state.set_items_per_iteration(static_cast<int64_t>(probe._vertices.size()));
+}
+BENCHMARK(mesh_load_obj, 0, 1);
@@ -0,0 +1,124 @@
+#include "bench.h"
+
+#include "vk_renderGraph.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+constexpr VkExtent2D SCREEN_EXTENT = {1920, 1080};
+
+// What a driver reports for an uncompressed image in 64 KiB pages
+static VkMemoryRequirements estimate_memory(const RGImageDesc& desc) {
+  constexpr VkDeviceSize PAGE = 64 * 1024;
+
+  VkDeviceSize texelBytes = 4;
+  if (desc.format == VK_FORMAT_R16G16B16A16_SFLOAT) texelBytes = 8;
+
+  VkDeviceSize size = 0;
+  for (uint32_t level = 0; level < desc.mipLevels; level++) {
+    const VkDeviceSize width = std::max(desc.extent.width >> level, 1u);
+    const VkDeviceSize height = std::max(desc.extent.height >> level, 1u);
+    size += width * height * texelBytes;
+  }
+
+  VkMemoryRequirements requirements;
+  requirements.size = (size + PAGE - 1) / PAGE * PAGE;
+  requirements.alignment = PAGE;
+  requirements.memoryTypeBits = 1;
+  return requirements;
+}
+
+// A shadow map that is resolved into a buffer before the scene color is
+// first written. The two transients are never alive at the same time, so
+// compile has to put them in one memory slot the size of the larger one.
+static void check_transient_aliasing() {
+  const RGImageDesc shadowDesc = {VK_FORMAT_D32_SFLOAT, {2048, 2048}};
+  const RGImageDesc colorDesc = {VK_FORMAT_B8G8R8A8_UNORM, SCREEN_EXTENT};
+
+  RenderGraph graph;
+  const RGResource shadow = graph.create_image("shadow map", shadowDesc);
+  const RGResource color = graph.create_image("scene color", colorDesc);
+  const RGResource mask = graph.import_buffer("shadow mask", VK_NULL_HANDLE);
+  const RGResource swapchain = graph.import_image(
+      "swapchain", VK_NULL_HANDLE, VK_NULL_HANDLE, colorDesc,
+      VK_IMAGE_LAYOUT_UNDEFINED, false);
+  graph.set_output(swapchain, RGUsage::Present);
+
+  VkClearValue clear = {};
+  graph.add_pass("shadow", RGPassType::Graphics)
+      .depth_attachment(shadow)
+      .clear(shadow, clear);
+  graph.add_pass("resolve", RGPassType::Compute)
+      .read(shadow, RGUsage::SampledCompute)
+      .write(mask, RGUsage::StorageWrite);
+  graph.add_pass("scene", RGPassType::Graphics)
+      .color_attachment(color)
+      .clear(color, clear)
+      .read(mask, RGUsage::StorageReadFragment);
+  graph.add_pass("blit", RGPassType::Transfer)
+      .read(color, RGUsage::TransferSrc)
+      .write(swapchain, RGUsage::TransferDst);
+
+  graph.compile_offline(estimate_memory);
+
+  const uint32_t slot = graph.memory_slot(shadow);
+  const VkDeviceSize separateBytes =
+      estimate_memory(shadowDesc).size + estimate_memory(colorDesc).size;
+
+  if (slot == UINT32_MAX || graph.memory_slot(color) != slot) {
+    fprintf(stderr, "Transients with disjoint lifetimes got separate memory\n");
+    std::exit(EXIT_FAILURE);
+  }
+  if (graph.memory_slot_size(slot) >= separateBytes) {
+    fprintf(stderr, "Shared memory slot is %llu bytes, not less than %llu\n",
+            static_cast<unsigned long long>(graph.memory_slot_size(slot)),
+            static_cast<unsigned long long>(separateBytes));
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+// Scene pass followed by a chain of arg post passes, each reading the
+// transient the pass before it wrote
+static void build_post_chain(RenderGraph& graph, int64_t postPasses) {
+  const RGImageDesc desc = {VK_FORMAT_R16G16B16A16_SFLOAT, SCREEN_EXTENT};
+
+  RGResource previous = graph.create_image("scene color", desc);
+  VkClearValue clear = {};
+  graph.add_pass("scene", RGPassType::Graphics)
+      .color_attachment(previous)
+      .clear(previous, clear);
+
+  for (int64_t i = 0; i < postPasses; i++) {
+    const RGResource next = graph.create_image("post", desc);
+    graph.add_pass("post", RGPassType::Compute)
+        .read(previous, RGUsage::SampledCompute)
+        .write(next, RGUsage::StorageWrite);
+    previous = next;
+  }
+
+  const RGResource swapchain = graph.import_image(
+      "swapchain", VK_NULL_HANDLE, VK_NULL_HANDLE,
+      {VK_FORMAT_B8G8R8A8_UNORM, SCREEN_EXTENT}, VK_IMAGE_LAYOUT_UNDEFINED,
+      false);
+  graph.set_output(swapchain, RGUsage::Present);
+  graph.add_pass("blit", RGPassType::Transfer)
+      .read(previous, RGUsage::TransferSrc)
+      .write(swapchain, RGUsage::TransferDst);
+}
+
+// Declares and compiles a graph with arg post passes every iteration, as a
+// rebuild after a settings change does. Checks memory aliasing first.
+static void render_graph_compile(bench::State& state) {
+  check_transient_aliasing();
+
+  while (state.keep_running()) {
+    RenderGraph graph;
+    build_post_chain(graph, state.arg());
+    graph.compile_offline(estimate_memory);
+  }
+
+  state.set_items_per_iteration(state.arg() + 2);
+}
+BENCHMARK(render_graph_compile, 4, 64);
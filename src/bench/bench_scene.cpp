@@ -0,0 +1,126 @@
+#include "bench.h"
+
+#include "vk_objectBuffer.h"
+#include "scene/drawList.h"
+#include "scene/lightScene.h"
+#include "scene/transformStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+// Materials and meshes the draws are spread over, about what a real scene
+// binds in a frame
+constexpr uint32_t DRAW_MATERIALS = 16;
+constexpr uint32_t DRAW_MESHES = 256;
+
+// Builds and sorts a list of arg draws in random material and mesh order
+static void draw_list_build_sort(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+
+  std::mt19937 rng(1);
+  std::vector<uint32_t> materials(count);
+  std::vector<uint32_t> meshes(count);
+  for (uint32_t i = 0; i < count; i++) {
+    materials[i] = rng() % DRAW_MATERIALS;
+    meshes[i] = rng() % DRAW_MESHES;
+  }
+
+  DrawList list;
+  list.reserve(count);
+
+  while (state.keep_running()) {
+    list.clear();
+    for (uint32_t i = 0; i < count; i++) {
+      list.add(materials[i], meshes[i], i);
+    }
+    list.sort();
+    bench::do_not_optimize(list.items().data());
+  }
+
+  state.set_items_per_iteration(count);
+}
+BENCHMARK(draw_list_build_sort, 1000, 100000, 1000000);
+
+// Same path as VulkanEngine::update_transforms followed by ObjectBuffer's
+// flush: world matrices are written straight into the GPUObjectData mirror
+// and the changed objects copied to a stand-in for the mapped frame buffer.
+// Every arg-th object moves each iteration.
+static void fill_object_buffer(bench::State& state, uint32_t count,
+                               uint32_t stride) {
+  TransformStore store;
+  store.set_job_system(&bench::default_jobs());
+  store.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    store.create(INVALID_TRANSFORM,
+                 glm::vec3(float(i % 1000), 0.0f, float(i / 1000)));
+  }
+
+  std::vector<GPUObjectData> mirror(count);
+  std::vector<GPUObjectData> mapped(count);
+
+  char* matrices =
+      reinterpret_cast<char*>(mirror.data()) + offsetof(GPUObjectData,
+                                                        modelMatrix);
+  store.update(matrices, sizeof(GPUObjectData));
+
+  std::vector<TransformId> dirty;
+  float offset = 0.0f;
+  while (state.keep_running()) {
+    state.pause_timing();
+    offset += 0.01f;
+    for (uint32_t i = 0; i < count; i += stride) {
+      store.set_position(i, glm::vec3(float(i % 1000), offset, 0.0f));
+    }
+    state.resume_timing();
+
+    store.update(matrices, sizeof(GPUObjectData));
+
+    // Copy runs of consecutive changed objects at once
+    dirty.assign(store.changed().begin(), store.changed().end());
+    std::sort(dirty.begin(), dirty.end());
+    size_t i = 0;
+    while (i < dirty.size()) {
+      const uint32_t begin = dirty[i];
+      uint32_t end = begin + 1;
+      for (i++; i < dirty.size() && dirty[i] == end; i++) end++;
+      memcpy(&mapped[begin], &mirror[begin],
+             sizeof(GPUObjectData) * (end - begin));
+    }
+    bench::do_not_optimize(mapped.data());
+  }
+
+  state.set_items_per_iteration((count + stride - 1) / stride);
+}
+
+static void object_buffer_fill_all(bench::State& state) {
+  fill_object_buffer(state, static_cast<uint32_t>(state.arg()), 1);
+}
+BENCHMARK(object_buffer_fill_all, 1000, 100000, 1000000);
+
+static void object_buffer_fill_sparse(bench::State& state) {
+  fill_object_buffer(state, static_cast<uint32_t>(state.arg()), 100);
+}
+BENCHMARK(object_buffer_fill_sparse, 100000, 1000000);
+
+// CPU side of the clustered lighting: every light is moved and written to a
+// stand-in for the frame's light array, at the counts of --compare-lights
+static void light_scene_animate(bench::State& state) {
+  LightSceneSettings settings;
+  settings.count = static_cast<uint32_t>(state.arg());
+  settings.extent = glm::vec3(200.0f, 40.0f, 200.0f);
+
+  LightScene scene;
+  scene.generate(settings);
+
+  std::vector<GPULight> lights(settings.count);
+  float time = 0.0f;
+  while (state.keep_running()) {
+    time += 0.016f;
+    scene.animate(time, lights.data(), settings.count);
+    bench::do_not_optimize(lights.data());
+  }
+
+  state.set_items_per_iteration(settings.count);
+}
+BENCHMARK(light_scene_animate, 10, 1000, 10000);
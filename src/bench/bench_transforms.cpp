@@ -0,0 +1,94 @@
+#include "bench.h"
+
+#include "scene/transformStore.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+// Flat store of arg root transforms, every transform rotated each iteration
+static void transforms_update_flat(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+
+  TransformStore store;
+  store.set_job_system(&bench::default_jobs());
+  store.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    store.create(INVALID_TRANSFORM, glm::vec3(float(i % 1000), 0.0f,
+                                              float(i / 1000)));
+  }
+
+  std::vector<glm::mat4> out(count);
+  store.update(out.data());
+
+  float angle = 0.0f;
+  while (state.keep_running()) {
+    state.pause_timing();
+    angle += 0.01f;
+    const glm::quat rotation = glm::angleAxis(angle, glm::vec3(0, 1, 0));
+    for (uint32_t i = 0; i < count; i++) store.set_rotation(i, rotation);
+    state.resume_timing();
+
+    bench::do_not_optimize(store.update(out.data()));
+  }
+
+  state.set_items_per_iteration(count);
+}
+BENCHMARK(transforms_update_flat, 1000, 100000, 1000000);
+
+// Roots with a chain of children below each of them, only the roots move so
+// the dirty flags have to be propagated down the hierarchy
+static void transforms_update_hierarchy(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+  const uint32_t chainLength = 8;
+
+  TransformStore store;
+  store.set_job_system(&bench::default_jobs());
+  store.reserve(count);
+  std::vector<TransformId> roots;
+  for (uint32_t i = 0; i < count; i++) {
+    if (i % chainLength == 0) {
+      roots.push_back(store.create());
+    } else {
+      store.create(i - 1, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+  }
+
+  std::vector<glm::mat4> out(count);
+  store.update(out.data());
+
+  float offset = 0.0f;
+  while (state.keep_running()) {
+    state.pause_timing();
+    offset += 0.01f;
+    for (TransformId root : roots) {
+      store.set_position(root, glm::vec3(offset, 0.0f, float(root)));
+    }
+    state.resume_timing();
+
+    bench::do_not_optimize(store.update(out.data()));
+  }
+
+  state.set_items_per_iteration(count);
+}
+BENCHMARK(transforms_update_hierarchy, 1000, 100000, 1000000);
+
+// Nothing changed, measures the cost of an idle update. Items are the
+// matrices recomputed, which should stay 0, so only the time is meaningful.
+static void transforms_update_static(bench::State& state) {
+  const uint32_t count = static_cast<uint32_t>(state.arg());
+
+  TransformStore store;
+  store.reserve(count);
+  for (uint32_t i = 0; i < count; i++) store.create();
+
+  std::vector<glm::mat4> out(count);
+  store.update(out.data());
+
+  size_t written = 0;
+  while (state.keep_running()) {
+    written = store.update(out.data());
+    bench::do_not_optimize(written);
+  }
+
+  state.set_items_per_iteration(static_cast<int64_t>(written));
+}
+BENCHMARK(transforms_update_static, 1000000);
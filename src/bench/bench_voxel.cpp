@@ -0,0 +1,139 @@
+#include "bench.h"
+
+#include "voxel/chunkRemesher.h"
+#include "voxel/greedyMesher.h"
+#include "voxel/voxelEditStress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+// Rolling hills of stone under a grass layer, about what a block world looks
+// like. Neighbouring chunks are filled as well so the borders are meshed
+// against real blocks.
+static void fill_terrain(VoxelWorld* world, BlockId stone, BlockId grass) {
+  for (int32_t z = -CHUNK_SIZE; z < 2 * CHUNK_SIZE; z++) {
+    for (int32_t x = -CHUNK_SIZE; x < 2 * CHUNK_SIZE; x++) {
+      const int32_t height = static_cast<int32_t>(
+          12.0f + 6.0f * std::sin(x * 0.15f) * std::cos(z * 0.1f));
+      for (int32_t y = 0; y < height; y++) {
+        world->set_block({x, y, z}, (y == height - 1) ? grass : stone);
+      }
+    }
+  }
+}
+
+// Every block randomly solid, the worst case for merging
+static void fill_noise(VoxelWorld* world, BlockId stone, BlockId grass) {
+  std::mt19937 rng(1);
+  for (int32_t y = -CHUNK_SIZE; y < 2 * CHUNK_SIZE; y++) {
+    for (int32_t z = -CHUNK_SIZE; z < 2 * CHUNK_SIZE; z++) {
+      for (int32_t x = -CHUNK_SIZE; x < 2 * CHUNK_SIZE; x++) {
+        const uint32_t value = rng() % 4;
+        if (value == 0) world->set_block({x, y, z}, stone);
+        if (value == 1) world->set_block({x, y, z}, grass);
+      }
+    }
+  }
+}
+
+// Meshes chunk (0, 0, 0) of a terrain (arg 0) or noise (arg 1) world, items
+// are the blocks of the chunk
+static void voxel_mesh_chunk(bench::State& state) {
+  VoxelWorld world;
+  BlockType type;
+  type.name = "Stone";
+  const BlockId stone = world.add_block_type(type);
+  type.name = "Grass";
+  const BlockId grass = world.add_block_type(type);
+
+  if (state.arg() == 0) {
+    fill_terrain(&world, stone, grass);
+  } else {
+    fill_noise(&world, stone, grass);
+  }
+
+  std::vector<Vertex> vertices;
+  while (state.keep_running()) {
+    vertices.clear();
+    const ChunkMeshStats stats = mesh_chunk(world, {0, 0, 0}, &vertices);
+    bench::do_not_optimize(stats);
+    bench::do_not_optimize(vertices.data());
+  }
+
+  state.set_items_per_iteration(CHUNK_VOLUME);
+}
+BENCHMARK(voxel_mesh_chunk, 0, 1);
+
+// Random writes into one chunk using arg block types, so the palette grows to
+// arg entries and the indices to the matching width
+static void voxel_chunk_set(bench::State& state) {
+  const uint32_t types = static_cast<uint32_t>(state.arg());
+  constexpr uint32_t EDITS = 4096;
+
+  std::mt19937 rng(1);
+  std::vector<uint32_t> positions(EDITS);
+  std::vector<BlockId> blocks(EDITS);
+  for (uint32_t i = 0; i < EDITS; i++) {
+    positions[i] = rng() % CHUNK_VOLUME;
+    blocks[i] = static_cast<BlockId>(rng() % (types + 1));
+  }
+
+  Chunk chunk;
+  while (state.keep_running()) {
+    for (uint32_t i = 0; i < EDITS; i++) {
+      const int32_t position = static_cast<int32_t>(positions[i]);
+      chunk.set(position % CHUNK_SIZE, position / (CHUNK_SIZE * CHUNK_SIZE),
+                (position / CHUNK_SIZE) % CHUNK_SIZE, blocks[i]);
+    }
+    bench::do_not_optimize(chunk);
+  }
+
+  state.set_items_per_iteration(EDITS);
+}
+BENCHMARK(voxel_chunk_set, 2, 16, 256);
+
+// arg random edits to the terrain world, then the chunks they dirtied are
+// remeshed on the worker threads and collected. Items are the edits.
+static void voxel_remesh_edits(bench::State& state) {
+  VoxelWorld world;
+  BlockType type;
+  type.name = "Stone";
+  const BlockId stone = world.add_block_type(type);
+  type.name = "Grass";
+  const BlockId grass = world.add_block_type(type);
+  fill_terrain(&world, stone, grass);
+
+  std::vector<ChunkCoord> dirty;
+  world.take_dirty_chunks(&dirty);
+
+  VoxelEditStress edits;
+  edits.init(world, static_cast<float>(state.arg()), 1);
+
+  ChunkRemesher remesher;
+  remesher.init(world, &bench::default_jobs());
+
+  ChunkMeshResult result;
+  while (state.keep_running()) {
+    edits.update(&world, 1.0);
+
+    dirty.clear();
+    world.take_dirty_chunks(&dirty);
+    for (const ChunkCoord& coord : dirty) {
+      while (!remesher.submit(coord)) {
+        remesher.pop_result(&result);
+      }
+    }
+
+    while (remesher.in_flight() > 0) {
+      if (!remesher.pop_result(&result)) std::this_thread::yield();
+    }
+    bench::do_not_optimize(result.vertices.data());
+  }
+
+  remesher.shutdown();
+
+  state.set_items_per_iteration(state.arg());
+}
+BENCHMARK(voxel_remesh_edits, 1, 64);
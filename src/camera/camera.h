@@ -90,6 +90,8 @@ class CameraPositioner_FirstPerson final : public CameraPositionerInterface {
 
   virtual glm::vec3 getPosition() const override { return _cameraPosition; }
 
+  glm::quat getOrientation() const { return _cameraOrientation; }
+
   void setUpVector(const glm::vec3& up) {
     const glm::mat4 view = getViewMatrix();
     const glm::vec3 dir = -glm::vec3(view[0][2], view[1][2], view[2][2]);
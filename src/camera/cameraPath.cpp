@@ -0,0 +1,124 @@
+#include "cameraPath.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+bool CameraPath::load(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open camera path " << filename << std::endl;
+    return false;
+  }
+
+  _keyframes.clear();
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream stream(line);
+    CameraKeyframe keyframe;
+    stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >>
+        keyframe.position.z >> keyframe.orientation.w >>
+        keyframe.orientation.x >> keyframe.orientation.y >>
+        keyframe.orientation.z;
+
+    if (stream.fail()) {
+      std::cerr << filename << ":" << lineNumber << ": invalid keyframe"
+                << std::endl;
+      return false;
+    }
+
+    if (!_keyframes.empty() && keyframe.time < _keyframes.back().time) {
+      std::cerr << filename << ":" << lineNumber
+                << ": keyframes are not in increasing time" << std::endl;
+      return false;
+    }
+
+    keyframe.orientation = glm::normalize(keyframe.orientation);
+    _keyframes.push_back(keyframe);
+  }
+
+  if (_keyframes.empty()) {
+    std::cerr << "Camera path " << filename << " has no keyframes"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool CameraPath::save(const std::string& filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "Failed to write camera path " << filename << std::endl;
+    return false;
+  }
+
+  file << "# time px py pz qw qx qy qz\n";
+  file << std::setprecision(7);
+  for (const CameraKeyframe& keyframe : _keyframes) {
+    file << keyframe.time << ' ' << keyframe.position.x << ' '
+         << keyframe.position.y << ' ' << keyframe.position.z << ' '
+         << keyframe.orientation.w << ' ' << keyframe.orientation.x << ' '
+         << keyframe.orientation.y << ' ' << keyframe.orientation.z << '\n';
+  }
+
+  return file.good();
+}
+
+void CameraPath::add_keyframe(const CameraKeyframe& keyframe) {
+  _keyframes.push_back(keyframe);
+}
+
+static glm::vec3 catmull_rom(const glm::vec3& p0, const glm::vec3& p1,
+                             const glm::vec3& p2, const glm::vec3& p3,
+                             float t) {
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+  return 0.5f * ((2.0f * p1) + (-p0 + p2) * t +
+                 (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                 (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+
+void CameraPath::sample(float time, glm::vec3* outPosition,
+                        glm::quat* outOrientation) const {
+  if (_keyframes.size() == 1 || time <= _keyframes.front().time) {
+    *outPosition = _keyframes.front().position;
+    *outOrientation = _keyframes.front().orientation;
+    return;
+  }
+  if (time >= _keyframes.back().time) {
+    *outPosition = _keyframes.back().position;
+    *outOrientation = _keyframes.back().orientation;
+    return;
+  }
+
+  // First keyframe after time, the segment runs from the one before it
+  auto next = std::upper_bound(_keyframes.begin(), _keyframes.end(), time,
+                               [](float t, const CameraKeyframe& keyframe) {
+                                 return t < keyframe.time;
+                               });
+  const size_t i2 = static_cast<size_t>(next - _keyframes.begin());
+  const size_t i1 = i2 - 1;
+
+  // The end points are repeated so the curve passes through them
+  const size_t i0 = i1 > 0 ? i1 - 1 : i1;
+  const size_t i3 = std::min(i2 + 1, _keyframes.size() - 1);
+
+  const CameraKeyframe& k1 = _keyframes[i1];
+  const CameraKeyframe& k2 = _keyframes[i2];
+
+  const float span = k2.time - k1.time;
+  const float t = span > 0.0f ? (time - k1.time) / span : 1.0f;
+
+  *outPosition = catmull_rom(_keyframes[i0].position, k1.position,
+                             k2.position, _keyframes[i3].position, t);
+  *outOrientation =
+      glm::normalize(glm::slerp(k1.orientation, k2.orientation, t));
+}
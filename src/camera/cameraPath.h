@@ -0,0 +1,79 @@
+#ifndef E54B1F93_8A2D_4C67_B3E1_7D09C6A4F218
+#define E54B1F93_8A2D_4C67_B3E1_7D09C6A4F218
+
+#include "camera.h"
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Orientation is the view rotation, as kept by CameraPositioner_FirstPerson
+struct CameraKeyframe {
+  float time;
+  glm::vec3 position;
+  glm::quat orientation;
+};
+
+// Timed camera keyframes. Positions are interpolated with a Catmull-Rom
+// spline through the keyframes, orientations with slerp.
+//
+// Files are plain text with one keyframe per line:
+//   time px py pz qw qx qy qz
+// Empty lines and lines starting with # are skipped.
+class CameraPath {
+ public:
+  bool load(const std::string& filename);
+
+  bool save(const std::string& filename) const;
+
+  // Keyframes have to be added in increasing time
+  void add_keyframe(const CameraKeyframe& keyframe);
+
+  void clear(void) { _keyframes.clear(); }
+
+  bool empty(void) const { return _keyframes.empty(); }
+
+  size_t size(void) const { return _keyframes.size(); }
+
+  float duration(void) const {
+    return _keyframes.empty() ? 0.0f : _keyframes.back().time;
+  }
+
+  // Times outside of the path are clamped to its ends
+  void sample(float time, glm::vec3* outPosition,
+              glm::quat* outOrientation) const;
+
+ private:
+  std::vector<CameraKeyframe> _keyframes;
+};
+
+// Plays a CameraPath back, driven only by the time it is given
+class CameraPositioner_Path final : public CameraPositionerInterface {
+ public:
+  void setPath(const CameraPath* path) {
+    _path = path;
+    setTime(0.0f);
+  }
+
+  void setTime(float time) {
+    if (_path == nullptr || _path->empty()) return;
+    _path->sample(time, &_cameraPosition, &_cameraOrientation);
+  }
+
+  virtual glm::mat4 getViewMatrix() const override {
+    const glm::mat4 t = glm::translate(glm::mat4(1.0), -_cameraPosition);
+    const glm::mat4 r = glm::mat4_cast(_cameraOrientation);
+    return r * t;
+  }
+
+  virtual glm::vec3 getPosition() const override { return _cameraPosition; }
+
+ private:
+  const CameraPath* _path{nullptr};
+  glm::vec3 _cameraPosition = glm::vec3(0.0f);
+  glm::quat _cameraOrientation = glm::quat(glm::vec3(0));
+};
+
+#endif /* E54B1F93_8A2D_4C67_B3E1_7D09C6A4F218 */
@@ -0,0 +1,101 @@
+#ifndef C9D3A7E1_5F28_4B46_8E0C_B1A6F4D2E857
+#define C9D3A7E1_5F28_4B46_8E0C_B1A6F4D2E857
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+enum class FrustumTest { Outside, Intersects, Inside };
+
+// View frustum as six planes extracted from a view projection matrix
+// (Gribb and Hartmann). Plane normals point inwards and are normalized, so a
+// sphere is outside when its signed distance to any plane is below -radius.
+class Frustum {
+ public:
+  Frustum() = default;
+
+  explicit Frustum(const glm::mat4& viewProj) {
+    const glm::mat4 m = glm::transpose(viewProj);
+    _planes[0] = m[3] + m[0];  // left
+    _planes[1] = m[3] - m[0];  // right
+    _planes[2] = m[3] + m[1];  // bottom, top with a flipped Y
+    _planes[3] = m[3] - m[1];
+    _planes[4] = m[3] + m[2];  // near, conservative for a [0, 1] depth range
+    _planes[5] = m[3] - m[2];  // far
+
+    for (glm::vec4& plane : _planes) {
+      plane /= glm::length(glm::vec3(plane));
+    }
+  }
+
+  bool intersects_sphere(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : _planes) {
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+  }
+
+  // Box against every plane through the corner furthest along the plane
+  // normal. Like the sphere test it may keep boxes near a frustum corner.
+  bool intersects_box(const glm::vec3& min, const glm::vec3& max) const {
+    for (const glm::vec4& plane : _planes) {
+      const glm::vec3 normal(plane);
+      const glm::vec3 corner =
+          glm::mix(min, max, glm::greaterThan(normal, glm::vec3(0.0f)));
+      if (glm::dot(normal, corner) + plane.w < 0.0f) return false;
+    }
+    return true;
+  }
+
+  // Also reports boxes that lie inside every plane, so a hierarchy can skip
+  // testing anything below them
+  FrustumTest test_box(const glm::vec3& min, const glm::vec3& max) const {
+    FrustumTest result = FrustumTest::Inside;
+    for (const glm::vec4& plane : _planes) {
+      const glm::vec3 normal(plane);
+      const glm::bvec3 positive = glm::greaterThan(normal, glm::vec3(0.0f));
+      const glm::vec3 outer = glm::mix(min, max, positive);
+      if (glm::dot(normal, outer) + plane.w < 0.0f) return FrustumTest::Outside;
+
+      const glm::vec3 inner = glm::mix(max, min, positive);
+      if (glm::dot(normal, inner) + plane.w < 0.0f) {
+        result = FrustumTest::Intersects;
+      }
+    }
+    return result;
+  }
+
+  // Spheres are xyz center and w radius. Writes 1 for every sphere that
+  // intersects the frustum and 0 otherwise, returns the number of visible
+  // spheres.
+  size_t cull_spheres(const glm::vec4* spheres, size_t count,
+                      uint8_t* outVisible) const {
+    size_t visible = 0;
+    for (size_t i = 0; i < count; i++) {
+      const bool inside =
+          intersects_sphere(glm::vec3(spheres[i]), spheres[i].w);
+      outVisible[i] = inside ? 1 : 0;
+      visible += inside ? 1 : 0;
+    }
+    return visible;
+  }
+
+ private:
+  glm::vec4 _planes[6];
+};
+
+// Bounding sphere of a model space sphere after a transform that may scale
+// non-uniformly
+inline glm::vec4 transform_sphere(const glm::mat4& transform,
+                                  const glm::vec3& center, float radius) {
+  const glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+  const float scale = std::max({glm::length(glm::vec3(transform[0])),
+                                glm::length(glm::vec3(transform[1])),
+                                glm::length(glm::vec3(transform[2]))});
+  return glm::vec4(worldCenter, radius * scale);
+}
+
+#endif /* C9D3A7E1_5F28_4B46_8E0C_B1A6F4D2E857 */
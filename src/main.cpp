@@ -1,8 +1,11 @@
 #include "vk_engine.h"
+#include "vk_config.h"
 
 int main(int argc, char *argv[]) {
   VulkanEngine engine;
 
+  engine._config = parse_engine_config(argc, argv);
+
   engine.init();
 
   engine.run();
@@ -0,0 +1,407 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <utility>
+
+// Most bins the centers are sorted into per axis, the split candidates are
+// the planes between them. Small nodes use one bin per object.
+constexpr uint32_t SAH_BINS = 16;
+
+// Cost of visiting a node relative to testing an object's box
+constexpr float TRAVERSAL_COST = 1.0f;
+
+// Larger leaves are split even when the SAH prefers one leaf, e.g. for many
+// objects at the same spot
+constexpr uint32_t MAX_LEAF_OBJECTS = 8;
+
+// Set on a traversal stack entry whose node is known to be inside the frustum
+constexpr uint32_t INSIDE_BIT = 1u << 31;
+
+// Distance along the ray where it enters the box, FLT_MAX when it misses it
+// within maxDistance
+static float ray_box(const Aabb& box, const glm::vec3& origin,
+                     const glm::vec3& inverseDirection, float maxDistance) {
+  const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+  const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+  const glm::vec3 tNear = glm::min(t0, t1);
+  const glm::vec3 tFar = glm::max(t0, t1);
+
+  const float enter = std::max({tNear.x, tNear.y, tNear.z, 0.0f});
+  const float exit = std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+  return enter <= exit ? enter : FLT_MAX;
+}
+
+static float point_box_distance(const Aabb& box, const glm::vec3& point) {
+  const glm::vec3 outside =
+      glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0.0f));
+  return glm::length(outside);
+}
+
+void Bvh::build(const uint32_t* ids, const Aabb* bounds, uint32_t count) {
+  clear();
+  if (count == 0) return;
+
+  _objects.assign(ids, ids + count);
+  _bounds.assign(bounds, bounds + count);
+  _centers.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    _centers[i] = _bounds[i].center();
+  }
+
+  // A binary tree with at least one object per leaf
+  _nodes.reserve(2 * static_cast<size_t>(count) - 1);
+  _parents.reserve(2 * static_cast<size_t>(count) - 1);
+
+  _nodes.push_back({{}, 0, count});
+  _parents.push_back(UINT32_MAX);
+  update_node(0);
+
+  std::vector<uint32_t> stack{0};
+  while (!stack.empty()) {
+    const uint32_t node = stack.back();
+    stack.pop_back();
+
+    uint32_t middle;
+    if (!split(node, &middle)) continue;
+
+    const uint32_t first = _nodes[node].first;
+    const uint32_t end = first + _nodes[node].count;
+    const uint32_t left = static_cast<uint32_t>(_nodes.size());
+
+    _nodes.push_back({{}, first, middle - first});
+    _nodes.push_back({{}, middle, end - middle});
+    _parents.push_back(node);
+    _parents.push_back(node);
+    update_node(left);
+    update_node(left + 1);
+
+    _nodes[node].first = left;
+    _nodes[node].count = 0;
+
+    stack.push_back(left);
+    stack.push_back(left + 1);
+  }
+
+  const uint32_t maxId = *std::max_element(_objects.begin(), _objects.end());
+  _slotOf.assign(static_cast<size_t>(maxId) + 1, UINT32_MAX);
+  _leafOf.resize(count);
+  for (uint32_t node = 0; node < _nodes.size(); node++) {
+    const Node& leaf = _nodes[node];
+    if (leaf.count == 0) continue;
+    for (uint32_t slot = leaf.first; slot < leaf.first + leaf.count; slot++) {
+      _slotOf[_objects[slot]] = slot;
+      _leafOf[slot] = node;
+    }
+  }
+
+  _nodeDirty.assign(_nodes.size(), 0);
+}
+
+void Bvh::clear() {
+  _nodes.clear();
+  _parents.clear();
+  _objects.clear();
+  _bounds.clear();
+  _centers.clear();
+  _slotOf.clear();
+  _leafOf.clear();
+  _dirtyNodes.clear();
+  _nodeDirty.clear();
+}
+
+bool Bvh::split(uint32_t node, uint32_t* outMiddle) {
+  const uint32_t first = _nodes[node].first;
+  const uint32_t count = _nodes[node].count;
+  const uint32_t end = first + count;
+  if (count == 1) return false;
+
+  Aabb centerBounds;
+  for (uint32_t i = first; i < end; i++) {
+    centerBounds.grow(_centers[i]);
+  }
+
+  struct Bin {
+    Aabb bounds;
+    uint32_t count{0};
+  };
+
+  const uint32_t binCount = std::min(SAH_BINS, count);
+
+  float bestCost = FLT_MAX;
+  int bestAxis = -1;
+  uint32_t bestPlane = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float low = centerBounds.min[axis];
+    const float extent = centerBounds.max[axis] - low;
+    if (extent <= 0.0f) continue;
+
+    const float scale = binCount / extent;
+    Bin bins[SAH_BINS];
+    for (uint32_t i = first; i < end; i++) {
+      const uint32_t bin = std::min(
+          binCount - 1,
+          static_cast<uint32_t>((_centers[i][axis] - low) * scale));
+      bins[bin].bounds.grow(_bounds[i]);
+      bins[bin].count++;
+    }
+
+    // Area and count right of every plane, then sweep from the left
+    float rightArea[SAH_BINS - 1];
+    uint32_t rightCount[SAH_BINS - 1];
+    Aabb right;
+    uint32_t objects = 0;
+    for (uint32_t plane = binCount - 1; plane > 0; plane--) {
+      right.grow(bins[plane].bounds);
+      objects += bins[plane].count;
+      rightArea[plane - 1] = right.half_area();
+      rightCount[plane - 1] = objects;
+    }
+
+    Aabb left;
+    objects = 0;
+    for (uint32_t plane = 0; plane < binCount - 1; plane++) {
+      left.grow(bins[plane].bounds);
+      objects += bins[plane].count;
+      if (objects == 0 || rightCount[plane] == 0) continue;
+
+      const float cost =
+          objects * left.half_area() + rightCount[plane] * rightArea[plane];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestPlane = plane;
+      }
+    }
+  }
+
+  const float area = _nodes[node].bounds.half_area();
+  const bool keepLeaf =
+      bestAxis < 0 ||
+      (area > 0.0f && TRAVERSAL_COST + bestCost / area >= count);
+  if (keepLeaf && count <= MAX_LEAF_OBJECTS) return false;
+
+  uint32_t middle = first;
+  if (bestAxis >= 0) {
+    const float low = centerBounds.min[bestAxis];
+    const float scale =
+        binCount / (centerBounds.max[bestAxis] - centerBounds.min[bestAxis]);
+    for (uint32_t i = first; i < end; i++) {
+      const uint32_t bin = std::min(
+          binCount - 1,
+          static_cast<uint32_t>((_centers[i][bestAxis] - low) * scale));
+      if (bin > bestPlane) continue;
+
+      std::swap(_objects[i], _objects[middle]);
+      std::swap(_bounds[i], _bounds[middle]);
+      std::swap(_centers[i], _centers[middle]);
+      middle++;
+    }
+  }
+
+  // Centers that coincide give the SAH nothing to split, halve the range
+  if (middle == first || middle == end) middle = first + count / 2;
+
+  *outMiddle = middle;
+  return true;
+}
+
+void Bvh::update_node(uint32_t node) {
+  Node& current = _nodes[node];
+  current.bounds = Aabb();
+  if (current.count == 0) {
+    current.bounds.grow(_nodes[current.first].bounds);
+    current.bounds.grow(_nodes[current.first + 1].bounds);
+    return;
+  }
+
+  for (uint32_t i = current.first; i < current.first + current.count; i++) {
+    current.bounds.grow(_bounds[i]);
+  }
+}
+
+void Bvh::set_bounds(uint32_t id, const Aabb& bounds) {
+  if (!contains(id)) return;
+
+  const uint32_t slot = _slotOf[id];
+  _bounds[slot] = bounds;
+
+  const uint32_t leaf = _leafOf[slot];
+  if (!_nodeDirty[leaf]) {
+    _nodeDirty[leaf] = 1;
+    _dirtyNodes.push_back(leaf);
+  }
+}
+
+void Bvh::refit() {
+  if (_dirtyNodes.empty()) return;
+
+  // Queue the ancestors, a path ends at the first one already queued
+  const size_t leaves = _dirtyNodes.size();
+  for (size_t i = 0; i < leaves; i++) {
+    uint32_t node = _parents[_dirtyNodes[i]];
+    while (node != UINT32_MAX && !_nodeDirty[node]) {
+      _nodeDirty[node] = 1;
+      _dirtyNodes.push_back(node);
+      node = _parents[node];
+    }
+  }
+
+  // Children are stored after their parent, so going backwards updates them
+  // first
+  std::sort(_dirtyNodes.begin(), _dirtyNodes.end(),
+            [](uint32_t a, uint32_t b) { return a > b; });
+  for (uint32_t node : _dirtyNodes) {
+    update_node(node);
+    _nodeDirty[node] = 0;
+  }
+  _dirtyNodes.clear();
+}
+
+void Bvh::query_frustum(const Frustum& frustum,
+                        std::vector<uint32_t>* out) const {
+  if (_nodes.empty()) return;
+
+  std::vector<uint32_t> stack;
+  stack.reserve(64);
+  stack.push_back(0);
+
+  while (!stack.empty()) {
+    const uint32_t entry = stack.back();
+    stack.pop_back();
+
+    const Node& node = _nodes[entry & ~INSIDE_BIT];
+    uint32_t inside = entry & INSIDE_BIT;
+    if (!inside) {
+      const FrustumTest test =
+          frustum.test_box(node.bounds.min, node.bounds.max);
+      if (test == FrustumTest::Outside) continue;
+      if (test == FrustumTest::Inside) inside = INSIDE_BIT;
+    }
+
+    if (node.count == 0) {
+      stack.push_back(node.first | inside);
+      stack.push_back((node.first + 1) | inside);
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      if (inside || frustum.intersects_box(_bounds[i].min, _bounds[i].max)) {
+        out->push_back(_objects[i]);
+      }
+    }
+  }
+}
+
+bool Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction,
+                  float maxDistance, BvhHit* outHit) const {
+  BvhHit best;
+  best.distance = maxDistance;
+  if (_nodes.empty()) return false;
+
+  const glm::vec3 inverseDirection = 1.0f / direction;
+  if (ray_box(_nodes[0].bounds, origin, inverseDirection, maxDistance) ==
+      FLT_MAX) {
+    return false;
+  }
+
+  // Nodes with the distance the ray enters them, nearer children are
+  // visited first so far ones are mostly skipped
+  std::vector<std::pair<uint32_t, float>> stack;
+  stack.reserve(64);
+  stack.push_back({0, 0.0f});
+
+  while (!stack.empty()) {
+    const auto [index, enter] = stack.back();
+    stack.pop_back();
+    if (enter >= best.distance) continue;
+
+    const Node& node = _nodes[index];
+    if (node.count == 0) {
+      const float left = ray_box(_nodes[node.first].bounds, origin,
+                                 inverseDirection, best.distance);
+      const float right = ray_box(_nodes[node.first + 1].bounds, origin,
+                                  inverseDirection, best.distance);
+      if (left <= right) {
+        if (right != FLT_MAX) stack.push_back({node.first + 1, right});
+        if (left != FLT_MAX) stack.push_back({node.first, left});
+      } else {
+        if (left != FLT_MAX) stack.push_back({node.first, left});
+        if (right != FLT_MAX) stack.push_back({node.first + 1, right});
+      }
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      const float distance =
+          ray_box(_bounds[i], origin, inverseDirection, best.distance);
+      if (distance < best.distance) {
+        best.object = _objects[i];
+        best.distance = distance;
+      }
+    }
+  }
+
+  if (best.object == UINT32_MAX) return false;
+  *outHit = best;
+  return true;
+}
+
+bool Bvh::nearest(const glm::vec3& point, float maxDistance,
+                  BvhHit* outHit) const {
+  BvhHit best;
+  best.distance = maxDistance;
+  if (_nodes.empty()) return false;
+
+  std::vector<std::pair<uint32_t, float>> stack;
+  stack.reserve(64);
+  stack.push_back({0, point_box_distance(_nodes[0].bounds, point)});
+
+  while (!stack.empty()) {
+    const auto [index, distance] = stack.back();
+    stack.pop_back();
+    if (distance >= best.distance) continue;
+
+    const Node& node = _nodes[index];
+    if (node.count == 0) {
+      const float left =
+          point_box_distance(_nodes[node.first].bounds, point);
+      const float right =
+          point_box_distance(_nodes[node.first + 1].bounds, point);
+      if (left <= right) {
+        stack.push_back({node.first + 1, right});
+        stack.push_back({node.first, left});
+      } else {
+        stack.push_back({node.first, left});
+        stack.push_back({node.first + 1, right});
+      }
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      const float objectDistance = point_box_distance(_bounds[i], point);
+      if (objectDistance < best.distance) {
+        best.object = _objects[i];
+        best.distance = objectDistance;
+      }
+    }
+  }
+
+  if (best.object == UINT32_MAX) return false;
+  *outHit = best;
+  return true;
+}
+
+float Bvh::sah_cost() const {
+  if (_nodes.empty()) return 0.0f;
+
+  float cost = 0.0f;
+  for (const Node& node : _nodes) {
+    const float perNode = node.count == 0 ? TRAVERSAL_COST
+                                          : static_cast<float>(node.count);
+    cost += perNode * node.bounds.half_area();
+  }
+
+  const float rootArea = _nodes[0].bounds.half_area();
+  return rootArea > 0.0f ? cost / rootArea : cost;
+}
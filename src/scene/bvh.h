@@ -0,0 +1,127 @@
+#ifndef F4C8A2E6_3B71_4D59_8E1A_6C2F9B5D7A30
+#define F4C8A2E6_3B71_4D59_8E1A_6C2F9B5D7A30
+
+#include "camera/frustum.h"
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Axis aligned box, empty until something is added to it
+struct Aabb {
+  glm::vec3 min{FLT_MAX};
+  glm::vec3 max{-FLT_MAX};
+
+  void grow(const glm::vec3& point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+
+  void grow(const Aabb& other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+
+  glm::vec3 center(void) const { return (min + max) * 0.5f; }
+
+  // Half the surface area, the SAH only needs areas relative to each other
+  float half_area(void) const {
+    const glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+  }
+};
+
+// Box around a sphere stored as xyz center and w radius
+inline Aabb sphere_bounds(const glm::vec4& sphere) {
+  const glm::vec3 center(sphere);
+  return {center - sphere.w, center + sphere.w};
+}
+
+struct BvhHit {
+  uint32_t object{UINT32_MAX};
+  float distance{FLT_MAX};
+};
+
+// Bounding volume hierarchy over object boxes. Objects are identified by
+// caller chosen ids, the engine uses transform ids. The tree is built top down
+// with the binned surface area heuristic. Moving objects only refit the boxes
+// of the nodes above them, which keeps the topology: that stays fast as long
+// as objects move within their neighbourhood, a scene that changes a lot
+// should be rebuilt now and then.
+class Bvh {
+ public:
+  // Replaces the tree with one over count objects
+  void build(const uint32_t* ids, const Aabb* bounds, uint32_t count);
+
+  void clear(void);
+
+  uint32_t size(void) const { return static_cast<uint32_t>(_objects.size()); }
+
+  uint32_t node_count(void) const {
+    return static_cast<uint32_t>(_nodes.size());
+  }
+
+  bool contains(uint32_t id) const {
+    return id < _slotOf.size() && _slotOf[id] != UINT32_MAX;
+  }
+
+  // Stores new bounds of an object, the tree picks them up in refit(). Ids
+  // that are not in the tree are ignored.
+  void set_bounds(uint32_t id, const Aabb& bounds);
+
+  // Recomputes the nodes above objects moved since the last refit
+  void refit(void);
+
+  // Appends the ids of the objects whose boxes intersect the frustum
+  void query_frustum(const Frustum& frustum, std::vector<uint32_t>* out) const;
+
+  // Closest object box the ray enters within maxDistance. The direction has to
+  // be normalized, a ray starting inside a box hits it at distance 0.
+  bool raycast(const glm::vec3& origin, const glm::vec3& direction,
+               float maxDistance, BvhHit* outHit) const;
+
+  // Object box closest to the point within maxDistance, points inside a box
+  // are at distance 0
+  bool nearest(const glm::vec3& point, float maxDistance,
+               BvhHit* outHit) const;
+
+  // Expected cost of a query relative to testing a single box, grows when
+  // refits stretch the nodes
+  float sah_cost(void) const;
+
+ private:
+  // Leaves hold count objects from first on in _objects. Inner nodes have a
+  // count of 0 and their children at first and first + 1, always after the
+  // parent.
+  struct Node {
+    Aabb bounds;
+    uint32_t first;
+    uint32_t count;
+  };
+
+  // Splits the node's objects at the cheapest of the binned planes, returns
+  // false when keeping them in one leaf is cheaper
+  bool split(uint32_t node, uint32_t* outMiddle);
+
+  void update_node(uint32_t node);
+
+  std::vector<Node> _nodes;
+  std::vector<uint32_t> _parents;
+
+  // Object ids and boxes in leaf order, so a leaf reads a contiguous range
+  std::vector<uint32_t> _objects;
+  std::vector<Aabb> _bounds;
+  std::vector<glm::vec3> _centers;
+
+  // Position in _objects by id, and the leaf of each position
+  std::vector<uint32_t> _slotOf;
+  std::vector<uint32_t> _leafOf;
+
+  // Nodes that refit() recomputes, flagged to queue each only once
+  std::vector<uint32_t> _dirtyNodes;
+  std::vector<uint8_t> _nodeDirty;
+};
+
+#endif /* F4C8A2E6_3B71_4D59_8E1A_6C2F9B5D7A30 */
@@ -0,0 +1,48 @@
+#include "drawList.h"
+
+#include <algorithm>
+
+// The key is sorted 16 bits at a time
+constexpr uint32_t RADIX_BITS = 16;
+constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+// Below this many draws a comparison sort is faster than the histograms
+constexpr size_t MIN_RADIX_SORT = 256;
+
+void DrawList::sort() {
+  const size_t count = _items.size();
+
+  if (count < MIN_RADIX_SORT) {
+    std::stable_sort(
+        _items.begin(), _items.end(),
+        [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+    return;
+  }
+
+  // LSD radix sort, which is stable. Passes where every key has the same
+  // digit are skipped, with few materials and meshes only one or two run.
+  std::vector<uint32_t> histogram(RADIX_SIZE);
+  _sorted.resize(count);
+
+  for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS) {
+    std::fill(histogram.begin(), histogram.end(), 0);
+    for (const DrawItem& item : _items) {
+      histogram[(item.key >> shift) & (RADIX_SIZE - 1)]++;
+    }
+
+    const uint32_t firstDigit = (_items[0].key >> shift) & (RADIX_SIZE - 1);
+    if (histogram[firstDigit] == count) continue;
+
+    uint32_t offset = 0;
+    for (uint32_t& bucket : histogram) {
+      const uint32_t bucketCount = bucket;
+      bucket = offset;
+      offset += bucketCount;
+    }
+
+    for (const DrawItem& item : _items) {
+      _sorted[histogram[(item.key >> shift) & (RADIX_SIZE - 1)]++] = item;
+    }
+    _items.swap(_sorted);
+  }
+}
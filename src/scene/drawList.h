@@ -0,0 +1,41 @@
+#ifndef D2B8F1A5_6C39_4E72_9A4D_E7C1F5B3A068
+#define D2B8F1A5_6C39_4E72_9A4D_E7C1F5B3A068
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sort key of a draw: the material in the high bits so pipeline changes are
+// the rarest, then the mesh so equal vertex buffers end up next to each
+// other
+struct DrawItem {
+  uint64_t key;
+  uint32_t object;
+};
+
+// Collects draws and orders them to minimize state changes. Draws with equal
+// keys keep the order they were added in.
+class DrawList {
+ public:
+  void clear(void) { _items.clear(); }
+
+  void reserve(size_t count) { _items.reserve(count); }
+
+  void add(uint32_t materialId, uint32_t meshId, uint32_t object) {
+    const uint64_t key = (static_cast<uint64_t>(materialId) << 32) | meshId;
+    _items.push_back({key, object});
+  }
+
+  void sort(void);
+
+  size_t size(void) const { return _items.size(); }
+
+  const std::vector<DrawItem>& items(void) const { return _items; }
+
+ private:
+  std::vector<DrawItem> _items;
+  // Scratch buffer of the radix sort
+  std::vector<DrawItem> _sorted;
+};
+
+#endif /* D2B8F1A5_6C39_4E72_9A4D_E7C1F5B3A068 */
@@ -0,0 +1,73 @@
+#include "lightScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <glm/gtc/constants.hpp>
+
+// Lights circle around their spawn point at this fraction of their range
+constexpr float ORBIT_FRACTION = 0.5f;
+
+// Full cone angle range of the spot lights, in radians
+constexpr float MIN_SPOT_ANGLE = 0.3f;
+constexpr float MAX_SPOT_ANGLE = 0.9f;
+
+void LightScene::generate(const LightSceneSettings& settings) {
+  std::mt19937 rng(settings.seed);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  const glm::vec3 corner = settings.center - settings.extent * 0.5f;
+
+  _lights.clear();
+  _lights.reserve(settings.count);
+
+  for (uint32_t i = 0; i < settings.count; i++) {
+    MovingLight light;
+    light.center =
+        corner + glm::vec3(unit(rng), unit(rng), unit(rng)) * settings.extent;
+    light.range = settings.range * (0.5f + unit(rng));
+    light.orbitRadius = light.range * ORBIT_FRACTION * unit(rng);
+    light.speed = 0.2f + unit(rng);
+    light.phase = unit(rng) * glm::two_pi<float>();
+
+    // Saturated hues so overlapping lights stay distinguishable
+    const float hue = unit(rng) * 6.0f;
+    const glm::vec3 color =
+        glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f,
+                             2.0f - std::abs(hue - 2.0f),
+                             2.0f - std::abs(hue - 4.0f)),
+                   0.0f, 1.0f);
+    light.colorIntensity = glm::vec4(color, 1.0f + unit(rng));
+
+    if (unit(rng) < settings.spotFraction) {
+      // Mostly pointing down onto the scene
+      light.direction = glm::normalize(
+          glm::vec3(unit(rng) - 0.5f, -1.0f, unit(rng) - 0.5f));
+      const float angle =
+          MIN_SPOT_ANGLE + unit(rng) * (MAX_SPOT_ANGLE - MIN_SPOT_ANGLE);
+      light.cone = std::cos(angle * 0.5f);
+    } else {
+      light.direction = glm::vec3(0.0f);
+      light.cone = -1.0f;
+    }
+
+    _lights.push_back(light);
+  }
+}
+
+void LightScene::animate(float time, GPULight* out, uint32_t count) const {
+  const uint32_t end = std::min(count, this->count());
+  for (uint32_t i = 0; i < end; i++) {
+    const MovingLight& light = _lights[i];
+
+    const float angle = light.phase + time * light.speed;
+    const glm::vec3 position =
+        light.center + glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) *
+                           light.orbitRadius;
+
+    out[i].positionRadius = glm::vec4(position, light.range);
+    out[i].colorIntensity = light.colorIntensity;
+    out[i].directionCone = glm::vec4(light.direction, light.cone);
+  }
+}
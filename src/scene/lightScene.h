@@ -0,0 +1,57 @@
+#ifndef B3E9D1F7_5A42_4C86_8E2B_6D0F3A9C7E54
+#define B3E9D1F7_5A42_4C86_8E2B_6D0F3A9C7E54
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Matches the Light struct of the lit shaders and light_cluster.comp
+struct GPULight {
+  glm::vec4 positionRadius;  // world position, w is the range
+  glm::vec4 colorIntensity;
+  // Spot direction, w is the cosine of the cone angle. Point lights have a
+  // zero direction and a cosine of -1.
+  glm::vec4 directionCone;
+};
+
+struct LightSceneSettings {
+  uint32_t count{0};
+  // Fraction of the lights that are spot lights, the rest are point lights
+  float spotFraction{0.25f};
+  // Distance at which a light's contribution reaches zero
+  float range{6.0f};
+  uint32_t seed{1};
+  // Box the lights wander in
+  glm::vec3 center{0.0f};
+  glm::vec3 extent{1.0f};
+};
+
+// Many small colored point and spot lights drifting on circles, for testing
+// how lighting scales with the number of lights. Like the stress scene, the
+// lights only depend on the settings and the time.
+class LightScene {
+ public:
+  void generate(const LightSceneSettings& settings);
+
+  // Writes the first count lights at their pose at the given time
+  void animate(float time, GPULight* out, uint32_t count) const;
+
+  uint32_t count(void) const { return static_cast<uint32_t>(_lights.size()); }
+
+ private:
+  struct MovingLight {
+    glm::vec3 center;
+    float orbitRadius;
+    float speed;
+    float phase;
+    float range;
+    float cone;
+    glm::vec4 colorIntensity;
+    glm::vec3 direction;
+  };
+
+  std::vector<MovingLight> _lights;
+};
+
+#endif /* B3E9D1F7_5A42_4C86_8E2B_6D0F3A9C7E54 */
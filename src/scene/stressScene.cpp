@@ -0,0 +1,126 @@
+#include "stressScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <glm/gtc/constants.hpp>
+
+// Instances per clump of the clustered layout
+constexpr uint32_t CLUSTER_SIZE = 1000;
+
+// Height and angular speed of the animation
+constexpr float BOB_HEIGHT = 0.5f;
+constexpr float SPIN_SPEED = 1.0f;
+
+bool parse_stress_layout(const std::string& name, StressLayout* outLayout) {
+  if (name == "grid") {
+    *outLayout = StressLayout::Grid;
+  } else if (name == "random") {
+    *outLayout = StressLayout::Random;
+  } else if (name == "clustered") {
+    *outLayout = StressLayout::Clustered;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* stress_layout_name(StressLayout layout) {
+  switch (layout) {
+    case StressLayout::Grid:
+      return "grid";
+    case StressLayout::Random:
+      return "random";
+    case StressLayout::Clustered:
+      return "clustered";
+  }
+  return "unknown";
+}
+
+void StressScene::generate(const StressSceneSettings& settings,
+                           TransformStore& transforms,
+                           std::vector<TransformId>* outIds) {
+  std::mt19937 rng(settings.seed);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  // Every layout fills the cube the grid would take
+  const uint32_t side = std::max(
+      1u, static_cast<uint32_t>(std::ceil(std::cbrt(
+              static_cast<double>(std::max(settings.count, 1u))))));
+  const float extent = side * settings.spacing;
+  const glm::vec3 corner = settings.center - glm::vec3(extent * 0.5f);
+
+  std::vector<glm::vec3> clusterCenters;
+  if (settings.layout == StressLayout::Clustered) {
+    const uint32_t clusters =
+        std::max(1u, (settings.count + CLUSTER_SIZE - 1) / CLUSTER_SIZE);
+    for (uint32_t i = 0; i < clusters; i++) {
+      clusterCenters.push_back(corner +
+                               glm::vec3(unit(rng), unit(rng), unit(rng)) *
+                                   extent);
+    }
+  }
+
+  // A clump holds CLUSTER_SIZE instances at roughly grid density
+  const float clusterRadius =
+      std::cbrt(static_cast<float>(CLUSTER_SIZE)) * settings.spacing * 0.5f;
+
+  transforms.reserve(transforms.size() + settings.count);
+  outIds->reserve(outIds->size() + settings.count);
+
+  for (uint32_t i = 0; i < settings.count; i++) {
+    glm::vec3 position;
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale(1.0f);
+
+    switch (settings.layout) {
+      case StressLayout::Grid: {
+        const uint32_t x = i % side;
+        const uint32_t y = (i / side) % side;
+        const uint32_t z = i / (side * side);
+        position = corner + (glm::vec3(x, y, z) + 0.5f) * settings.spacing;
+        break;
+      }
+      case StressLayout::Random:
+        position = corner + glm::vec3(unit(rng), unit(rng), unit(rng)) * extent;
+        rotation = glm::angleAxis(unit(rng) * glm::two_pi<float>(),
+                                  glm::vec3(0.0f, 1.0f, 0.0f));
+        scale = glm::vec3(0.5f + unit(rng));
+        break;
+      case StressLayout::Clustered: {
+        // The sum of three uniforms is bell shaped, denser in the middle
+        const glm::vec3& center = clusterCenters[i % clusterCenters.size()];
+        glm::vec3 offset;
+        for (int axis = 0; axis < 3; axis++) {
+          offset[axis] = (unit(rng) + unit(rng) + unit(rng)) / 1.5f - 1.0f;
+        }
+        position = center + offset * clusterRadius;
+        rotation = glm::angleAxis(unit(rng) * glm::two_pi<float>(),
+                                  glm::vec3(0.0f, 1.0f, 0.0f));
+        break;
+      }
+    }
+
+    const TransformId id =
+        transforms.create(INVALID_TRANSFORM, position, rotation, scale);
+    outIds->push_back(id);
+
+    // Drawn for every instance so the placement doesn't depend on the
+    // animated fraction
+    const bool animated = unit(rng) < settings.animatedFraction;
+    const float phase = unit(rng) * glm::two_pi<float>();
+    if (animated) _animated.push_back({id, position, phase});
+  }
+}
+
+void StressScene::animate(TransformStore& transforms, float time) const {
+  for (const AnimatedInstance& instance : _animated) {
+    const float t = time + instance.phase;
+    const glm::vec3 bob(0.0f, std::sin(t) * BOB_HEIGHT, 0.0f);
+    transforms.set_position(instance.id, instance.basePosition + bob);
+    transforms.set_rotation(instance.id,
+                            glm::angleAxis(t * SPIN_SPEED,
+                                           glm::vec3(0.0f, 1.0f, 0.0f)));
+  }
+}
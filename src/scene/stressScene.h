@@ -0,0 +1,62 @@
+#ifndef F6A2D8C4_1B93_4E57_A0C6_2E8D5B7F9143
+#define F6A2D8C4_1B93_4E57_A0C6_2E8D5B7F9143
+
+#include "transformStore.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+enum class StressLayout {
+  // Cube of evenly spaced instances
+  Grid,
+  // Uniformly scattered over the same volume as the grid, randomly rotated
+  // and scaled
+  Random,
+  // Dense clumps of about a thousand instances around random centers
+  Clustered,
+};
+
+struct StressSceneSettings {
+  uint32_t count{0};
+  StressLayout layout{StressLayout::Grid};
+  // Distance between neighbours of the grid, sets the size of every layout
+  float spacing{3.0f};
+  // Fraction of the instances that bob and spin every frame
+  float animatedFraction{0.0f};
+  uint32_t seed{1};
+  glm::vec3 center{0.0f};
+};
+
+// Returns false for an unknown name
+bool parse_stress_layout(const std::string& name, StressLayout* outLayout);
+
+const char* stress_layout_name(StressLayout layout);
+
+// Places large numbers of root transforms for scalability tests. Placement
+// only depends on the settings, so the same seed always builds the same
+// scene.
+class StressScene {
+ public:
+  // Creates settings.count transforms and appends their ids to outIds
+  void generate(const StressSceneSettings& settings,
+                TransformStore& transforms, std::vector<TransformId>* outIds);
+
+  // Moves the animated instances to their pose at the given time
+  void animate(TransformStore& transforms, float time) const;
+
+  size_t animated_count(void) const { return _animated.size(); }
+
+ private:
+  struct AnimatedInstance {
+    TransformId id;
+    glm::vec3 basePosition;
+    float phase;
+  };
+
+  std::vector<AnimatedInstance> _animated;
+};
+
+#endif /* F6A2D8C4_1B93_4E57_A0C6_2E8D5B7F9143 */
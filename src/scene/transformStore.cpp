@@ -0,0 +1,295 @@
+#include "transformStore.h"
+
+#include "Utility/jobSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+// Number of transforms whose local matrices are built together. The loop over
+// a batch only touches the SoA arrays, so the compiler can vectorize it.
+constexpr uint32_t TRANSFORM_BATCH = 16;
+
+// Levels smaller than this are updated on the calling thread
+constexpr size_t MIN_PARALLEL_CHUNK = 8192;
+
+TransformId TransformStore::create(TransformId parent,
+                                   const glm::vec3& position,
+                                   const glm::quat& rotation,
+                                   const glm::vec3& scale) {
+  const TransformId id = static_cast<TransformId>(_idOf.size());
+  const uint32_t dense = id;
+
+  uint32_t parentDense = NO_PARENT;
+  uint32_t depth = 0;
+  if (parent != INVALID_TRANSFORM) {
+    parentDense = _denseOf[parent];
+    depth = _depth[parentDense] + 1;
+  }
+
+  const glm::quat q = glm::normalize(rotation);
+
+  _posX.push_back(position.x);
+  _posY.push_back(position.y);
+  _posZ.push_back(position.z);
+  _rotX.push_back(q.x);
+  _rotY.push_back(q.y);
+  _rotZ.push_back(q.z);
+  _rotW.push_back(q.w);
+  _scaleX.push_back(scale.x);
+  _scaleY.push_back(scale.y);
+  _scaleZ.push_back(scale.z);
+
+  _parent.push_back(parentDense);
+  _depth.push_back(depth);
+  _dirty.push_back(1);
+  _world.emplace_back(1.0f);
+
+  _idOf.push_back(id);
+  _denseOf.push_back(dense);
+
+  _structureChanged = true;
+  _hasDirty = true;
+
+  return id;
+}
+
+void TransformStore::reserve(size_t count) {
+  for (std::vector<float>* array :
+       {&_posX, &_posY, &_posZ, &_rotX, &_rotY, &_rotZ, &_rotW, &_scaleX,
+        &_scaleY, &_scaleZ}) {
+    array->reserve(count);
+  }
+  _parent.reserve(count);
+  _depth.reserve(count);
+  _dirty.reserve(count);
+  _world.reserve(count);
+  _idOf.reserve(count);
+  _denseOf.reserve(count);
+}
+
+void TransformStore::clear() {
+  for (std::vector<float>* array :
+       {&_posX, &_posY, &_posZ, &_rotX, &_rotY, &_rotZ, &_rotW, &_scaleX,
+        &_scaleY, &_scaleZ}) {
+    array->clear();
+  }
+  _parent.clear();
+  _depth.clear();
+  _dirty.clear();
+  _world.clear();
+  _idOf.clear();
+  _denseOf.clear();
+  _levelBegin.clear();
+  _changed.clear();
+  _structureChanged = false;
+  _hasDirty = false;
+}
+
+void TransformStore::set_position(TransformId id, const glm::vec3& position) {
+  const uint32_t i = _denseOf[id];
+  _posX[i] = position.x;
+  _posY[i] = position.y;
+  _posZ[i] = position.z;
+  mark_dirty(id);
+}
+
+void TransformStore::set_rotation(TransformId id, const glm::quat& rotation) {
+  const uint32_t i = _denseOf[id];
+  const glm::quat q = glm::normalize(rotation);
+  _rotX[i] = q.x;
+  _rotY[i] = q.y;
+  _rotZ[i] = q.z;
+  _rotW[i] = q.w;
+  mark_dirty(id);
+}
+
+void TransformStore::set_scale(TransformId id, const glm::vec3& scale) {
+  const uint32_t i = _denseOf[id];
+  _scaleX[i] = scale.x;
+  _scaleY[i] = scale.y;
+  _scaleZ[i] = scale.z;
+  mark_dirty(id);
+}
+
+glm::vec3 TransformStore::get_position(TransformId id) const {
+  const uint32_t i = _denseOf[id];
+  return glm::vec3(_posX[i], _posY[i], _posZ[i]);
+}
+
+glm::quat TransformStore::get_rotation(TransformId id) const {
+  const uint32_t i = _denseOf[id];
+  return glm::quat(_rotW[i], _rotX[i], _rotY[i], _rotZ[i]);
+}
+
+glm::vec3 TransformStore::get_scale(TransformId id) const {
+  const uint32_t i = _denseOf[id];
+  return glm::vec3(_scaleX[i], _scaleY[i], _scaleZ[i]);
+}
+
+TransformId TransformStore::get_parent(TransformId id) const {
+  const uint32_t parent = _parent[_denseOf[id]];
+  return parent == NO_PARENT ? INVALID_TRANSFORM : _idOf[parent];
+}
+
+size_t TransformStore::update(void* out, size_t strideBytes) {
+  _changed.clear();
+
+  if (_structureChanged) {
+    sort_by_depth();
+    _structureChanged = false;
+  }
+
+  if (!_hasDirty) return 0;
+  _hasDirty = false;
+
+  const uint32_t count = static_cast<uint32_t>(size());
+
+  // Parents precede their children, so one pass pushes dirtiness down the
+  // whole hierarchy
+  for (uint32_t i = 0; i < count; i++) {
+    const uint32_t parent = _parent[i];
+    if (parent != NO_PARENT && _dirty[parent]) _dirty[i] = 1;
+  }
+
+  // Levels run one after another because children read their parent's world
+  // matrix, transforms inside a level are independent
+  for (size_t level = 0; level + 1 < _levelBegin.size(); level++) {
+    if (_jobs == nullptr) {
+      update_range(_levelBegin[level], _levelBegin[level + 1],
+                   static_cast<char*>(out), strideBytes);
+      continue;
+    }
+    _jobs->parallel_for(_levelBegin[level], _levelBegin[level + 1],
+                        MIN_PARALLEL_CHUNK, [&](size_t begin, size_t end) {
+                          update_range(static_cast<uint32_t>(begin),
+                                       static_cast<uint32_t>(end),
+                                       static_cast<char*>(out), strideBytes);
+                        });
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (_dirty[i]) {
+      _changed.push_back(_idOf[i]);
+      _dirty[i] = 0;
+    }
+  }
+
+  return _changed.size();
+}
+
+void TransformStore::update_range(uint32_t begin, uint32_t end, char* out,
+                                  size_t strideBytes) {
+  alignas(64) float m[12][TRANSFORM_BATCH];
+
+  for (uint32_t batch = begin; batch < end; batch += TRANSFORM_BATCH) {
+    const uint32_t n = std::min(TRANSFORM_BATCH, end - batch);
+
+    bool anyDirty = false;
+    for (uint32_t k = 0; k < n; k++) anyDirty |= _dirty[batch + k] != 0;
+    if (!anyDirty) continue;
+
+    const float* px = &_posX[batch];
+    const float* py = &_posY[batch];
+    const float* pz = &_posZ[batch];
+    const float* qx = &_rotX[batch];
+    const float* qy = &_rotY[batch];
+    const float* qz = &_rotZ[batch];
+    const float* qw = &_rotW[batch];
+    const float* sx = &_scaleX[batch];
+    const float* sy = &_scaleY[batch];
+    const float* sz = &_scaleZ[batch];
+
+    // Local matrix = T * R * S, stored as the upper 3x4 of a column major
+    // matrix. Same formula as glm::mat3_cast.
+    for (uint32_t k = 0; k < n; k++) {
+      const float xx = qx[k] * qx[k], yy = qy[k] * qy[k], zz = qz[k] * qz[k];
+      const float xy = qx[k] * qy[k], xz = qx[k] * qz[k], yz = qy[k] * qz[k];
+      const float wx = qw[k] * qx[k], wy = qw[k] * qy[k], wz = qw[k] * qz[k];
+
+      m[0][k] = (1.0f - 2.0f * (yy + zz)) * sx[k];
+      m[1][k] = 2.0f * (xy + wz) * sx[k];
+      m[2][k] = 2.0f * (xz - wy) * sx[k];
+
+      m[3][k] = 2.0f * (xy - wz) * sy[k];
+      m[4][k] = (1.0f - 2.0f * (xx + zz)) * sy[k];
+      m[5][k] = 2.0f * (yz + wx) * sy[k];
+
+      m[6][k] = 2.0f * (xz + wy) * sz[k];
+      m[7][k] = 2.0f * (yz - wx) * sz[k];
+      m[8][k] = (1.0f - 2.0f * (xx + yy)) * sz[k];
+
+      m[9][k] = px[k];
+      m[10][k] = py[k];
+      m[11][k] = pz[k];
+    }
+
+    for (uint32_t k = 0; k < n; k++) {
+      const uint32_t i = batch + k;
+      if (!_dirty[i]) continue;
+
+      const glm::mat4 local(m[0][k], m[1][k], m[2][k], 0.0f,  //
+                            m[3][k], m[4][k], m[5][k], 0.0f,  //
+                            m[6][k], m[7][k], m[8][k], 0.0f,  //
+                            m[9][k], m[10][k], m[11][k], 1.0f);
+
+      const uint32_t parent = _parent[i];
+      _world[i] = parent == NO_PARENT ? local : _world[parent] * local;
+
+      if (out) {
+        memcpy(out + strideBytes * _idOf[i], &_world[i], sizeof(glm::mat4));
+      }
+    }
+  }
+}
+
+template <typename T>
+static void permute(std::vector<T>& array,
+                    const std::vector<uint32_t>& newIndex) {
+  std::vector<T> sorted(array.size());
+  for (size_t i = 0; i < array.size(); i++) sorted[newIndex[i]] = array[i];
+  array.swap(sorted);
+}
+
+void TransformStore::sort_by_depth() {
+  const uint32_t count = static_cast<uint32_t>(size());
+
+  uint32_t maxDepth = 0;
+  for (uint32_t depth : _depth) maxDepth = std::max(maxDepth, depth);
+
+  // Stable counting sort by depth. Appending to an already sorted store
+  // produces the identity permutation, which is skipped.
+  _levelBegin.assign(maxDepth + 2, 0);
+  for (uint32_t depth : _depth) _levelBegin[depth + 1]++;
+  for (uint32_t level = 1; level < _levelBegin.size(); level++) {
+    _levelBegin[level] += _levelBegin[level - 1];
+  }
+
+  std::vector<uint32_t> cursor(_levelBegin.begin(), _levelBegin.end() - 1);
+  std::vector<uint32_t> newIndex(count);
+  bool identity = true;
+  for (uint32_t i = 0; i < count; i++) {
+    newIndex[i] = cursor[_depth[i]]++;
+    identity &= newIndex[i] == i;
+  }
+
+  if (identity) return;
+
+  for (std::vector<float>* array :
+       {&_posX, &_posY, &_posZ, &_rotX, &_rotY, &_rotZ, &_rotW, &_scaleX,
+        &_scaleY, &_scaleZ}) {
+    permute(*array, newIndex);
+  }
+
+  for (uint32_t& parent : _parent) {
+    if (parent != NO_PARENT) parent = newIndex[parent];
+  }
+  permute(_parent, newIndex);
+  permute(_depth, newIndex);
+  permute(_dirty, newIndex);
+  permute(_world, newIndex);
+  permute(_idOf, newIndex);
+
+  for (uint32_t i = 0; i < count; i++) _denseOf[_idOf[i]] = i;
+}
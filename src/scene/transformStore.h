@@ -0,0 +1,98 @@
+#ifndef D7A1C3E5_2F4B_4B69_8D0E_93C5A1B7F246
+#define D7A1C3E5_2F4B_4B69_8D0E_93C5A1B7F246
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Stable identifier of a transform. It is also the slot the world matrix is
+// written to in the output array passed to TransformStore::update.
+using TransformId = uint32_t;
+
+constexpr TransformId INVALID_TRANSFORM = UINT32_MAX;
+
+class JobSystem;
+
+// Data-oriented transform hierarchy. Local position, rotation and scale are
+// stored as separate float arrays, ordered by hierarchy depth so that every
+// parent precedes its children. World matrices are recomputed level by level,
+// with each level processed in parallel batches on the job system.
+class TransformStore {
+ public:
+  // Without one, updates run on the calling thread
+  void set_job_system(JobSystem* jobs) { _jobs = jobs; }
+
+  TransformId create(TransformId parent = INVALID_TRANSFORM,
+                     const glm::vec3& position = glm::vec3(0.0f),
+                     const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f,
+                                                           0.0f),
+                     const glm::vec3& scale = glm::vec3(1.0f));
+
+  void reserve(size_t count);
+
+  void clear(void);
+
+  size_t size(void) const { return _idOf.size(); }
+
+  void set_position(TransformId id, const glm::vec3& position);
+  void set_rotation(TransformId id, const glm::quat& rotation);
+  void set_scale(TransformId id, const glm::vec3& scale);
+
+  glm::vec3 get_position(TransformId id) const;
+  glm::quat get_rotation(TransformId id) const;
+  glm::vec3 get_scale(TransformId id) const;
+
+  TransformId get_parent(TransformId id) const;
+
+  // World matrix as of the last update
+  const glm::mat4& get_world(TransformId id) const {
+    return _world[_denseOf[id]];
+  }
+
+  // Recomputes every dirty transform and its descendants. Each new world
+  // matrix is also written to out + id * strideBytes, which lets the store
+  // fill the object buffer directly. Returns the number of matrices written;
+  // their ids are available through changed() until the next update.
+  size_t update(void* out = nullptr, size_t strideBytes = sizeof(glm::mat4));
+
+  const std::vector<TransformId>& changed(void) const { return _changed; }
+
+ private:
+  void mark_dirty(TransformId id) {
+    _dirty[_denseOf[id]] = 1;
+    _hasDirty = true;
+  }
+
+  // Restores the depth ordering after parented transforms were appended
+  void sort_by_depth(void);
+
+  void update_range(uint32_t begin, uint32_t end, char* out,
+                    size_t strideBytes);
+
+  // Local TRS, indexed by dense index
+  std::vector<float> _posX, _posY, _posZ;
+  std::vector<float> _rotX, _rotY, _rotZ, _rotW;
+  std::vector<float> _scaleX, _scaleY, _scaleZ;
+
+  // Dense index of the parent, or UINT32_MAX for roots
+  std::vector<uint32_t> _parent;
+  std::vector<uint32_t> _depth;
+  std::vector<uint8_t> _dirty;
+  std::vector<glm::mat4> _world;
+
+  std::vector<TransformId> _idOf;
+  std::vector<uint32_t> _denseOf;
+
+  // First dense index of every depth level, plus one past the end
+  std::vector<uint32_t> _levelBegin;
+  bool _structureChanged{false};
+  bool _hasDirty{false};
+
+  std::vector<TransformId> _changed;
+
+  JobSystem* _jobs{nullptr};
+};
+
+#endif /* D7A1C3E5_2F4B_4B69_8D0E_93C5A1B7F246 */
@@ -0,0 +1,145 @@
+#include "vk_benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+static void write_json_string(FILE* file, const std::string& text) {
+  fputc('"', file);
+  for (char c : text) {
+    if (c == '"' || c == '\\') fputc('\\', file);
+    fputc(c, file);
+  }
+  fputc('"', file);
+}
+
+static void write_summary(FILE* file, const char* name,
+                          const FrameStats::Summary& stats, bool last) {
+  fprintf(file,
+          "        \"%s\": {\"frames\": %u, \"min_ms\": %.4f, "
+          "\"avg_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, "
+          "\"p99_ms\": %.4f, \"max_ms\": %.4f, \"over_budget\": %u}%s\n",
+          name, stats.frames, stats.minMs, stats.avgMs, stats.p50Ms,
+          stats.p95Ms, stats.p99Ms, stats.maxMs, stats.overBudget,
+          last ? "" : ",");
+}
+
+static void write_voxel_stats(FILE* file, const VoxelRunStats& voxel,
+                              double seconds) {
+  std::vector<float> latencies = voxel.remeshLatencyMs;
+  std::sort(latencies.begin(), latencies.end());
+
+  double total = 0.0;
+  for (float latency : latencies) total += latency;
+  const size_t count = latencies.size();
+  const double avg = count > 0 ? total / count : 0.0;
+  const double p95 = count > 0 ? latencies[(count - 1) * 95 / 100] : 0.0;
+  const double max = count > 0 ? latencies.back() : 0.0;
+
+  fprintf(file,
+          ",\n      \"voxel\": {\"edits\": %llu, \"edits_per_second\": %.1f, "
+          "\"remeshes\": %llu, \"remesh_latency_ms\": {\"avg\": %.4f, "
+          "\"p95\": %.4f, \"max\": %.4f}, \"chunks\": %u, "
+          "\"chunk_bytes\": %zu, \"bytes_per_chunk\": %.1f, "
+          "\"mesh_bytes\": %zu}",
+          static_cast<unsigned long long>(voxel.edits),
+          seconds > 0.0 ? voxel.edits / seconds : 0.0,
+          static_cast<unsigned long long>(voxel.remeshes), avg, p95, max,
+          voxel.chunks, voxel.chunkBytes,
+          voxel.chunks > 0 ? static_cast<double>(voxel.chunkBytes) /
+                                 voxel.chunks
+                           : 0.0,
+          voxel.meshBytes);
+}
+
+bool write_benchmark_report(const std::string& filename,
+                            const BenchmarkInfo& info,
+                            const std::vector<BenchmarkRun>& runs) {
+  FILE* file = fopen(filename.c_str(), "w");
+  if (file == nullptr) {
+    std::cerr << "Failed to open benchmark report " << filename << std::endl;
+    return false;
+  }
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"device\": ");
+  write_json_string(file, info.device);
+  fprintf(file, ",\n  \"camera_path\": ");
+  write_json_string(file, info.cameraPath);
+  fprintf(file, ",\n");
+  fprintf(file, "  \"width\": %u,\n  \"height\": %u,\n", info.width,
+          info.height);
+  fprintf(file, "  \"frames_per_run\": %u,\n", info.framesPerRun);
+  fprintf(file, "  \"step_ms\": %.4f,\n", info.stepMs);
+  fprintf(file, "  \"budget_ms\": %.4f,\n", info.budgetMs);
+  fprintf(file, "  \"frames_in_flight\": %u,\n", info.framesInFlight);
+  fprintf(file, "  \"present_mode\": \"%s\",\n", info.presentMode);
+  fprintf(file, "  \"headless\": %s,\n", info.headless ? "true" : "false");
+  fprintf(file, "  \"dynamic_resolution\": %s,\n",
+          info.dynamicResolution ? "true" : "false");
+  fprintf(file, "  \"objects\": %u,\n", info.objects);
+  fprintf(file,
+          "  \"stress_scene\": {\"objects\": %u, \"layout\": \"%s\", "
+          "\"animated_fraction\": %.3f},\n",
+          info.stressObjects, info.stressLayout, info.animatedFraction);
+
+  fprintf(file, "  \"runs\": [\n");
+  for (size_t i = 0; i < runs.size(); i++) {
+    const BenchmarkRun& run = runs[i];
+
+    fprintf(file, "    {\n      \"label\": ");
+    write_json_string(file, run.label);
+    fprintf(file, ",\n");
+    fprintf(file, "      \"depth_prepass\": %s,\n",
+            run.depthPrepass ? "true" : "false");
+    fprintf(file, "      \"occlusion_culling\": %s,\n",
+            run.occlusionCulling ? "true" : "false");
+    fprintf(file, "      \"render_thread\": %s,\n",
+            run.renderThread ? "true" : "false");
+    fprintf(file, "      \"lights\": %u,\n", run.lights);
+    fprintf(file, "      \"frames\": %u,\n", run.frames);
+    fprintf(file, "      \"seconds\": %.4f,\n", run.seconds);
+
+    fprintf(file, "      \"frame_time\": {\n");
+    write_summary(file, "cpu", run.stats[FrameStats::CPU], false);
+    write_summary(file, "gpu", run.stats[FrameStats::GPU], false);
+    write_summary(file, "present", run.stats[FrameStats::PRESENT], true);
+    fprintf(file, "      },\n");
+
+    fprintf(file, "      \"gpu_zones_avg_ms\": {");
+    for (size_t zone = 0; zone < run.gpuZones.size(); zone++) {
+      const GpuZoneAverage& average = run.gpuZones[zone];
+      fprintf(file, "%s\n        ", zone == 0 ? "" : ",");
+      write_json_string(file, average.name);
+      fprintf(file, ": %.4f",
+              average.samples > 0 ? average.totalMs / average.samples : 0.0);
+    }
+    fprintf(file, "%s}", run.gpuZones.empty() ? "" : "\n      ");
+
+    if (run.pipelineStatsFrames > 0) {
+      const PipelineStatsResult& total = run.pipelineStats;
+      const double frames = static_cast<double>(run.pipelineStatsFrames);
+      fprintf(file,
+              ",\n      \"pipeline_stats_avg\": {\"frames\": %u, "
+              "\"input_vertices\": %.1f, \"vs_invocations\": %.1f, "
+              "\"clipping_primitives\": %.1f, \"fs_invocations\": %.1f, "
+              "\"overdraw\": %.4f, \"vertex_reuse\": %.4f}",
+              run.pipelineStatsFrames, total.inputVertices / frames,
+              total.vertexInvocations / frames,
+              total.clippingPrimitives / frames,
+              total.fragmentInvocations / frames, total.overdraw(),
+              total.vertex_reuse());
+    }
+    if (run.voxelWorld) {
+      write_voxel_stats(file, run.voxel, run.seconds);
+    }
+    fprintf(file, "\n");
+
+    fprintf(file, "    }%s\n", i + 1 == runs.size() ? "" : ",");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  const bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
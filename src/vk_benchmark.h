@@ -0,0 +1,71 @@
+#ifndef A81F4C6D_39E2_4B75_8C1A_D26E0B7F5394
+#define A81F4C6D_39E2_4B75_8C1A_D26E0B7F5394
+
+#include "Utility/frameStats.h"
+#include "vk_profiler.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Settings shared by every run of a benchmark session
+struct BenchmarkInfo {
+  std::string device;
+  std::string cameraPath;
+  uint32_t width;
+  uint32_t height;
+  uint32_t framesPerRun;
+  float stepMs;
+  float budgetMs;
+  uint32_t framesInFlight;
+  const char* presentMode;
+  bool headless;
+  bool dynamicResolution;
+  uint32_t objects;
+  uint32_t stressObjects;
+  const char* stressLayout;
+  float animatedFraction;
+};
+
+struct GpuZoneAverage {
+  std::string name;
+  double totalMs{0.0};
+  uint32_t samples{0};
+};
+
+// Block edits and chunk remeshing during a run with --voxel-world
+struct VoxelRunStats {
+  uint64_t edits{0};
+  // Chunk meshes rebuilt and reuploaded
+  uint64_t remeshes{0};
+  // From queueing a dirty chunk until its new buffers are written
+  std::vector<float> remeshLatencyMs;
+  // World size at the end of the run
+  uint32_t chunks{0};
+  size_t chunkBytes{0};
+  size_t meshBytes{0};
+};
+
+// One playback of the camera path with a fixed set of options
+struct BenchmarkRun {
+  std::string label;
+  bool depthPrepass;
+  bool occlusionCulling;
+  bool renderThread;
+  uint32_t lights;
+  uint32_t frames;
+  double seconds;
+  FrameStats::Summary stats[FrameStats::METRIC_COUNT];
+  std::vector<GpuZoneAverage> gpuZones;
+  // Summed over the frames that had pipeline statistics
+  PipelineStatsResult pipelineStats;
+  uint32_t pipelineStatsFrames{0};
+  bool voxelWorld{false};
+  VoxelRunStats voxel;
+};
+
+bool write_benchmark_report(const std::string& filename,
+                            const BenchmarkInfo& info,
+                            const std::vector<BenchmarkRun>& runs);
+
+#endif /* A81F4C6D_39E2_4B75_8C1A_D26E0B7F5394 */
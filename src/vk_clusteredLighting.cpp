@@ -0,0 +1,82 @@
+#include "vk_clusteredLighting.h"
+#include "vk_engine.h"
+#include "vk_initializers.h"
+
+#include <cmath>
+#include <iostream>
+
+// One invocation per cluster, the group shares batches of lights
+constexpr uint32_t LIGHT_CLUSTER_GROUP_SIZE = 64;
+
+void ClusteredLighting::init(VulkanEngine& engine) {
+  _engine = &engine;
+  VkDevice device = engine._device;
+
+  VkPushConstantRange pushConstant;
+  pushConstant.offset = 0;
+  pushConstant.size = sizeof(LightCullPushConstants);
+  pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkPipelineLayoutCreateInfo layoutInfo = vkinit::pipeline_layout_create_info();
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &engine._globalSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstant;
+
+  VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &_layout));
+
+  VkShaderModule shader;
+  if (!engine.load_shader_module(
+          engine.get_path() + "/shaders/light_cluster.comp.spv", &shader)) {
+    std::cout << "Error when building the light clustering shader"
+              << std::endl;
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.pNext = nullptr;
+  pipelineInfo.stage = vkinit::pipeline_shader_stage_create_info(
+      VK_SHADER_STAGE_COMPUTE_BIT, shader);
+  pipelineInfo.layout = _layout;
+
+  VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
+                                    nullptr, &_pipeline));
+
+  vkDestroyShaderModule(device, shader, nullptr);
+
+  // Only ever touched by the GPU, the binning pass rewrites every cluster
+  _clusters = engine.create_buffer(
+      sizeof(uint32_t) * CLUSTER_STRIDE * CLUSTER_COUNT,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY,
+      MemoryCategory::PerFrame);
+}
+
+void ClusteredLighting::cleanup() {
+  VkDevice device = _engine->_device;
+
+  _engine->destroy_buffer(_clusters);
+
+  vkDestroyPipeline(device, _pipeline, nullptr);
+  vkDestroyPipelineLayout(device, _layout, nullptr);
+}
+
+glm::vec2 ClusteredLighting::slice_params(float znear, float zfar) {
+  const float scale =
+      static_cast<float>(CLUSTER_Z) / std::log(zfar / znear);
+  return glm::vec2(scale, -std::log(znear) * scale);
+}
+
+void ClusteredLighting::bin_lights(VkCommandBuffer cmd,
+                                   const uint32_t* globalOffsets,
+                                   const LightCullPushConstants& cullData) {
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _layout, 0, 1,
+                          &_engine->_globalDescriptor, GLOBAL_DYNAMIC_OFFSETS,
+                          globalOffsets);
+  vkCmdPushConstants(cmd, _layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(LightCullPushConstants), &cullData);
+  vkCmdDispatch(cmd,
+                (CLUSTER_COUNT + LIGHT_CLUSTER_GROUP_SIZE - 1) /
+                    LIGHT_CLUSTER_GROUP_SIZE,
+                1, 1);
+}
@@ -0,0 +1,66 @@
+#ifndef D8A4F2C6_7E15_4B39_92D0_5C3E8A1F6B47
+#define D8A4F2C6_7E15_4B39_92D0_5C3E8A1F6B47
+
+#include "vk_types.h"
+
+#include <glm/glm.hpp>
+
+class VulkanEngine;
+
+// Froxel grid of the view frustum, must match light_cluster.comp and the lit
+// fragment shaders. Depth slices are spaced exponentially between the near
+// and far plane so froxels stay roughly cubic.
+constexpr uint32_t CLUSTER_X = 16;
+constexpr uint32_t CLUSTER_Y = 9;
+constexpr uint32_t CLUSTER_Z = 24;
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+// Every cluster stores its light count followed by up to this many light
+// indices. Lights past the limit are dropped from the cluster.
+constexpr uint32_t MAX_CLUSTER_LIGHTS = 255;
+constexpr uint32_t CLUSTER_STRIDE = MAX_CLUSTER_LIGHTS + 1;
+
+// Size of the light array bound every frame
+constexpr uint32_t MAX_LIGHTS = 16384;
+
+struct LightCullPushConstants {
+  glm::mat4 view;
+  float P00, P11;  // projection scale, P11 keeps the sign of the y flip
+  float znear, zfar;
+  uint32_t lightCount;
+};
+
+// Bins the frame's lights into the froxels they touch with a compute pass, so
+// the fragment shaders only loop over the lights of their own cluster. The
+// lights are read from binding 2 and the cluster lists written to binding 3
+// of the global set.
+class ClusteredLighting {
+ public:
+  void init(VulkanEngine& engine);
+
+  void cleanup(void);
+
+  // Light lists of every cluster, for binding 3 of the global set
+  VkDescriptorBufferInfo cluster_info(void) const {
+    return {_clusters._buffer, 0, VK_WHOLE_SIZE};
+  }
+
+  VkBuffer cluster_buffer(void) const { return _clusters._buffer; }
+
+  // Depth slice of a view depth is log(depth) * x + y, clamped to the grid
+  static glm::vec2 slice_params(float znear, float zfar);
+
+  // globalOffsets are the dynamic offsets of the global set for this frame
+  void bin_lights(VkCommandBuffer cmd, const uint32_t* globalOffsets,
+                  const LightCullPushConstants& cullData);
+
+ private:
+  VulkanEngine* _engine{nullptr};
+
+  VkPipelineLayout _layout;
+  VkPipeline _pipeline;
+
+  AllocatedBuffer _clusters;
+};
+
+#endif /* D8A4F2C6_7E15_4B39_92D0_5C3E8A1F6B47 */
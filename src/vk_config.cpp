@@ -0,0 +1,139 @@
+#include "vk_config.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static bool parse_present_mode(const std::string& name,
+                               VkPresentModeKHR* outMode) {
+  if (name == "fifo") {
+    *outMode = VK_PRESENT_MODE_FIFO_KHR;
+  } else if (name == "mailbox") {
+    *outMode = VK_PRESENT_MODE_MAILBOX_KHR;
+  } else if (name == "immediate") {
+    *outMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+EngineConfig parse_engine_config(int argc, char* argv[]) {
+  EngineConfig config;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+
+    if (arg == "--depth-prepass") {
+      config.depthPrepass = true;
+    } else if (arg == "--no-depth-prepass") {
+      config.depthPrepass = false;
+    } else if (arg == "--frames-in-flight" && hasValue) {
+      const int frames = std::atoi(argv[++i]);
+      config.framesInFlight = static_cast<uint32_t>(
+          std::clamp(frames, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT)));
+      if (frames != static_cast<int>(config.framesInFlight)) {
+        std::cerr << "Frames in flight clamped to " << config.framesInFlight
+                  << std::endl;
+      }
+    } else if (arg == "--present-mode" && hasValue) {
+      const std::string name = argv[++i];
+      if (!parse_present_mode(name, &config.presentMode)) {
+        std::cerr << "Unknown present mode " << name
+                  << ", expected fifo, mailbox or immediate" << std::endl;
+      }
+    } else if (arg == "--dynamic-resolution") {
+      config.dynamicResolution = true;
+    } else if (arg == "--target-frame-ms" && hasValue) {
+      config.targetFrameMs =
+          std::max(static_cast<float>(std::atof(argv[++i])), 1.0f);
+    } else if (arg == "--min-render-scale" && hasValue) {
+      config.minRenderScale =
+          std::clamp(static_cast<float>(std::atof(argv[++i])), 0.1f, 1.0f);
+    } else if (arg == "--headless") {
+      config.headless = true;
+    } else if (arg == "--frames" && hasValue) {
+      config.frameLimit =
+          static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+    } else if (arg == "--benchmark" && hasValue) {
+      config.benchmarkPath = argv[++i];
+    } else if (arg == "--benchmark-step-ms" && hasValue) {
+      config.benchmarkStepMs =
+          std::max(static_cast<float>(std::atof(argv[++i])), 0.1f);
+    } else if (arg == "--benchmark-report" && hasValue) {
+      config.benchmarkReport = argv[++i];
+    } else if (arg == "--compare-depth-prepass") {
+      config.compareDepthPrepass = true;
+    } else if (arg == "--record-path" && hasValue) {
+      config.recordPath = argv[++i];
+    } else if (arg == "--stress-count" && hasValue) {
+      config.stressScene.count =
+          static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+    } else if (arg == "--stress-layout" && hasValue) {
+      const std::string name = argv[++i];
+      if (!parse_stress_layout(name, &config.stressScene.layout)) {
+        std::cerr << "Unknown stress layout " << name << std::endl;
+      }
+    } else if (arg == "--stress-spacing" && hasValue) {
+      config.stressScene.spacing =
+          std::max(static_cast<float>(std::atof(argv[++i])), 0.1f);
+    } else if (arg == "--stress-animate" && hasValue) {
+      config.stressScene.animatedFraction =
+          std::clamp(static_cast<float>(std::atof(argv[++i])), 0.0f, 1.0f);
+    } else if (arg == "--stress-seed" && hasValue) {
+      config.stressScene.seed = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (arg == "--lights" && hasValue) {
+      config.lights.count =
+          static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+    } else if (arg == "--light-range" && hasValue) {
+      config.lights.range =
+          std::max(static_cast<float>(std::atof(argv[++i])), 0.1f);
+    } else if (arg == "--light-seed" && hasValue) {
+      config.lights.seed = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (arg == "--compare-lights") {
+      config.compareLights = true;
+    } else if (arg == "--voxel-world") {
+      config.voxelWorld = true;
+    } else if (arg == "--voxel-edits" && hasValue) {
+      config.voxelEditsPerSecond =
+          std::max(static_cast<float>(std::atof(argv[++i])), 0.0f);
+    } else if (arg == "--trace" && hasValue) {
+      config.tracePath = argv[++i];
+    } else if (arg == "--frame-stats" && hasValue) {
+      config.frameStatsPath = argv[++i];
+    } else if (arg == "--pipeline-stats") {
+      config.pipelineStatistics = true;
+    } else if (arg == "--render-thread") {
+      config.renderThread = true;
+    } else if (arg == "--compare-render-thread") {
+      config.compareRenderThread = true;
+    } else {
+      std::cerr << "Ignoring unknown argument " << arg << std::endl;
+    }
+  }
+
+  // There's no window to close, a benchmark stops at the end of its path
+  if (config.headless && config.frameLimit == 0 &&
+      config.benchmarkPath.empty()) {
+    config.frameLimit = DEFAULT_HEADLESS_FRAMES;
+  }
+
+  return config;
+}
+
+const char* present_mode_name(VkPresentModeKHR mode) {
+  switch (mode) {
+    case VK_PRESENT_MODE_FIFO_KHR:
+      return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+      return "fifo relaxed";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      return "mailbox";
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      return "immediate";
+    default:
+      return "unknown";
+  }
+}
@@ -0,0 +1,103 @@
+#ifndef A8E3F6C1_4D27_4B5A_9F10_7C2E5B8D3A96
+#define A8E3F6C1_4D27_4B5A_9F10_7C2E5B8D3A96
+
+#include "scene/lightScene.h"
+#include "scene/stressScene.h"
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.h>
+
+// Upper bound of --frames-in-flight, more only adds latency
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// Fixed timestep of benchmark playback
+constexpr float DEFAULT_BENCHMARK_STEP_MS = 1000.0f / 60.0f;
+
+// Frames rendered by a headless run that doesn't pass --frames
+constexpr uint32_t DEFAULT_HEADLESS_FRAMES = 1000;
+
+// Light counts of --compare-lights
+constexpr uint32_t LIGHT_BENCHMARK_COUNTS[] = {10, 1000, 10000};
+
+// Startup options of the engine. Everything has a default so the engine runs
+// without any arguments.
+struct EngineConfig {
+  // Lays down depth with a position-only pipeline first, the shaded pass then
+  // only runs its fragment shader for the visible surface
+  bool depthPrepass{false};
+
+  // Frames the CPU may record ahead of the GPU. 1 gives the lowest latency,
+  // more frames hide CPU and GPU stalls
+  uint32_t framesInFlight{2};
+
+  // Preferred present mode. Unsupported modes fall back to MAILBOX and then
+  // FIFO, which is always available.
+  VkPresentModeKHR presentMode{VK_PRESENT_MODE_FIFO_KHR};
+
+  // Scales the render resolution every frame to keep the measured GPU time at
+  // targetFrameMs. The result is upscaled to the window. targetFrameMs is
+  // also the budget frame statistics count overruns against.
+  bool dynamicResolution{false};
+  float targetFrameMs{16.6f};
+  float minRenderScale{0.5f};
+
+  // Renders offscreen without SDL, a window or a swapchain, so any Vulkan 1.1
+  // device works, software ones like lavapipe included
+  bool headless{false};
+
+  // Quits after this many frames, 0 runs until the window is closed. In
+  // benchmark mode this is the length of each run, 0 plays the whole path.
+  uint32_t frameLimit{0};
+
+  // Plays this camera path back with a fixed timestep and input disabled,
+  // then writes a JSON report of the frame times to benchmarkReport
+  std::string benchmarkPath;
+  float benchmarkStepMs{DEFAULT_BENCHMARK_STEP_MS};
+  std::string benchmarkReport{"benchmark.json"};
+  // Plays the path once without and once with the depth prepass
+  bool compareDepthPrepass{false};
+
+  // Records the camera of an interactive session as a path for benchmarks
+  std::string recordPath;
+
+  // Instances of the monkey added to the scene, none by default
+  StressSceneSettings stressScene;
+
+  // Point and spot lights shaded through the light clusters, none by default
+  LightSceneSettings lights;
+  // Plays the path once per count of LIGHT_BENCHMARK_COUNTS instead
+  bool compareLights{false};
+
+  // Draws lost_empire as greedy meshed voxel chunks converted from its OBJ
+  // instead of the OBJ's triangles
+  bool voxelWorld{false};
+  // Random block edits per second, every edit remeshes the chunks it touches
+  float voxelEditsPerSecond{0.0f};
+
+  // Records CPU and GPU zones for the whole session and writes them to this
+  // file as a Chrome trace on exit. Empty disables the trace.
+  std::string tracePath;
+
+  // Writes the per-frame times of the last frames to this CSV file on exit
+  std::string frameStatsPath;
+
+  // Counts vertices, primitives and fragment shader invocations of the scene
+  // passes. Ignored when the device lacks pipelineStatisticsQuery.
+  bool pipelineStatistics{false};
+
+  // Records, submits and presents on a thread of its own, so the next frame
+  // is updated and prepared while the last one is recorded
+  bool renderThread{false};
+  // Plays the path once on a single thread and once with the render thread
+  bool compareRenderThread{false};
+};
+
+// Reads the options from the command line. Unknown arguments are reported and
+// ignored.
+EngineConfig parse_engine_config(int argc, char* argv[]);
+
+const char* present_mode_name(VkPresentModeKHR mode);
+
+#endif /* A8E3F6C1_4D27_4B5A_9F10_7C2E5B8D3A96 */
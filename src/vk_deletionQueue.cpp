@@ -0,0 +1,66 @@
+#include "vk_deletionQueue.h"
+
+// Destroys the newest handle first and leaves the array empty with its
+// capacity kept
+template <typename T, typename Destroy>
+static void destroy_all(std::vector<T>& handles, Destroy destroy) {
+  for (auto it = handles.rbegin(); it != handles.rend(); it++) {
+    destroy(*it);
+  }
+  handles.clear();
+}
+
+void DeletionQueue::init(VkDevice device, VmaAllocator allocator,
+                         MemoryTracker* tracker) {
+  _device = device;
+  _allocator = allocator;
+  _tracker = tracker;
+}
+
+void DeletionQueue::flush() {
+  destroy_all(_callbacks, [](const Callback& callback) {
+    callback.function(callback.context);
+  });
+
+  destroy_all(_pipelines, [&](VkPipeline pipeline) {
+    vkDestroyPipeline(_device, pipeline, nullptr);
+  });
+  destroy_all(_pipelineLayouts, [&](VkPipelineLayout layout) {
+    vkDestroyPipelineLayout(_device, layout, nullptr);
+  });
+  destroy_all(_descriptorPools, [&](VkDescriptorPool pool) {
+    vkDestroyDescriptorPool(_device, pool, nullptr);
+  });
+  destroy_all(_descriptorSetLayouts, [&](VkDescriptorSetLayout layout) {
+    vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+  });
+  destroy_all(_samplers, [&](VkSampler sampler) {
+    vkDestroySampler(_device, sampler, nullptr);
+  });
+  destroy_all(_imageViews, [&](VkImageView view) {
+    vkDestroyImageView(_device, view, nullptr);
+  });
+  destroy_all(_images, [&](const AllocatedImage& image) {
+    if (_tracker) _tracker->untrack(image._allocation);
+    vmaDestroyImage(_allocator, image._image, image._allocation);
+  });
+  destroy_all(_buffers, [&](const AllocatedBuffer& buffer) {
+    if (_tracker) _tracker->untrack(buffer._allocation);
+    vmaDestroyBuffer(_allocator, buffer._buffer, buffer._allocation);
+  });
+  destroy_all(_renderPasses, [&](VkRenderPass renderPass) {
+    vkDestroyRenderPass(_device, renderPass, nullptr);
+  });
+  destroy_all(_commandPools, [&](VkCommandPool pool) {
+    vkDestroyCommandPool(_device, pool, nullptr);
+  });
+  destroy_all(_fences, [&](VkFence fence) {
+    vkDestroyFence(_device, fence, nullptr);
+  });
+  destroy_all(_semaphores, [&](VkSemaphore semaphore) {
+    vkDestroySemaphore(_device, semaphore, nullptr);
+  });
+  destroy_all(_swapchains, [&](VkSwapchainKHR swapchain) {
+    vkDestroySwapchainKHR(_device, swapchain, nullptr);
+  });
+}
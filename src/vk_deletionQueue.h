@@ -1,22 +1,101 @@
 #ifndef D1C6ECBC_BEB2_49E8_8B46_03786A22C95C
 #define D1C6ECBC_BEB2_49E8_8B46_03786A22C95C
 
-#include <functional>
-#include <deque>
+#include "vk_types.h"
+#include "vk_memoryTracker.h"
 
-struct DeletionQueue {
-  std::deque<std::function<void()>> deletors;
+#include <vector>
 
-  void push_function(std::function<void()>&& func) {
-    deletors.push_back(std::move(func));
+// Destroys Vulkan objects in bulk. Every handle type has its own array, so
+// registering a resource only appends its handle and allocates nothing once
+// the arrays have grown. flush() runs the cleanup callbacks and then walks
+// the arrays, newest first, in an order where objects go before the ones
+// they were created from. It leaves the queue empty for reuse.
+class DeletionQueue {
+ public:
+  // The tracker is optional, buffers and images are untracked before they
+  // are freed
+  void init(VkDevice device, VmaAllocator allocator, MemoryTracker* tracker);
+
+  // For subsystems that free their own resources. Callbacks must not push
+  // to the queue they are flushed from.
+  void push_callback(void (*callback)(void*), void* context) {
+    _callbacks.push_back({callback, context});
+  }
+
+  // Calls object->cleanup()
+  template <typename T>
+  void push_cleanup(T* object) {
+    push_callback([](void* context) { static_cast<T*>(context)->cleanup(); },
+                  object);
   }
 
-  void flush() {
-    // Reverse iterate the deletion queue to eqecute all the function
-    for (auto it = deletors.rbegin(); it != deletors.rend(); it++) {
-      (*it)();  // Function call
-    }
+  void push_pipeline(VkPipeline pipeline) { _pipelines.push_back(pipeline); }
+
+  void push_pipeline_layout(VkPipelineLayout layout) {
+    _pipelineLayouts.push_back(layout);
+  }
+
+  void push_descriptor_pool(VkDescriptorPool pool) {
+    _descriptorPools.push_back(pool);
+  }
+
+  void push_descriptor_set_layout(VkDescriptorSetLayout layout) {
+    _descriptorSetLayouts.push_back(layout);
+  }
+
+  void push_sampler(VkSampler sampler) { _samplers.push_back(sampler); }
+
+  void push_image_view(VkImageView view) { _imageViews.push_back(view); }
+
+  void push_image(const AllocatedImage& image) { _images.push_back(image); }
+
+  void push_buffer(const AllocatedBuffer& buffer) {
+    _buffers.push_back(buffer);
   }
+
+  void push_render_pass(VkRenderPass renderPass) {
+    _renderPasses.push_back(renderPass);
+  }
+
+  void push_command_pool(VkCommandPool pool) { _commandPools.push_back(pool); }
+
+  void push_fence(VkFence fence) { _fences.push_back(fence); }
+
+  void push_semaphore(VkSemaphore semaphore) {
+    _semaphores.push_back(semaphore);
+  }
+
+  void push_swapchain(VkSwapchainKHR swapchain) {
+    _swapchains.push_back(swapchain);
+  }
+
+  void flush(void);
+
+ private:
+  struct Callback {
+    void (*function)(void*);
+    void* context;
+  };
+
+  VkDevice _device{VK_NULL_HANDLE};
+  VmaAllocator _allocator{VK_NULL_HANDLE};
+  MemoryTracker* _tracker{nullptr};
+
+  std::vector<Callback> _callbacks;
+  std::vector<VkPipeline> _pipelines;
+  std::vector<VkPipelineLayout> _pipelineLayouts;
+  std::vector<VkDescriptorPool> _descriptorPools;
+  std::vector<VkDescriptorSetLayout> _descriptorSetLayouts;
+  std::vector<VkSampler> _samplers;
+  std::vector<VkImageView> _imageViews;
+  std::vector<AllocatedImage> _images;
+  std::vector<AllocatedBuffer> _buffers;
+  std::vector<VkRenderPass> _renderPasses;
+  std::vector<VkCommandPool> _commandPools;
+  std::vector<VkFence> _fences;
+  std::vector<VkSemaphore> _semaphores;
+  std::vector<VkSwapchainKHR> _swapchains;
 };
 
 #endif /* D1C6ECBC_BEB2_49E8_8B46_03786A22C95C */
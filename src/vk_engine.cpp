@@ -3,6 +3,8 @@
 #include "vk_types.h"
 #include "vk_initializers.h"
 #include "vk_textures.h"
+#include "voxel/greedyMesher.h"
+#include "voxel/objVoxelizer.h"
 
 #if defined(WIN32) || defined(WIN64) || defined(_WIN32) || defined(_WIN64)
 #include <SDL.h>
@@ -17,6 +19,8 @@
 #include <windows.h>
 #elif defined(__APPLE__)
 #include <mach-o/dyld.h>
+#elif defined(__linux__)
+#include <unistd.h>
 #endif
 
 #include <VkBootstrap.h>
@@ -28,17 +32,13 @@
 
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
 #include <limits.h>
-
-// Defined to imediately abort when there is an arror.
-#define VK_CHECK(x)                                               \
-  do {                                                            \
-    VkResult err = x;                                             \
-    if (err) {                                                    \
-      std::cout << "Detected Vulkan error: " << err << std::endl; \
-      abort();                                                    \
-    }                                                             \
-  } while (0);
+#include <thread>
+#include <utility>
 
 CameraPositioner_FirstPerson positioner(glm::vec3{-7.0f, 13.0f, 0.0f},
                                         glm::vec3{-7.0f, 13.0f, -1.0f},
@@ -46,59 +46,101 @@ CameraPositioner_FirstPerson positioner(glm::vec3{-7.0f, 13.0f, 0.0f},
 
 Camera camera(positioner);
 
-FramesPerSecondCounter fpsCounter(0.1f);
+// Played back in benchmark mode
+CameraPath cameraPath;
+CameraPositioner_Path pathPositioner;
+
+// Filled from positioner when --record-path is given
+CameraPath recordedPath;
+
+// The stress scene is built around the monkey's spot in front of the camera
+const glm::vec3 STRESS_SCENE_CENTER{-7.0f, 13.0f, -15.0f};
+
+// Seconds between two recorded camera keyframes
+constexpr double CAMERA_RECORD_INTERVAL = 0.25;
+
+// Same edits in every run of --voxel-edits
+constexpr uint32_t VOXEL_EDIT_SEED = 1;
+
+// Renderables whose bounds one job computes when the BVH is rebuilt
+constexpr size_t MIN_BOUNDS_CHUNK = 4096;
 
 struct MouseState {
   glm::vec2 pos = glm::vec2(0.0f);
   bool pressedLeft = false;
 } mouseState;
 
-Material* VulkanEngine::create_material(VkPipeline pipeline,
-                                        VkPipelineLayout layout,
-                                        const std::string& name) {
+MaterialHandle VulkanEngine::create_material(VkPipeline pipeline,
+                                             VkPipelineLayout layout,
+                                             const std::string& name) {
   Material mat;
   mat.pipeline = pipeline;
   mat.pipelineLayout = layout;
-  _materials[name] = mat;
-  return &_materials[name];
+  const MaterialHandle handle = _materials.create(std::move(mat));
+  _materialNames[name] = handle;
+  return handle;
 }
 
-Material* VulkanEngine::get_material(const std::string& name) {
-  auto it = _materials.find(name);
-  if (it == _materials.end()) {
-    return nullptr;
-  } else {
-    return &(*it).second;
-  }
+// Null handle when the name is unknown
+template <typename T>
+static Handle<T> find_handle(
+    const std::unordered_map<std::string, Handle<T>>& names,
+    const std::string& name) {
+  auto it = names.find(name);
+  return it == names.end() ? Handle<T>() : it->second;
 }
 
-Mesh* VulkanEngine::get_mesh(const std::string& name) {
-  auto it = _meshes.find(name);
-  if (it == _meshes.end()) {
-    return nullptr;
-  } else {
-    return &(*it).second;
-  }
+MaterialHandle VulkanEngine::find_material(const std::string& name) const {
+  return find_handle(_materialNames, name);
+}
+
+MeshHandle VulkanEngine::find_mesh(const std::string& name) const {
+  return find_handle(_meshNames, name);
+}
+
+TextureHandle VulkanEngine::find_texture(const std::string& name) const {
+  return find_handle(_textureNames, name);
 }
 
 void VulkanEngine::init() {
-  // We initialize SDL and create a window with it.
-  SDL_Init(SDL_INIT_VIDEO);
-
-  SDL_WindowFlags window_flags =
-      (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
-
-  _window = SDL_CreateWindow(   // SDL window creation
-      "Vulkan Engine",          // Window title
-      SDL_WINDOWPOS_UNDEFINED,  // Window pos x
-      SDL_WINDOWPOS_UNDEFINED,  // Window pos y
-      _windowExtent.width,      // Window width in pixels
-      _windowExtent.height,     // Window heifht in pixels
-      window_flags              // Window flags
-  );
+  // Headless runs have no window, the scene target is simply not presented
+  if (!_config.headless) {
+    // We initialize SDL and create a window with it.
+    SDL_Init(SDL_INIT_VIDEO);
+
+    SDL_WindowFlags window_flags =
+        (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+
+    _window = SDL_CreateWindow(   // SDL window creation
+        "Vulkan Engine",          // Window title
+        SDL_WINDOWPOS_UNDEFINED,  // Window pos x
+        SDL_WINDOWPOS_UNDEFINED,  // Window pos y
+        _windowExtent.width,      // Window width in pixels
+        _windowExtent.height,     // Window heifht in pixels
+        window_flags              // Window flags
+    );
+  }
 
   init_path();
 
+  // The main thread joins in while it waits, the render thread gets a core
+  // of its own
+  const uint32_t reserved = _config.renderThread ? 2 : 1;
+  _jobs.init(std::max(std::thread::hardware_concurrency(), reserved + 1) -
+             reserved);
+  _transforms.set_job_system(&_jobs);
+
+  _frames.resize(_config.framesInFlight);
+  _latency.init(frame_count());
+
+  size_t snapshotCapacity = 2;
+  while (snapshotCapacity < frame_count()) snapshotCapacity *= 2;
+  _snapshots.init(snapshotCapacity);
+
+  _renderExtent = _windowExtent;
+  _dynamicResolution.init(_config.targetFrameMs, _config.minRenderScale);
+  _frameStats.init(_config.targetFrameMs);
+
   init_vulkan();
 
   init_swapchain();
@@ -107,12 +149,16 @@ void VulkanEngine::init() {
 
   init_default_renderpass();
 
-  init_framebuffers();
-
   init_sync_structures();
 
+  init_profiler();
+
   init_descriptors();
 
+  init_clustered_lighting();
+
+  init_occlusion_culling();
+
   init_pipelines();
 
   load_images();
@@ -121,120 +167,599 @@ void VulkanEngine::init() {
 
   init_scene();
 
+  init_render_graph();
+
+  _memoryTracker.print();
+
+  _previousFrameTime = std::chrono::steady_clock::now();
+
+  if (_config.renderThread) start_render_thread();
+
   _isInitialized = true;
 }
 
 void VulkanEngine::cleanup() {
   if (_isInitialized) {
+    stop_render_thread();
+
     // Make sure the GPU has stopped doing its things
     vkDeviceWaitIdle(_device);
 
+    _latency.print_summary("Average latency");
+
+    if (!_config.recordPath.empty() && !recordedPath.empty() &&
+        recordedPath.save(_config.recordPath)) {
+      std::cout << "Recorded " << recordedPath.size()
+                << " camera keyframes to " << _config.recordPath << std::endl;
+    }
+    _frameStats.print("Frame time");
+
+    if (!_config.frameStatsPath.empty() &&
+        _frameStats.write_csv(_config.frameStatsPath)) {
+      std::cout << "Wrote frame times to " << _config.frameStatsPath
+                << std::endl;
+    }
+
+    if (!_config.tracePath.empty()) {
+      _profiler.stop_trace();
+      if (_profiler.write_trace(_config.tracePath)) {
+        std::cout << "Wrote trace to " << _config.tracePath << std::endl;
+      }
+    }
+
+    for (FrameData& frame : _frames) {
+      frame._deletionQueue.flush();
+    }
     _mainDeletionQueue.flush();
+    vmaDestroyAllocator(_allocator);
+
+    _jobs.shutdown();
 
-    vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    if (!_config.headless) {
+      vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    }
 
     vkDestroyDevice(_device, nullptr);
     vkb::destroy_debug_utils_messenger(_instance, _debug_messenger);
     vkDestroyInstance(_instance, nullptr);
 
-    SDL_DestroyWindow(_window);
+    if (!_config.headless) {
+      SDL_DestroyWindow(_window);
+    }
   }
 }
 
 void VulkanEngine::draw() {
   // If window is minimized skip drawing
-  if (SDL_GetWindowFlags(_window) & SDL_WINDOW_MINIMIZED) return;
+  if (!_config.headless &&
+      (SDL_GetWindowFlags(_window) & SDL_WINDOW_MINIMIZED)) {
+    return;
+  }
+
+  const uint32_t frameIndex = get_frame_index();
 
   // Wait untill the GPU has finished rendering the last frame. Timeout of 1 sec
-  VK_CHECK(vkWaitForFences(_device, 1, &get_current_frame()._renderFence,
-                           VK_TRUE, 1000000000));
-  VK_CHECK(vkResetFences(_device, 1, &get_current_frame()._renderFence));
+  {
+    ScopedCpuZone zone(_profiler, "wait for fence");
+    _frameStats.wait_begin();
+    // The render thread may not even have submitted the slot's last frame
+    wait_for_finished(_frameNumber - static_cast<int>(frame_count()) + 1);
+    VK_CHECK(vkWaitForFences(_device, 1, &get_current_frame()._renderFence,
+                             VK_TRUE, 1000000000));
+    VK_CHECK(vkResetFences(_device, 1, &get_current_frame()._renderFence));
+    _frameStats.wait_end();
+  }
+
+  // What was retired after this slot was last prepared, nothing in flight
+  // uses it anymore
+  get_current_frame()._deletionQueue.flush();
+
+  _latency.completed(frameIndex);
+
+  // The timestamps of this slot are available now
+  _profiler.collect(frameIndex);
+
+  _memoryTracker.update(static_cast<uint32_t>(_frameNumber));
+
+  update_render_scale();
+
+  // The fence guarantees the GPU is done reading this frame's ring region
+  _transientAllocator.begin_frame(frameIndex);
+
+  // Never full, only the frames of the other slots can be unfinished
+  FrameSnapshot& snapshot = *_snapshots.claim();
+  snapshot.frameIndex = frameIndex;
+  prepare_frame_data(snapshot);
+
+  _transientAllocator.end_frame();
+
+  _latency.prepared(frameIndex);
+
+  _snapshots.publish();
+  _frameNumber++;
+
+  if (!_renderThread.joinable()) {
+    render_frame(*_snapshots.front(), false);
+    _snapshots.pop();
+    _finishedFrames.fetch_add(1, std::memory_order_release);
+    return;
+  }
+
+  {
+    // The render thread between checking the ring and sleeping would miss
+    // the notify otherwise
+    std::lock_guard<std::mutex> lock(_renderMutex);
+  }
+  _renderWake.notify_one();
 
-  VK_CHECK(vkResetCommandBuffer(get_current_frame()._mainCommandBuffer, 0));
+  // Presents happen on the render thread, publishing is this thread's
+  // equivalent. Once the ring backs up both run at the same rate.
+  _frameStats.presented();
+}
+
+void VulkanEngine::render_frame(const FrameSnapshot& snapshot,
+                                bool onRenderThread) {
+  const uint32_t frameIndex = snapshot.frameIndex;
+  FrameData& frame = _frames[frameIndex];
+
+  VK_CHECK(vkResetCommandBuffer(frame._mainCommandBuffer, 0));
 
   // Get the index of the next available swapchain image:
-  uint32_t swapchainImageIndex;
-  VK_CHECK(                                                         //
-      vkAcquireNextImageKHR(_device,                                //
-                            _swapchain,                             //
-                            1000000000,                             //
-                            get_current_frame()._presentSemaphore,  //
-                            nullptr,                                //
-                            &swapchainImageIndex)                   //
-  );
+  uint32_t swapchainImageIndex = 0;
+  if (!_config.headless) {
+    // Blocks when no image is free, which isn't CPU work either
+    if (!onRenderThread) _frameStats.wait_begin();
+    VK_CHECK(                                           //
+        vkAcquireNextImageKHR(_device,                  //
+                              _swapchain,               //
+                              1000000000,               //
+                              frame._presentSemaphore,  //
+                              nullptr,                  //
+                              &swapchainImageIndex)     //
+    );
+    if (!onRenderThread) _frameStats.wait_end();
+  }
 
-  VkCommandBuffer cmd = get_current_frame()._mainCommandBuffer;
+  VkCommandBuffer cmd = frame._mainCommandBuffer;
+
+  const Profiler::Clock::time_point recordBegin = Profiler::Clock::now();
 
   VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(
       VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
   VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
 
-  VkClearValue clearValue;
-  clearValue.color = {{0.01f, 0.01f, 0.01f, 1.0f}};
+  _profiler.begin_frame(cmd, frameIndex);
 
-  // Clear depth at 1
-  VkClearValue depthClear;
-  depthClear.depthStencil.depth = 1.0f;
-
-  VkRenderPassBeginInfo rpInfo = vkinit::render_pass_begin_info(
-      _renderPass, _windowExtent, _framebuffers[swapchainImageIndex]);
-
-  // Connect clear values
-  rpInfo.clearValueCount = 2;
+  // The culling buffers may have grown since the last frame
+  if (snapshot.occlusionCulling) {
+    _renderGraph.set_buffer(_rgVisibility, snapshot.visibility);
+    _renderGraph.set_buffer(_rgEarlyCommands, snapshot.earlyCommands);
+    _renderGraph.set_buffer(_rgLateCommands, snapshot.lateCommands);
+  }
+  if (!_config.headless) {
+    _renderGraph.set_image(_rgSwapchain, _swapchainImages[swapchainImageIndex],
+                           _swapchainImageViews[swapchainImageIndex]);
+  }
 
-  VkClearValue clearValues[] = {clearValue, depthClear};
+  // Counts every pass, the culling dispatches and the blit add nothing to
+  // the graphics counters
+  _profiler.begin_pipeline_stats(cmd, snapshot.renderExtent);
 
-  rpInfo.pClearValues = &clearValues[0];
+  _recording = &snapshot;
+  _renderGraph.execute(cmd, snapshot.renderExtent, &_profiler);
+  _recording = nullptr;
 
-  vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+  _profiler.end_pipeline_stats(cmd);
 
-  draw_objects(cmd, _renderables.data(), _renderables.size());
+  _profiler.end_frame(cmd);
 
-  // End the renderpass
-  vkCmdEndRenderPass(cmd);
   // End the command buffer recording
   VK_CHECK(vkEndCommandBuffer(cmd));
 
+  _profiler.add_cpu_zone("record", recordBegin, Profiler::Clock::now());
+
   VkSubmitInfo submit = vkinit::submit_info(&cmd);
-  VkPipelineStageFlags waitStage =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  // The swapchain image is only touched by the final blit
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 
   submit.pWaitDstStageMask = &waitStage;
 
-  submit.waitSemaphoreCount = 1;
-  submit.pWaitSemaphores = &get_current_frame()._presentSemaphore;
+  // Without a swapchain there's nothing to wait on or signal
+  const uint32_t semaphoreCount = _config.headless ? 0 : 1;
 
-  submit.signalSemaphoreCount = 1;
-  submit.pSignalSemaphores = &get_current_frame()._renderSemaphore;
+  submit.waitSemaphoreCount = semaphoreCount;
+  submit.pWaitSemaphores = &frame._presentSemaphore;
 
-  VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit,
-                         get_current_frame()._renderFence));
+  submit.signalSemaphoreCount = semaphoreCount;
+  submit.pSignalSemaphores = &frame._renderSemaphore;
+
+  {
+    ScopedCpuZone zone(_profiler, "submit");
+    VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit, frame._renderFence));
+  }
+
+  _latency.submitted(frameIndex);
+
+  if (_config.headless) {
+    if (!onRenderThread) _frameStats.presented();
+    return;
+  }
 
   VkPresentInfoKHR presentInfo = vkinit::present_info();
 
   presentInfo.pSwapchains = &_swapchain;
   presentInfo.swapchainCount = 1;
 
-  presentInfo.pWaitSemaphores = &get_current_frame()._renderSemaphore;
+  presentInfo.pWaitSemaphores = &frame._renderSemaphore;
   presentInfo.waitSemaphoreCount = 1;
 
   presentInfo.pImageIndices = &swapchainImageIndex;
 
-  VK_CHECK(vkQueuePresentKHR(_graphicsQueue, &presentInfo));
+  {
+    ScopedCpuZone zone(_profiler, "present");
+    VK_CHECK(vkQueuePresentKHR(_graphicsQueue, &presentInfo));
+  }
 
-  _frameNumber++;
+  _latency.presented(frameIndex);
+  if (!onRenderThread) _frameStats.presented();
+}
+
+void VulkanEngine::start_render_thread() {
+  if (_renderThread.joinable()) return;
+
+  _renderStop = false;
+  _renderThread = std::thread([this]() { render_thread_main(); });
+}
+
+void VulkanEngine::stop_render_thread() {
+  if (!_renderThread.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(_renderMutex);
+    _renderStop = true;
+  }
+  _renderWake.notify_one();
+
+  _renderThread.join();
+}
+
+void VulkanEngine::render_thread_main() {
+  for (;;) {
+    const FrameSnapshot* snapshot = _snapshots.front();
+    if (snapshot == nullptr) {
+      std::unique_lock<std::mutex> lock(_renderMutex);
+      _renderWake.wait(
+          lock, [this]() { return _renderStop || !_snapshots.empty(); });
+
+      // Stopping still records what was published before
+      if (_renderStop && _snapshots.empty()) return;
+      continue;
+    }
+
+    render_frame(*snapshot, true);
+    _snapshots.pop();
+
+    {
+      std::lock_guard<std::mutex> lock(_renderMutex);
+      _finishedFrames.fetch_add(1, std::memory_order_release);
+    }
+    _frameFinished.notify_all();
+  }
+}
+
+void VulkanEngine::wait_for_finished(int frameNumber) {
+  if (_finishedFrames.load(std::memory_order_acquire) >= frameNumber) return;
+
+  std::unique_lock<std::mutex> lock(_renderMutex);
+  _frameFinished.wait(lock, [this, frameNumber]() {
+    return _finishedFrames.load(std::memory_order_acquire) >= frameNumber;
+  });
+}
+
+void VulkanEngine::init_profiler() {
+  // Needs the upload context for the clock calibration
+  _profiler.init(*this);
+
+  _mainDeletionQueue.push_cleanup(&_profiler);
+
+  if (!_config.tracePath.empty()) _profiler.start_trace();
+}
+
+void VulkanEngine::update_render_scale() {
+  float gpuMs;
+  if (_profiler.last_gpu_frame_ms(&gpuMs)) {
+    _gpuFrameMs = gpuMs;
+    if (_config.dynamicResolution) _dynamicResolution.update(gpuMs);
+  }
+
+  const float scale =
+      _config.dynamicResolution ? _dynamicResolution.scale() : 1.0f;
+
+  _renderExtent.width = std::max(
+      1u, static_cast<uint32_t>(std::lround(_windowExtent.width * scale)));
+  _renderExtent.height = std::max(
+      1u, static_cast<uint32_t>(std::lround(_windowExtent.height * scale)));
+  _renderExtent.width = std::min(_renderExtent.width, _windowExtent.width);
+  _renderExtent.height = std::min(_renderExtent.height, _windowExtent.height);
+}
+
+void VulkanEngine::set_render_viewport(VkCommandBuffer cmd,
+                                       VkExtent2D renderExtent) {
+  VkViewport viewport;
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(renderExtent.width);
+  viewport.height = static_cast<float>(renderExtent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+
+  VkRect2D scissor;
+  scissor.offset = {0, 0};
+  scissor.extent = renderExtent;
+
+  vkCmdSetViewport(cmd, 0, 1, &viewport);
+  vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+void VulkanEngine::blit_to_swapchain(VkCommandBuffer cmd, VkImage target,
+                                     VkExtent2D renderExtent) {
+  VkImageBlit blit = {};
+  blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  blit.srcSubresource.layerCount = 1;
+  blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width),
+                        static_cast<int32_t>(renderExtent.height), 1};
+  blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  blit.dstSubresource.layerCount = 1;
+  blit.dstOffsets[1] = {static_cast<int32_t>(_windowExtent.width),
+                        static_cast<int32_t>(_windowExtent.height), 1};
+
+  // Bilinear upscale, a plain copy when the scale is 1
+  vkCmdBlitImage(cmd, _renderGraph.image(_rgSceneColor),
+                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                 VK_FILTER_LINEAR);
+}
+
+void VulkanEngine::print_stats() {
+  _frameStats.print("Frame time");
+
+  PipelineStatsResult pipelineStats;
+  if (_profiler.last_pipeline_stats(&pipelineStats)) {
+    printf(
+        "Vertices %llu, VS invocations %llu (reuse %.2f), clipped primitives "
+        "%llu, FS invocations %llu (overdraw %.2f)\n",
+        static_cast<unsigned long long>(pipelineStats.inputVertices),
+        static_cast<unsigned long long>(pipelineStats.vertexInvocations),
+        pipelineStats.vertex_reuse(),
+        static_cast<unsigned long long>(pipelineStats.clippingPrimitives),
+        static_cast<unsigned long long>(pipelineStats.fragmentInvocations),
+        pipelineStats.overdraw());
+  }
+
+  if (!_profiler.gpu_supported()) return;
+
+  if (_config.dynamicResolution) {
+    printf(
+        "GPU %.2f ms (smoothed %.2f, target %.2f), render scale %.2f "
+        "(%ux%u)\n",
+        _dynamicResolution.last_ms(), _dynamicResolution.smoothed_ms(),
+        _dynamicResolution.target_ms(), _dynamicResolution.scale(),
+        _renderExtent.width, _renderExtent.height);
+  } else {
+    printf("GPU %.2f ms, render scale 1.00 (%ux%u)\n", _gpuFrameMs,
+           _renderExtent.width, _renderExtent.height);
+  }
+
+  // Skip the frame zone, it's the total printed above
+  const std::vector<GpuZoneResult>& zones = _profiler.last_gpu_zones();
+  for (size_t i = 1; i < zones.size(); i++) {
+    printf("  %-12s %6.3f ms\n", zones[i].name, zones[i].durationMs);
+  }
+}
+
+bool VulkanEngine::run_frame() {
+  const int previousFrameNumber = _frameNumber;
+  _frameStats.frame_begin();
+
+  _jobs.run_main_thread_jobs();
+  handle_input();
+  update();
+  draw();
+
+  // Nothing was rendered while minimized
+  if (_frameNumber == previousFrameNumber) return false;
+
+  float gpuMs;
+  if (!_profiler.last_gpu_frame_ms(&gpuMs)) gpuMs = FrameStats::NO_SAMPLE;
+  _frameStats.frame_end(gpuMs);
+
+  return true;
+}
+
+void VulkanEngine::run_benchmark() {
+  if (!cameraPath.load(_config.benchmarkPath)) return;
+
+  pathPositioner.setPath(&cameraPath);
+  camera = Camera(pathPositioner);
+  _benchmarking = true;
+
+  // One frame per step from the first keyframe to the last one
+  uint32_t frames = _config.frameLimit;
+  if (frames == 0) {
+    frames = static_cast<uint32_t>(std::ceil(cameraPath.duration() * 1000.0f /
+                                             _config.benchmarkStepMs)) +
+             1;
+  }
+
+  std::vector<BenchmarkRun> runs;
+  if (_config.compareLights) {
+    for (uint32_t count : LIGHT_BENCHMARK_COUNTS) {
+      if (bQuit) break;
+      _lightCount = std::min(count, _lightScene.count());
+      const std::string label = std::to_string(_lightCount) + " lights";
+      runs.push_back(run_benchmark_pass(label.c_str(), frames));
+    }
+  } else if (_config.compareRenderThread) {
+    stop_render_thread();
+    runs.push_back(run_benchmark_pass("single thread", frames));
+
+    start_render_thread();
+    if (!bQuit) runs.push_back(run_benchmark_pass("render thread", frames));
+  } else if (_config.compareDepthPrepass) {
+    _config.depthPrepass = false;
+    runs.push_back(run_benchmark_pass("no depth prepass", frames));
+
+    _config.depthPrepass = true;
+    if (!bQuit) runs.push_back(run_benchmark_pass("depth prepass", frames));
+  } else {
+    runs.push_back(run_benchmark_pass("default", frames));
+  }
+
+  if (bQuit) {
+    std::cout << "Benchmark interrupted, no report written" << std::endl;
+    return;
+  }
+
+  BenchmarkInfo info;
+  info.device = _gpuProperties.deviceName;
+  info.cameraPath = _config.benchmarkPath;
+  info.width = _windowExtent.width;
+  info.height = _windowExtent.height;
+  info.framesPerRun = frames;
+  info.stepMs = _config.benchmarkStepMs;
+  info.budgetMs = _config.targetFrameMs;
+  info.framesInFlight = frame_count();
+  info.presentMode =
+      _config.headless ? "none" : present_mode_name(_presentMode);
+  info.headless = _config.headless;
+  info.dynamicResolution = _config.dynamicResolution;
+  info.objects = static_cast<uint32_t>(_renderables.size());
+  info.stressObjects = _config.stressScene.count;
+  info.stressLayout = stress_layout_name(_config.stressScene.layout);
+  info.animatedFraction = _config.stressScene.animatedFraction;
+
+  if (write_benchmark_report(_config.benchmarkReport, info, runs)) {
+    std::cout << "Wrote benchmark report to " << _config.benchmarkReport
+              << std::endl;
+  }
+}
+
+BenchmarkRun VulkanEngine::run_benchmark_pass(const char* label,
+                                              uint32_t frames) {
+  // Keep the previous run's frames out of this one's GPU times
+  wait_render_idle();
+  vkDeviceWaitIdle(_device);
+
+  // The window holds the whole run so the report covers every frame
+  _frameStats.init(_config.targetFrameMs, frames);
+  _benchmarkTime = 0.0;
+
+  BenchmarkRun run;
+  run.label = label;
+  run.depthPrepass = _config.depthPrepass;
+  run.occlusionCulling = _occlusionCulling;
+  run.renderThread = _renderThread.joinable();
+  run.lights = _lightCount;
+  run.voxelWorld = _config.voxelWorld;
+  _voxelStats = VoxelRunStats{};
+
+  const auto start = std::chrono::steady_clock::now();
+
+  uint32_t rendered = 0;
+  while (!bQuit && rendered < frames) {
+    if (!run_frame()) continue;
+    rendered++;
+
+    for (const GpuZoneResult& zone : _profiler.last_gpu_zones()) {
+      auto it = std::find_if(run.gpuZones.begin(), run.gpuZones.end(),
+                             [&](const GpuZoneAverage& average) {
+                               return average.name == zone.name;
+                             });
+      if (it == run.gpuZones.end()) {
+        run.gpuZones.push_back({zone.name});
+        it = run.gpuZones.end() - 1;
+      }
+      it->totalMs += zone.durationMs;
+      it->samples++;
+    }
+
+    PipelineStatsResult pipelineStats;
+    if (_profiler.last_pipeline_stats(&pipelineStats)) {
+      run.pipelineStats += pipelineStats;
+      run.pipelineStatsFrames++;
+    }
+  }
+
+  wait_render_idle();
+  vkDeviceWaitIdle(_device);
+
+  run.frames = rendered;
+  run.seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  for (int metric = 0; metric < FrameStats::METRIC_COUNT; metric++) {
+    run.stats[metric] =
+        _frameStats.summary(static_cast<FrameStats::Metric>(metric));
+  }
+
+  if (_config.voxelWorld) {
+    _voxelStats.chunks = static_cast<uint32_t>(_voxelWorld.chunks().size());
+    _voxelStats.chunkBytes = _voxelWorld.memory_usage();
+    for (const auto& [coord, chunk] : _chunkMeshes) {
+      _voxelStats.meshBytes += _meshes.get(chunk.mesh)->_vertices.size() *
+                               (sizeof(Vertex) + sizeof(glm::vec3));
+    }
+    run.voxel = std::move(_voxelStats);
+  }
+
+  _frameStats.print(label);
+
+  return run;
 }
 
 void VulkanEngine::run() {
+  if (!_config.benchmarkPath.empty()) {
+    run_benchmark();
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
   while (!bQuit) {
-    handle_input();
-    update();
-    draw();
+    run_frame();
+
+    if (_config.frameLimit > 0 &&
+        _frameNumber >= static_cast<int>(_config.frameLimit)) {
+      bQuit = true;
+    }
+  }
+
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  if (_frameNumber > 0) {
+    printf("Rendered %d frames in %.2f s, %.3f ms per frame\n", _frameNumber,
+           seconds, seconds * 1000.0 / _frameNumber);
   }
 }
 
 void VulkanEngine::handle_input() {
+  if (_config.headless) {
+    _latency.input_sampled();
+    return;
+  }
+
+  // Playback ignores input, the window can still be closed
+  if (_benchmarking) {
+    SDL_Event e;
+    while (SDL_PollEvent(&e) != 0) {
+      if (e.type == SDL_QUIT) bQuit = true;
+    }
+    _latency.input_sampled();
+    return;
+  }
+
   SDL_Event e;
   bool press = false;
 
@@ -242,10 +767,47 @@ void VulkanEngine::handle_input() {
   while (SDL_PollEvent(&e) != 0) {
     if (e.type == SDL_QUIT) bQuit = true;
 
+    if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_o &&
+        !e.key.repeat) {
+      _occlusionCulling = !_occlusionCulling;
+      std::cout << "Occlusion culling "
+                << (_occlusionCulling ? "enabled" : "disabled") << std::endl;
+
+      // The passes change, frames in flight still use the old graph
+      wait_render_idle();
+      vkDeviceWaitIdle(_device);
+      build_render_graph();
+    }
+
+    if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_p &&
+        !e.key.repeat) {
+      _config.depthPrepass = !_config.depthPrepass;
+      std::cout << "Depth prepass "
+                << (_config.depthPrepass ? "enabled" : "disabled") << std::endl;
+    }
+
+    if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_m &&
+        !e.key.repeat) {
+      _memoryTracker.print();
+    }
+
+    if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_f &&
+        !e.key.repeat) {
+      const std::string path = _config.frameStatsPath.empty()
+                                   ? "frame_stats.csv"
+                                   : _config.frameStatsPath;
+      if (_frameStats.write_csv(path)) {
+        std::cout << "Wrote frame times to " << path << std::endl;
+      }
+    }
+
     if (e.type == SDL_MOUSEBUTTONDOWN) {
       if (e.button.button == SDL_BUTTON_LEFT) {
         mouseState.pressedLeft = e.button.state == SDL_PRESSED;
       }
+      if (e.button.button == SDL_BUTTON_RIGHT) {
+        pick_object(e.button.x, e.button.y);
+      }
     }
 
     if (e.type == SDL_MOUSEBUTTONUP) {
@@ -262,6 +824,9 @@ void VulkanEngine::handle_input() {
 
   SDL_SetRelativeMouseMode(mouseState.pressedLeft ? SDL_TRUE : SDL_FALSE);
 
+  // Everything that reaches the frame was sampled by now
+  _latency.input_sampled();
+
   mouseState.pos.x = static_cast<float>(_mouseX / (float)_windowExtent.width);
   mouseState.pos.y = static_cast<float>(-_mouseY / (float)_windowExtent.height);
 
@@ -314,14 +879,122 @@ void VulkanEngine::handle_input() {
 }
 
 void VulkanEngine::update() {
-  double deltaTime = (SDL_GetTicks() - _milisecondsPreviousFrame) / 1000.0f;
-  _milisecondsPreviousFrame = SDL_GetTicks();
+  ScopedCpuZone zone(_profiler, "update");
+
+  double deltaTime;
+  if (_benchmarking) {
+    // Fixed timestep so every run renders the same views
+    deltaTime = _config.benchmarkStepMs / 1000.0;
+    pathPositioner.setTime(static_cast<float>(_benchmarkTime));
+    _benchmarkTime += deltaTime;
+  } else {
+    const auto now = std::chrono::steady_clock::now();
+    deltaTime = std::chrono::duration<double>(now - _previousFrameTime).count();
+    _previousFrameTime = now;
 
-#if defined(DEBUG)
-  fpsCounter.tick(deltaTime);
-#endif
+    positioner.update(deltaTime, mouseState.pos, mouseState.pressedLeft);
+
+    if (!_config.recordPath.empty()) record_camera(deltaTime);
+  }
+
+  _sceneTime += deltaTime;
+  _animationTime = _benchmarking ? _benchmarkTime : _sceneTime;
+  _stressScene.animate(_transforms, static_cast<float>(_animationTime));
+
+  if (_config.voxelWorld) update_voxel_world(deltaTime);
+
+  _statsTimer += deltaTime;
+  if (_statsTimer >= 1.0) {
+    print_stats();
+    _statsTimer = 0.0;
+  }
+
+  update_transforms();
+  update_scene_bvh();
+}
+
+void VulkanEngine::record_camera(double deltaTime) {
+  // The first keyframe is at time 0
+  if (recordedPath.empty() ||
+      _recordTime - _lastKeyframeTime >= CAMERA_RECORD_INTERVAL) {
+    CameraKeyframe keyframe;
+    keyframe.time = static_cast<float>(_recordTime);
+    keyframe.position = positioner.getPosition();
+    keyframe.orientation = positioner.getOrientation();
+    recordedPath.add_keyframe(keyframe);
+
+    _lastKeyframeTime = _recordTime;
+  }
+
+  _recordTime += deltaTime;
+}
+
+void VulkanEngine::update_transforms() {
+  ScopedCpuZone zone(_profiler, "update_transforms");
+
+  _objectBuffer.resize(static_cast<uint32_t>(_transforms.size()));
+
+  char* objectMatrices = reinterpret_cast<char*>(_objectBuffer.data()) +
+                         offsetof(GPUObjectData, modelMatrix);
+  _transforms.update(objectMatrices, sizeof(GPUObjectData));
+
+  for (TransformId id : _transforms.changed()) {
+    _objectBuffer.mark_dirty(id, 1);
+  }
+}
+
+void VulkanEngine::update_scene_bvh() {
+  ScopedCpuZone zone(_profiler, "update_scene_bvh");
+
+  if (_sceneBvhDirty) {
+    std::vector<uint32_t> ids(_renderables.size());
+    std::vector<Aabb> bounds(_renderables.size());
+    _jobs.parallel_for(0, _renderables.size(), MIN_BOUNDS_CHUNK,
+                       [&](size_t begin, size_t end) {
+                         for (size_t i = begin; i < end; i++) {
+                           ids[i] = _renderables[i].transform;
+                           bounds[i] = object_bounds(ids[i]);
+                         }
+                       });
+    _sceneBvh.build(ids.data(), bounds.data(),
+                    static_cast<uint32_t>(ids.size()));
+    _sceneBvhDirty = false;
+    return;
+  }
+
+  for (TransformId id : _transforms.changed()) {
+    if (_sceneBvh.contains(id)) _sceneBvh.set_bounds(id, object_bounds(id));
+  }
+  _sceneBvh.refit();
+}
+
+Aabb VulkanEngine::object_bounds(TransformId id) {
+  const glm::vec4 sphere = _objectBuffer.data()[id].sphereBounds;
+  return sphere_bounds(transform_sphere(_transforms.get_world(id),
+                                        glm::vec3(sphere), sphere.w));
+}
+
+void VulkanEngine::pick_object(int x, int y) {
+  // Vulkan's y points down, which the flipped projection already accounts for
+  const glm::vec2 ndc(2.0f * x / _windowExtent.width - 1.0f,
+                      2.0f * y / _windowExtent.height - 1.0f);
+  const glm::mat4 inverseViewProj = glm::inverse(_viewProj);
+  // glm::perspective maps the near plane to a depth of -1
+  glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndc, -1.0f, 1.0f);
+  glm::vec4 farPoint = inverseViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+  nearPoint /= nearPoint.w;
+  farPoint /= farPoint.w;
+
+  const glm::vec3 ray = glm::vec3(farPoint - nearPoint);
+  BvhHit hit;
+  if (!_sceneBvh.raycast(glm::vec3(nearPoint), glm::normalize(ray),
+                         glm::length(ray), &hit)) {
+    std::cout << "Picked nothing" << std::endl;
+    return;
+  }
 
-  positioner.update(deltaTime, mouseState.pos, mouseState.pressedLeft);
+  std::cout << "Picked object " << hit.object << " at " << hit.distance
+            << std::endl;
 }
 
 void VulkanEngine::init_path() {
@@ -341,6 +1014,15 @@ void VulkanEngine::init_path() {
       path += "/Resources";
     }
   }
+#elif defined(__linux__)
+  // Headless CI runs are launched from anywhere, resolve the binary location
+  char buf[PATH_MAX];
+  ssize_t length = readlink("/proc/self/exe", buf, PATH_MAX - 1);
+  if (length > 0) {
+    buf[length] = '\0';
+    path = buf;
+    path.erase(path.rfind('/'));
+  }
 #endif
 }
 
@@ -352,6 +1034,7 @@ void VulkanEngine::init_vulkan() {
                       .request_validation_layers(true)
                       .use_default_debug_messenger()
                       .require_api_version(1, 1, 0)
+                      .set_headless(_config.headless)
 #ifdef __APPLE__
                       .enable_extension("VK_MVK_macos_surface")
 #endif
@@ -369,22 +1052,59 @@ void VulkanEngine::init_vulkan() {
   // Store the debug messenger
   _debug_messenger = vkb_inst.debug_messenger;
 
-  // Get the surface of the window we opened with SDL
-  if (SDL_FALSE == SDL_Vulkan_CreateSurface(_window, _instance, &_surface)) {
-    std::cerr << "Failed to create surface, SDL Error: " << SDL_GetError()
-              << std::endl;
-  }
-
   // Use vkbootstrap to select a GPU
-  // We want a GPU that can write to the SDL surface and supports Vulkan 1.1
+  // We want a GPU that can write to the SDL surface and supports Vulkan 1.1.
+  // Headless runs take any Vulkan 1.1 device, software ones included.
   vkb::PhysicalDeviceSelector selector{vkb_inst};
-  auto phys_ret = selector                        //
-                      .set_minimum_version(1, 1)  //
-                      .set_surface(_surface)      //
-                      .select();                  //
+  selector.set_minimum_version(1, 1);
+  // Lets VMA report the driver's heap budgets instead of estimating them
+  selector.add_desired_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+  if (!_config.headless) {
+    // Get the surface of the window we opened with SDL
+    if (SDL_FALSE == SDL_Vulkan_CreateSurface(_window, _instance, &_surface)) {
+      std::cerr << "Failed to create surface, SDL Error: " << SDL_GetError()
+                << std::endl;
+    }
+
+    selector.set_surface(_surface);
+  }
+
+  auto phys_ret = selector.select();
+
+  if (!phys_ret) {
+    std::cerr << "Failed to select a GPU. Error: "
+              << phys_ret.error().message() << std::endl;
+  }
+
+  vkb::PhysicalDevice physicalDevice = phys_ret.value();
+
+  bool memoryBudget = false;
+  for (const std::string& extension : physicalDevice.get_extensions()) {
+    if (extension == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) memoryBudget = true;
+  }
+
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice.physical_device,
+                              &supportedFeatures);
+
+  // Pipeline statistics are optional, only enable them where supported
+  if (_config.pipelineStatistics) {
+    _pipelineStatistics =
+        supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+    physicalDevice.features.pipelineStatisticsQuery = _pipelineStatistics;
+
+    if (!_pipelineStatistics) {
+      std::cerr << "Pipeline statistics queries are not supported"
+                << std::endl;
+    }
+  }
+
+  _multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+  physicalDevice.features.multiDrawIndirect = _multiDrawIndirect;
 
   // Create the final Vulkan device
-  vkb::DeviceBuilder deviceBuilder{phys_ret.value()};
+  vkb::DeviceBuilder deviceBuilder{physicalDevice};
 
   VkPhysicalDeviceShaderDrawParametersFeatures shader_draw_parameters_features =
       {};
@@ -404,7 +1124,7 @@ void VulkanEngine::init_vulkan() {
 
   // Get the VkDevice handle used in the rest of a Vulkan application
   _device = vkbDevice.device;
-  _chosenGPU = phys_ret.value().physical_device;
+  _chosenGPU = physicalDevice.physical_device;
 
   // Get graphics queue using vkbootstrap
   _graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
@@ -416,9 +1136,20 @@ void VulkanEngine::init_vulkan() {
   allocatorInfo.physicalDevice = _chosenGPU;
   allocatorInfo.device = _device;
   allocatorInfo.instance = _instance;
+  // Vulkan 1.1 has the properties2 query the budget extension relies on
+  allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_1;
+  if (memoryBudget) {
+    allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+  }
   vmaCreateAllocator(&allocatorInfo, &_allocator);
 
-  _mainDeletionQueue.push_function([&]() { vmaDestroyAllocator(_allocator); });
+  _memoryTracker.init(_allocator, memoryBudget);
+
+  // The allocator itself is destroyed after the queues were flushed
+  _mainDeletionQueue.init(_device, _allocator, &_memoryTracker);
+  for (FrameData& frame : _frames) {
+    frame._deletionQueue.init(_device, _allocator, &_memoryTracker);
+  }
 
   vkGetPhysicalDeviceProperties(_chosenGPU,
                                 &_gpuProperties);  // for M1 mac 16
@@ -430,26 +1161,44 @@ void VulkanEngine::init_vulkan() {
 }
 
 void VulkanEngine::init_swapchain() {
-  vkb::SwapchainBuilder swapchainBuilder{_chosenGPU, _device, _surface};
-
-  vkb::Swapchain vkbSwapchain =
-      swapchainBuilder
-          .use_default_format_selection()                                 //
-          .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)             //
-          .set_desired_extent(_windowExtent.width, _windowExtent.height)  //
-          .build()                                                        //
-          .value();                                                       //
-
-  // Store swapchain and its related images
-  _swapchain = vkbSwapchain.swapchain;
-  _swapchainImages = vkbSwapchain.get_images().value();
-  _swapchainImageViews = vkbSwapchain.get_image_views().value();
-
-  _swapchainImageFormat = vkbSwapchain.image_format;
-
-  _mainDeletionQueue.push_function([=]() {                //
-    vkDestroySwapchainKHR(_device, _swapchain, nullptr);  //
-  });
+  if (_config.headless) {
+    // Nothing is presented, the scene target only needs a common color format
+    _swapchainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    std::cout << "Headless with " << frame_count() << " frames in flight"
+              << std::endl;
+  } else {
+    vkb::SwapchainBuilder swapchainBuilder{_chosenGPU, _device, _surface};
+
+    vkb::Swapchain vkbSwapchain =
+        swapchainBuilder
+            .use_default_format_selection()                                 //
+            .set_desired_present_mode(_config.presentMode)                  //
+            .add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)         //
+            .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR)            //
+            .set_desired_extent(_windowExtent.width, _windowExtent.height)  //
+            .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)         //
+            .build()                                                        //
+            .value();                                                       //
+
+    // Store swapchain and its related images
+    _swapchain = vkbSwapchain.swapchain;
+    _swapchainImages = vkbSwapchain.get_images().value();
+    _swapchainImageViews = vkbSwapchain.get_image_views().value();
+
+    _swapchainImageFormat = vkbSwapchain.image_format;
+    _presentMode = vkbSwapchain.present_mode;
+
+    std::cout << "Present mode " << present_mode_name(_presentMode) << " with "
+              << frame_count() << " frames in flight" << std::endl;
+
+    _mainDeletionQueue.push_swapchain(_swapchain);
+
+    // The swapchain images are only blitted to, their views are unused but
+    // still owned by us
+    for (VkImageView view : _swapchainImageViews) {
+      _mainDeletionQueue.push_image_view(view);
+    }
+  }
 
   // Depth image size will match the window
   VkExtent3D depthImageExtent = {_windowExtent.width, _windowExtent.height, 1};
@@ -459,8 +1208,10 @@ void VulkanEngine::init_swapchain() {
 
   // the depth image will be an image with the format we selected and Depth
   // Attachment usage flag
+  // The depth image is also sampled to build the occlusion culling pyramid
   VkImageCreateInfo dimg_info = vkinit::image_create_info(
-      _depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+      _depthFormat,
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
       depthImageExtent);
 
   // for the depth image, we want to allocate it from GPU local memory
@@ -472,6 +1223,7 @@ void VulkanEngine::init_swapchain() {
   // allocate and create the image
   vmaCreateImage(_allocator, &dimg_info, &dimg_allocinfo, &_depthImage._image,
                  &_depthImage._allocation, nullptr);
+  _memoryTracker.track(_depthImage._allocation, MemoryCategory::Attachment);
 
   // build an image-view for the depth image to use for rendering
   VkImageViewCreateInfo dview_info = vkinit::image_view_create_info(
@@ -480,17 +1232,19 @@ void VulkanEngine::init_swapchain() {
   VK_CHECK(vkCreateImageView(_device, &dview_info, nullptr, &_depthImageView));
 
   // add to deletion queues
-  _mainDeletionQueue.push_function([=]() {
-    vkDestroyImageView(_device, _depthImageView, nullptr);
-    vmaDestroyImage(_allocator, _depthImage._image, _depthImage._allocation);
-  });
+  _mainDeletionQueue.push_image_view(_depthImageView);
+  _mainDeletionQueue.push_image(_depthImage);
+
+  // The scene color matches the swapchain format so the final blit is a
+  // plain scale. The render graph allocates the image.
+  _sceneColorFormat = _swapchainImageFormat;
 }
 
 void VulkanEngine::init_commands() {
   VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(
       _graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
-  for (int i = 0; i < FRAME_OVERLAP; i++) {
+  for (uint32_t i = 0; i < frame_count(); i++) {
     VK_CHECK(                                          //
         vkCreateCommandPool(_device,                   //
                             &commandPoolInfo,          //
@@ -508,9 +1262,7 @@ void VulkanEngine::init_commands() {
                                  &_frames[i]._mainCommandBuffer)  //
     );
 
-    _mainDeletionQueue.push_function([=]() {                            //
-      vkDestroyCommandPool(_device, _frames[i]._commandPool, nullptr);  //
-    });
+    _mainDeletionQueue.push_command_pool(_frames[i]._commandPool);
   }
 
   VkCommandPoolCreateInfo uploadCommandPoolInfo =
@@ -523,11 +1275,7 @@ void VulkanEngine::init_commands() {
                           &_uploadContext._commandPool)  //
   );
 
-  _mainDeletionQueue.push_function([=]() {             //
-    vkDestroyCommandPool(_device,                      //
-                         _uploadContext._commandPool,  //
-                         nullptr);                     //
-  });
+  _mainDeletionQueue.push_command_pool(_uploadContext._commandPool);
 
   VkCommandBufferAllocateInfo cmdAllocInfo =
       vkinit::command_buffer_allocate_info(_uploadContext._commandPool, 1);
@@ -540,8 +1288,8 @@ void VulkanEngine::init_default_renderpass() {
   // The renderpass will use this color attachment.
   VkAttachmentDescription color_attachment = {};
 
-  // The attachment will have the format needed by the swapchain
-  color_attachment.format = _swapchainImageFormat;
+  // The scene is rendered offscreen in the swapchain format
+  color_attachment.format = _sceneColorFormat;
 
   // 1 sample, we won't be doing any MSAA
   color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -559,9 +1307,9 @@ void VulkanEngine::init_default_renderpass() {
   // We dob't know or care about the initial layout of the attachment
   color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-  // We want the attachment to be ready for presentation at the end of the
-  // renderpass
-  color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // We want the attachment to be ready for the blit to the swapchain at the
+  // end of the renderpass
+  color_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
   VkAttachmentReference color_attachment_ref = {};
 
@@ -594,10 +1342,12 @@ void VulkanEngine::init_default_renderpass() {
   subpass.pColorAttachments = &color_attachment_ref;
   subpass.pDepthStencilAttachment = &depth_attachment_ref;
 
+  // The previous frame's blit has to be done reading the color target
   VkSubpassDependency dependency = {};
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
   dependency.dstSubpass = 0;
-  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                            VK_PIPELINE_STAGE_TRANSFER_BIT;
   dependency.srcAccessMask = 0;
   dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
@@ -612,7 +1362,16 @@ void VulkanEngine::init_default_renderpass() {
                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
   depth_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-  VkSubpassDependency dependencies[2] = {dependency, depth_dependency};
+  VkSubpassDependency blit_dependency = {};
+  blit_dependency.srcSubpass = 0;
+  blit_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+  blit_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  blit_dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  blit_dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  blit_dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  VkSubpassDependency dependencies[3] = {dependency, depth_dependency,
+                                         blit_dependency};
 
   VkAttachmentDescription attachments[2] = {color_attachment, depth_attachment};
 
@@ -625,7 +1384,7 @@ void VulkanEngine::init_default_renderpass() {
   // Connect the subpass to the info
   render_pass_info.subpassCount = 1;
   render_pass_info.pSubpasses = &subpass;
-  render_pass_info.dependencyCount = 2;
+  render_pass_info.dependencyCount = 3;
   render_pass_info.pDependencies = &dependencies[0];
 
   VK_CHECK(  //
@@ -633,46 +1392,7 @@ void VulkanEngine::init_default_renderpass() {
                          &_renderPass)  //
   );
 
-  _mainDeletionQueue.push_function([=]() {               //
-    vkDestroyRenderPass(_device, _renderPass, nullptr);  //
-  });
-}
-
-void VulkanEngine::init_framebuffers() {
-  // Create the framebuffers for the swapchain image. Thiss will connect the
-  // preder-pass ti the images for rendering
-  VkFramebufferCreateInfo fb_info = {};
-  fb_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  fb_info.pNext = nullptr;
-
-  fb_info.renderPass = _renderPass;
-  fb_info.attachmentCount = 1;
-  fb_info.width = _windowExtent.width;
-  fb_info.height = _windowExtent.height;
-  fb_info.layers = 1;
-
-  // Grab how many images we have in the swapchain
-  const uint32_t swapchain_imagecount =
-      static_cast<uint32_t>(_swapchainImages.size());
-  _framebuffers = std::vector<VkFramebuffer>(swapchain_imagecount);
-
-  // Create a framebuffer for each image view in the swapchain
-  for (uint32_t i = 0; i < swapchain_imagecount; i++) {
-    VkImageView attachments[2];
-    attachments[0] = _swapchainImageViews[i];
-    attachments[1] = _depthImageView;
-
-    fb_info.pAttachments = attachments;
-    fb_info.attachmentCount = 2;
-
-    VK_CHECK(
-        vkCreateFramebuffer(_device, &fb_info, nullptr, &_framebuffers[i]));
-
-    _mainDeletionQueue.push_function([=]() {
-      vkDestroyFramebuffer(_device, _framebuffers[i], nullptr);
-      vkDestroyImageView(_device, _swapchainImageViews[i], nullptr);
-    });
-  }
+  _mainDeletionQueue.push_render_pass(_renderPass);
 }
 
 void VulkanEngine::init_sync_structures() {
@@ -681,7 +1401,7 @@ void VulkanEngine::init_sync_structures() {
 
   VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphore_create_info();
 
-  for (int i = 0; i < FRAME_OVERLAP; i++) {
+  for (uint32_t i = 0; i < frame_count(); i++) {
     VK_CHECK(                                    //
         vkCreateFence(_device,                   //
                       &fenceCreateInfo,          //
@@ -689,9 +1409,7 @@ void VulkanEngine::init_sync_structures() {
                       &_frames[i]._renderFence)  //
     );
 
-    _mainDeletionQueue.push_function([=]() {                      //
-      vkDestroyFence(_device, _frames[i]._renderFence, nullptr);  //
-    });
+    _mainDeletionQueue.push_fence(_frames[i]._renderFence);
 
     VK_CHECK(                                             //
         vkCreateSemaphore(_device,                        //
@@ -707,10 +1425,8 @@ void VulkanEngine::init_sync_structures() {
                           &_frames[i]._renderSemaphore)  //
     );
 
-    _mainDeletionQueue.push_function([=]() {                               //
-      vkDestroySemaphore(_device, _frames[i]._presentSemaphore, nullptr);  //
-      vkDestroySemaphore(_device, _frames[i]._renderSemaphore, nullptr);   //
-    });
+    _mainDeletionQueue.push_semaphore(_frames[i]._presentSemaphore);
+    _mainDeletionQueue.push_semaphore(_frames[i]._renderSemaphore);
   }
 
   VkFenceCreateInfo uploadFenceCreateInfo = vkinit::fence_create_info();
@@ -721,8 +1437,7 @@ void VulkanEngine::init_sync_structures() {
                     &_uploadContext._uploadFence)  //
   );
 
-  _mainDeletionQueue.push_function(
-      [=]() { vkDestroyFence(_device, _uploadContext._uploadFence, nullptr); });
+  _mainDeletionQueue.push_fence(_uploadContext._uploadFence);
 }
 
 void VulkanEngine::init_descriptors() {
@@ -730,6 +1445,7 @@ void VulkanEngine::init_descriptors() {
       {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10},
       {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10},
       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 10},
       {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10},
   };
 
@@ -743,19 +1459,32 @@ void VulkanEngine::init_descriptors() {
   vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptorPool);
 
   VkDescriptorSetLayoutBinding cameraBind =
-      vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                           VK_SHADER_STAGE_VERTEX_BIT, 0);
+      vkinit::descriptorset_layout_binding(
+          VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT,
+          0);
 
   VkDescriptorSetLayoutBinding sceneBind = vkinit::descriptorset_layout_binding(
       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1);
 
-  VkDescriptorSetLayoutBinding bindings[] = {cameraBind, sceneBind};
+  // The lights and their cluster lists are read by the lit fragment shaders
+  // and by the light binning pass
+  VkDescriptorSetLayoutBinding lightBind = vkinit::descriptorset_layout_binding(
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+      VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 2);
+
+  VkDescriptorSetLayoutBinding clusterBind =
+      vkinit::descriptorset_layout_binding(
+          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 3);
+
+  VkDescriptorSetLayoutBinding bindings[] = {cameraBind, sceneBind, lightBind,
+                                             clusterBind};
 
   VkDescriptorSetLayoutCreateInfo setInfo = {};
   setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
   setInfo.pNext = nullptr;
-  setInfo.bindingCount = 2;
+  setInfo.bindingCount = 4;
   setInfo.flags = 0;
   setInfo.pBindings = bindings;
 
@@ -789,34 +1518,73 @@ void VulkanEngine::init_descriptors() {
   vkCreateDescriptorSetLayout(_device, &set3Info, nullptr,
                               &_singleTextureSetLayout);
 
-  const size_t sceneParamBufferSize =
-      FRAME_OVERLAP * pad_uniform_buffer_size(sizeof(GPUSceneData));
+  // Dynamic offsets have to satisfy both the uniform and storage alignment
+  const size_t transientAlignment = std::max(
+      _gpuProperties.limits.minUniformBufferOffsetAlignment,
+      _gpuProperties.limits.minStorageBufferOffsetAlignment);
 
-  _sceneParameterBuffer =
-      create_buffer(sceneParamBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VMA_MEMORY_USAGE_CPU_TO_GPU);
+  _transientBuffer = create_buffer(
+      TransientAllocator::aligned_frame_size(TRANSIENT_FRAME_SIZE,
+                                             transientAlignment) *
+          frame_count(),
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategory::PerFrame,
+      VMA_ALLOCATION_CREATE_MAPPED_BIT);
 
-  for (int i = 0; i < FRAME_OVERLAP; i++) {
-    _frames[i].cameraBuffer = create_buffer(  //
-        sizeof(GPUCameraData),                //
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,   //
-        VMA_MEMORY_USAGE_CPU_TO_GPU           //
-    );
+  _transientAllocator.init(_allocator, _transientBuffer, TRANSIENT_FRAME_SIZE,
+                           transientAlignment);
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.pNext = nullptr;
+  allocInfo.descriptorPool = _descriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &_globalSetLayout;
+
+  vkAllocateDescriptorSets(_device, &allocInfo, &_globalDescriptor);
+
+  // The ring bindings point at its start, the actual location of the data is
+  // selected every frame with dynamic offsets. The cluster lists are written
+  // in init_clustered_lighting.
+  VkDescriptorBufferInfo cameraInfo = {};
+  cameraInfo.buffer = _transientBuffer._buffer;
+  cameraInfo.offset = 0;
+  cameraInfo.range = sizeof(GPUCameraData);
+
+  VkDescriptorBufferInfo sceneInfo = {};
+  sceneInfo.buffer = _transientBuffer._buffer;
+  sceneInfo.offset = 0;
+  sceneInfo.range = sizeof(GPUSceneData);
+
+  VkWriteDescriptorSet cameraWrite = vkinit::write_descriptor_buffer(
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, _globalDescriptor, &cameraInfo,
+      0);
 
-    const int MAX_OBJECTS = 10000;
-    _frames[i].objectBuffer = create_buffer(sizeof(GPUObjectData) * MAX_OBJECTS,
-                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-                                            VMA_MEMORY_USAGE_CPU_TO_GPU);
+  VkWriteDescriptorSet sceneWrite = vkinit::write_descriptor_buffer(
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, _globalDescriptor, &sceneInfo,
+      1);
 
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.pNext = nullptr;
-    allocInfo.descriptorPool = _descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &_globalSetLayout;
+  // The light array is always allocated at its full size, so the range stays
+  // inside the ring at any offset
+  VkDescriptorBufferInfo lightInfo = {};
+  lightInfo.buffer = _transientBuffer._buffer;
+  lightInfo.offset = 0;
+  lightInfo.range = sizeof(GPULight) * MAX_LIGHTS;
 
-    vkAllocateDescriptorSets(_device, &allocInfo, &_frames[i].globalDescriptor);
+  VkWriteDescriptorSet lightWrite = vkinit::write_descriptor_buffer(
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, _globalDescriptor, &lightInfo,
+      2);
 
+  VkWriteDescriptorSet globalWrites[] = {cameraWrite, sceneWrite, lightWrite};
+
+  vkUpdateDescriptorSets(_device, 3, globalWrites, 0, nullptr);
+
+  // Starting capacity only, the buffer grows with the scene
+  const uint32_t initialObjectCapacity = 10000;
+  _objectBuffer.init(_allocator, &_memoryTracker, frame_count(),
+                     initialObjectCapacity);
+
+  for (uint32_t i = 0; i < frame_count(); i++) {
     VkDescriptorSetAllocateInfo objectSetAlloc = {};
     objectSetAlloc.pNext = nullptr;
     objectSetAlloc.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -827,58 +1595,192 @@ void VulkanEngine::init_descriptors() {
     vkAllocateDescriptorSets(_device, &objectSetAlloc,
                              &_frames[i].objectDescriptor);
 
-    VkDescriptorBufferInfo cameraInfo = {};
-    cameraInfo.buffer = _frames[i].cameraBuffer._buffer;
-    cameraInfo.offset = 0;
-    cameraInfo.range = sizeof(GPUCameraData);
+    write_object_descriptor(i);
+  }
 
-    VkDescriptorBufferInfo sceneInfo = {};
-    sceneInfo.buffer = _sceneParameterBuffer._buffer;
-    sceneInfo.offset = 0;
-    sceneInfo.range = sizeof(GPUSceneData);
+  _mainDeletionQueue.push_buffer(_transientBuffer);
+  _mainDeletionQueue.push_descriptor_set_layout(_globalSetLayout);
+  _mainDeletionQueue.push_descriptor_set_layout(_objectSetLayout);
+  _mainDeletionQueue.push_descriptor_set_layout(_singleTextureSetLayout);
+  _mainDeletionQueue.push_descriptor_pool(_descriptorPool);
+  _mainDeletionQueue.push_cleanup(&_objectBuffer);
+}
 
-    VkDescriptorBufferInfo objectInfo = {};
-    objectInfo.buffer = _frames[i].objectBuffer._buffer;
-    objectInfo.offset = 0;
-    objectInfo.range = MAX_OBJECTS * sizeof(GPUObjectData);
+void VulkanEngine::write_object_descriptor(uint32_t frameIndex) {
+  VkDescriptorBufferInfo objectInfo = _objectBuffer.descriptor_info(frameIndex);
 
-    VkWriteDescriptorSet cameraWrite = vkinit::write_descriptor_buffer(
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, _frames[i].globalDescriptor,
-        &cameraInfo, 0);
+  VkWriteDescriptorSet objectWrite = vkinit::write_descriptor_buffer(
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _frames[frameIndex].objectDescriptor,
+      &objectInfo, 0);
 
-    VkWriteDescriptorSet sceneWrite = vkinit::write_descriptor_buffer(
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, _frames[i].globalDescriptor,
-        &sceneInfo, 1);
+  vkUpdateDescriptorSets(_device, 1, &objectWrite, 0, nullptr);
 
-    VkWriteDescriptorSet objectWrite = vkinit::write_descriptor_buffer(
-        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _frames[i].objectDescriptor,
-        &objectInfo, 0);
+  // The culling pass reads the same copy, it picks up the initial ones in
+  // init_occlusion_culling
+  if (_isInitialized) {
+    _occlusionCuller.write_object_descriptor(frameIndex, objectInfo);
+  }
+}
 
-    VkWriteDescriptorSet setWrites[] = {cameraWrite, sceneWrite, objectWrite};
+void VulkanEngine::init_occlusion_culling() {
+  _occlusionCuller.init(*this, _depthImageView, _windowExtent);
 
-    vkUpdateDescriptorSets(_device, 3, setWrites, 0, nullptr);
+  for (uint32_t i = 0; i < frame_count(); i++) {
+    _occlusionCuller.write_object_descriptor(
+        i, _objectBuffer.descriptor_info(i));
   }
 
-  _mainDeletionQueue.push_function([&]() {
-    vmaDestroyBuffer(_allocator, _sceneParameterBuffer._buffer,
-                     _sceneParameterBuffer._allocation);
+  _mainDeletionQueue.push_cleanup(&_occlusionCuller);
+}
 
-    vkDestroyDescriptorSetLayout(_device, _globalSetLayout, nullptr);
+void VulkanEngine::init_clustered_lighting() {
+  _clusteredLighting.init(*this);
 
-    vkDestroyDescriptorSetLayout(_device, _objectSetLayout, nullptr);
+  VkDescriptorBufferInfo clusterInfo = _clusteredLighting.cluster_info();
+  VkWriteDescriptorSet clusterWrite = vkinit::write_descriptor_buffer(
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _globalDescriptor, &clusterInfo, 3);
 
-    vkDestroyDescriptorSetLayout(_device, _singleTextureSetLayout, nullptr);
+  vkUpdateDescriptorSets(_device, 1, &clusterWrite, 0, nullptr);
 
-    vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+  _mainDeletionQueue.push_cleanup(&_clusteredLighting);
+}
 
-    for (int i = 0; i < FRAME_OVERLAP; i++) {
-      vmaDestroyBuffer(_allocator, _frames[i].objectBuffer._buffer,
-                       _frames[i].objectBuffer._allocation);
+void VulkanEngine::init_render_graph() {
+  _renderGraph.init(*this);
 
-      vmaDestroyBuffer(_allocator, _frames[i].cameraBuffer._buffer,
-                       _frames[i].cameraBuffer._allocation);
-    }
-  });
+  build_render_graph();
+
+  _mainDeletionQueue.push_callback(
+      [](void* graph) { static_cast<RenderGraph*>(graph)->reset(); },
+      &_renderGraph);
+}
+
+void VulkanEngine::build_render_graph() {
+  _renderGraph.reset();
+
+  // Neither attachment keeps its contents between frames. Scene color is a
+  // transient of the graph, depth stays imported because the pyramid build
+  // samples it through a descriptor written at init.
+  const RGResource color = _renderGraph.create_image(
+      "scene color", {_sceneColorFormat, _windowExtent});
+  _rgSceneColor = color;
+  const RGResource depth = _renderGraph.import_image(
+      "depth", _depthImage._image, _depthImageView,
+      {_depthFormat, _windowExtent}, VK_IMAGE_LAYOUT_UNDEFINED, false);
+
+  // Every scene pass shades with the lists of the current frame
+  const RGResource clusters = _renderGraph.import_buffer(
+      "light clusters", _clusteredLighting.cluster_buffer());
+
+  _renderGraph.add_pass("light binning", RGPassType::Compute)
+      .write(clusters, RGUsage::StorageWrite)
+      .execute([this](VkCommandBuffer cmd) {
+        _clusteredLighting.bin_lights(cmd, _recording->globalOffsets,
+                                      _recording->lightCullData);
+      });
+
+  VkClearValue colorClear;
+  colorClear.color = {{0.01f, 0.01f, 0.01f, 1.0f}};
+
+  // Clear depth at 1
+  VkClearValue depthClear;
+  depthClear.depthStencil.depth = 1.0f;
+
+  if (_occlusionCulling) {
+    const RGResource pyramid = _renderGraph.import_image(
+        "depth pyramid", _occlusionCuller.pyramid_image(),
+        _occlusionCuller.pyramid_view(),
+        {VK_FORMAT_R32_SFLOAT, _occlusionCuller.pyramid_extent(),
+         _occlusionCuller.pyramid_levels()},
+        VK_IMAGE_LAYOUT_GENERAL, true);
+    _rgVisibility = _renderGraph.import_buffer(
+        "visibility", _occlusionCuller.visibility_buffer());
+    _rgEarlyCommands = _renderGraph.import_buffer(
+        "early commands", _occlusionCuller.early_commands());
+    _rgLateCommands = _renderGraph.import_buffer(
+        "late commands", _occlusionCuller.late_commands());
+
+    // The next frame's early cull reads it
+    _renderGraph.set_output(_rgVisibility);
+
+    // Draw what was visible last frame, build the depth pyramid from it and
+    // then draw whatever the pyramid reveals as newly visible
+    _renderGraph.add_pass("cull early", RGPassType::Compute)
+        .read(_rgVisibility, RGUsage::StorageRead)
+        .write(_rgEarlyCommands, RGUsage::StorageWrite)
+        .execute([this](VkCommandBuffer cmd) {
+          _occlusionCuller.cull_early(cmd, _recording->frameIndex,
+                                      _recording->cullData);
+        });
+
+    _renderGraph.add_pass("early pass", RGPassType::Graphics)
+        .color_attachment(color)
+        .depth_attachment(depth)
+        .clear(color, colorClear)
+        .clear(depth, depthClear)
+        .read(_rgEarlyCommands, RGUsage::IndirectRead)
+        .read(clusters, RGUsage::StorageReadFragment)
+        .execute([this](VkCommandBuffer cmd) {
+          set_render_viewport(cmd, _recording->renderExtent);
+          draw_objects(cmd, *_recording, _recording->earlyCommands);
+        });
+
+    // Includes building the depth pyramid
+    _renderGraph.add_pass("cull late", RGPassType::Compute)
+        .read(depth, RGUsage::SampledCompute)
+        .write(pyramid, RGUsage::StorageReadWrite)
+        .write(_rgVisibility, RGUsage::StorageReadWrite)
+        .write(_rgLateCommands, RGUsage::StorageWrite)
+        .execute([this](VkCommandBuffer cmd) {
+          _occlusionCuller.cull_late(cmd, _recording->frameIndex,
+                                     _recording->cullData,
+                                     _recording->renderExtent);
+        });
+
+    _renderGraph.add_pass("late pass", RGPassType::Graphics)
+        .color_attachment(color)
+        .depth_attachment(depth)
+        .read(_rgLateCommands, RGUsage::IndirectRead)
+        .read(clusters, RGUsage::StorageReadFragment)
+        .execute([this](VkCommandBuffer cmd) {
+          set_render_viewport(cmd, _recording->renderExtent);
+          draw_objects(cmd, *_recording, _recording->lateCommands);
+        });
+  } else {
+    _renderGraph.add_pass("main pass", RGPassType::Graphics)
+        .color_attachment(color)
+        .depth_attachment(depth)
+        .clear(color, colorClear)
+        .clear(depth, depthClear)
+        .read(clusters, RGUsage::StorageReadFragment)
+        .execute([this](VkCommandBuffer cmd) {
+          set_render_viewport(cmd, _recording->renderExtent);
+          draw_objects(cmd, *_recording);
+        });
+  }
+
+  if (_config.headless) {
+    // Nothing is presented, the scene target is the result
+    _renderGraph.set_output(color);
+  } else {
+    // Set to the acquired image every frame
+    _rgSwapchain = _renderGraph.import_image(
+        "swapchain", _swapchainImages[0], _swapchainImageViews[0],
+        {_swapchainImageFormat, _windowExtent}, VK_IMAGE_LAYOUT_UNDEFINED,
+        false);
+    _renderGraph.set_output(_rgSwapchain, RGUsage::Present);
+
+    _renderGraph.add_pass("blit", RGPassType::Transfer)
+        .read(color, RGUsage::TransferSrc)
+        .write(_rgSwapchain, RGUsage::TransferDst)
+        .execute([this](VkCommandBuffer cmd) {
+          blit_to_swapchain(cmd, _renderGraph.image(_rgSwapchain),
+                            _recording->renderExtent);
+        });
+  }
+
+  _renderGraph.compile();
+  _renderGraph.print();
 }
 
 bool VulkanEngine::load_shader_module(const std::string filename,
@@ -940,6 +1842,12 @@ void VulkanEngine::init_pipelines() {
     std::cout << "Error when building the colored mesh shader" << std::endl;
   }
 
+  VkShaderModule voxelMeshShader;
+  if (!load_shader_module(path + "/shaders/voxel_lit.frag.spv",
+                          &voxelMeshShader)) {
+    std::cout << "Error when building the voxel mesh shader" << std::endl;
+  }
+
   VkShaderModule meshVertShader;
   if (!load_shader_module(path + "/shaders/tri_mesh_ssbo.vert.spv",
                           &meshVertShader)) {
@@ -999,16 +1907,6 @@ void VulkanEngine::init_pipelines() {
   pipelineBuilder._inputAssembly =
       vkinit::input_assembly_create_info(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
 
-  pipelineBuilder._viewport.x = 0.0f;
-  pipelineBuilder._viewport.y = 0.0f;
-  pipelineBuilder._viewport.width = (float)_windowExtent.width;
-  pipelineBuilder._viewport.height = (float)_windowExtent.height;
-  pipelineBuilder._viewport.minDepth = 0.0f;
-  pipelineBuilder._viewport.maxDepth = 1.0f;
-
-  pipelineBuilder._scissor.offset = {0, 0};
-  pipelineBuilder._scissor.extent = _windowExtent;
-
   pipelineBuilder._rasterizer =
       vkinit::rasterization_state_create_info(VK_POLYGON_MODE_FILL);
 
@@ -1037,7 +1935,8 @@ void VulkanEngine::init_pipelines() {
   VkPipeline meshPipeline =
       pipelineBuilder.build_pipeline(_device, _renderPass);
 
-  create_material(meshPipeline, meshPipLayout, "defaultmesh");
+  const MaterialHandle meshMaterial =
+      create_material(meshPipeline, meshPipLayout, "defaultmesh");
 
   pipelineBuilder._shaderStages.clear();
   pipelineBuilder._shaderStages.push_back(
@@ -1050,28 +1949,118 @@ void VulkanEngine::init_pipelines() {
 
   pipelineBuilder._pipelineLayout = texturedPipeLayout;
   VkPipeline texPipeline = pipelineBuilder.build_pipeline(_device, _renderPass);
-  create_material(texPipeline, texturedPipeLayout, "texturedmesh");
+  const MaterialHandle texturedMaterial =
+      create_material(texPipeline, texturedPipeLayout, "texturedmesh");
+
+  // After a depth prepass only the front-most surface passes, and depth is
+  // already final
+  pipelineBuilder._depthStencil =
+      vkinit::depth_stencil_create_info(true, false, VK_COMPARE_OP_EQUAL);
+
+  VkPipeline texDepthEqualPipeline =
+      pipelineBuilder.build_pipeline(_device, _renderPass);
+  _materials.get(texturedMaterial)->depthEqualPipeline = texDepthEqualPipeline;
+
+  // Voxel chunks share the textured layout and the block atlas
+  pipelineBuilder._shaderStages[1] = vkinit::pipeline_shader_stage_create_info(
+      VK_SHADER_STAGE_FRAGMENT_BIT, voxelMeshShader);
+
+  VkPipeline voxelDepthEqualPipeline =
+      pipelineBuilder.build_pipeline(_device, _renderPass);
+
+  pipelineBuilder._depthStencil = vkinit::depth_stencil_create_info(
+      true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
+  VkPipeline voxelPipeline =
+      pipelineBuilder.build_pipeline(_device, _renderPass);
+  const MaterialHandle voxelMaterial =
+      create_material(voxelPipeline, texturedPipeLayout, "voxelmesh");
+  _materials.get(voxelMaterial)->depthEqualPipeline = voxelDepthEqualPipeline;
+
+  pipelineBuilder._depthStencil =
+      vkinit::depth_stencil_create_info(true, false, VK_COMPARE_OP_EQUAL);
+
+  pipelineBuilder._shaderStages[1] = vkinit::pipeline_shader_stage_create_info(
+      VK_SHADER_STAGE_FRAGMENT_BIT, colorMeshShader);
+  pipelineBuilder._pipelineLayout = meshPipLayout;
+
+  VkPipeline meshDepthEqualPipeline =
+      pipelineBuilder.build_pipeline(_device, _renderPass);
+  _materials.get(meshMaterial)->depthEqualPipeline = meshDepthEqualPipeline;
+
+  // Depth prepass: positions only and no fragment shader
+  VkShaderModule depthOnlyShader;
+  if (!load_shader_module(path + "/shaders/depth_only.vert.spv",
+                          &depthOnlyShader)) {
+    std::cout << "Error when building the depth only vertex shader module"
+              << std::endl;
+  }
+
+  pipelineBuilder._shaderStages.clear();
+  pipelineBuilder._shaderStages.push_back(
+      vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT,
+                                                depthOnlyShader));
+
+  VertexInputDescription positionDescription =
+      Vertex::get_position_only_description();
+
+  pipelineBuilder._vertexInputInfo.pVertexAttributeDescriptions =
+      positionDescription.attributes.data();
+  pipelineBuilder._vertexInputInfo.vertexAttributeDescriptionCount =
+      positionDescription.attributes.size();
+  pipelineBuilder._vertexInputInfo.pVertexBindingDescriptions =
+      positionDescription.bindings.data();
+  pipelineBuilder._vertexInputInfo.vertexBindingDescriptionCount =
+      positionDescription.bindings.size();
+
+  pipelineBuilder._depthStencil = vkinit::depth_stencil_create_info(
+      true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+  // The render pass has a color attachment, it's just left untouched
+  pipelineBuilder._colorBlendAttachment.colorWriteMask = 0;
+
+  _depthPrepassLayout = meshPipLayout;
+  _depthPrepassPipeline =
+      pipelineBuilder.build_pipeline(_device, _renderPass);
 
   vkDestroyShaderModule(_device, meshVertShader, nullptr);
   vkDestroyShaderModule(_device, colorMeshShader, nullptr);
   vkDestroyShaderModule(_device, texturedMeshShader, nullptr);
-
-  _mainDeletionQueue.push_function([=]() {
-    vkDestroyPipeline(_device, meshPipeline, nullptr);
-    vkDestroyPipeline(_device, texPipeline, nullptr);
-
-    vkDestroyPipelineLayout(_device, meshPipLayout, nullptr);
-    vkDestroyPipelineLayout(_device, texturedPipeLayout, nullptr);
-  });
+  vkDestroyShaderModule(_device, voxelMeshShader, nullptr);
+  vkDestroyShaderModule(_device, depthOnlyShader, nullptr);
+
+  _mainDeletionQueue.push_pipeline(meshPipeline);
+  _mainDeletionQueue.push_pipeline(texPipeline);
+  _mainDeletionQueue.push_pipeline(meshDepthEqualPipeline);
+  _mainDeletionQueue.push_pipeline(texDepthEqualPipeline);
+  _mainDeletionQueue.push_pipeline(voxelPipeline);
+  _mainDeletionQueue.push_pipeline(voxelDepthEqualPipeline);
+  _mainDeletionQueue.push_pipeline(_depthPrepassPipeline);
+
+  _mainDeletionQueue.push_pipeline_layout(meshPipLayout);
+  _mainDeletionQueue.push_pipeline_layout(texturedPipeLayout);
 }
 
 void VulkanEngine::upload_mesh(Mesh& mesh) {
-  const size_t bufferSize = sizeof(Vertex) * mesh._vertices.size();
+  mesh._vertexBuffer = upload_vertex_data(
+      mesh._vertices.data(), mesh._vertices.size() * sizeof(Vertex));
+
+  // The depth prepass only needs positions, a separate packed stream keeps
+  // its vertex fetch to 12 bytes per vertex
+  std::vector<glm::vec3> positions(mesh._vertices.size());
+  for (size_t i = 0; i < mesh._vertices.size(); i++) {
+    positions[i] = mesh._vertices[i].position;
+  }
+
+  mesh._positionBuffer = upload_vertex_data(
+      positions.data(), positions.size() * sizeof(glm::vec3));
+}
 
+AllocatedBuffer VulkanEngine::upload_vertex_data(const void* data,
+                                                 size_t size) {
   VkBufferCreateInfo stagingBufferInfo = {};
   stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   stagingBufferInfo.pNext = nullptr;
-  stagingBufferInfo.size = bufferSize;
+  stagingBufferInfo.size = size;
   stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
   VmaAllocationCreateInfo vmaallocInfo = {};
@@ -1082,75 +2071,93 @@ void VulkanEngine::upload_mesh(Mesh& mesh) {
   VK_CHECK(vmaCreateBuffer(_allocator, &stagingBufferInfo, &vmaallocInfo,
                            &stagingBuffer._buffer, &stagingBuffer._allocation,
                            nullptr));
+  _memoryTracker.track(stagingBuffer._allocation, MemoryCategory::Staging);
 
-  void* data;
-  vmaMapMemory(_allocator, stagingBuffer._allocation, &data);
-  memcpy(data, mesh._vertices.data(), mesh._vertices.size() * sizeof(Vertex));
+  void* mapped;
+  vmaMapMemory(_allocator, stagingBuffer._allocation, &mapped);
+  memcpy(mapped, data, size);
   vmaUnmapMemory(_allocator, stagingBuffer._allocation);
 
   VkBufferCreateInfo vertexBufferInfo = {};
   vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   vertexBufferInfo.pNext = nullptr;
-  vertexBufferInfo.size = bufferSize;
+  vertexBufferInfo.size = size;
   vertexBufferInfo.usage =
       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 
   vmaallocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
+  AllocatedBuffer vertexBuffer;
+
   VK_CHECK(vmaCreateBuffer(_allocator, &vertexBufferInfo, &vmaallocInfo,
-                           &mesh._vertexBuffer._buffer,
-                           &mesh._vertexBuffer._allocation, nullptr));
+                           &vertexBuffer._buffer, &vertexBuffer._allocation,
+                           nullptr));
+  _memoryTracker.track(vertexBuffer._allocation, MemoryCategory::Mesh);
 
   immediate_submit([=](VkCommandBuffer cmd) {
     VkBufferCopy copy;
     copy.dstOffset = 0;
     copy.srcOffset = 0;
-    copy.size = bufferSize;
-    vkCmdCopyBuffer(cmd, stagingBuffer._buffer, mesh._vertexBuffer._buffer, 1,
+    copy.size = size;
+    vkCmdCopyBuffer(cmd, stagingBuffer._buffer, vertexBuffer._buffer, 1,
                     &copy);
   });
 
-  _mainDeletionQueue.push_function([=]() {
-    vmaDestroyBuffer(_allocator, mesh._vertexBuffer._buffer,
-                     mesh._vertexBuffer._allocation);
-  });
+  _mainDeletionQueue.push_buffer(vertexBuffer);
 
-  vmaDestroyBuffer(_allocator, stagingBuffer._buffer,
-                   stagingBuffer._allocation);
+  destroy_buffer(stagingBuffer);
+
+  return vertexBuffer;
 }
 
 void VulkanEngine::load_meshes() {
+  // Parsing is CPU only and runs in parallel, uploads need the main thread
   Mesh lostEmpireMesh{};
-  lostEmpireMesh.load_from_obj(path + "/models/lost_empire/lost_empire.obj");
-
   Mesh monkeyMesh{};
-  monkeyMesh.load_from_obj(path + "/models/monkey_smooth/monkey_smooth.obj");
+  const std::pair<Mesh*, std::string> objFiles[] = {
+      {&lostEmpireMesh, path + "/models/lost_empire/lost_empire.obj"},
+      {&monkeyMesh, path + "/models/monkey_smooth/monkey_smooth.obj"}};
+  _jobs.parallel_for(0, std::size(objFiles), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      objFiles[i].first->load_from_obj(objFiles[i].second);
+    }
+  });
 
   upload_mesh(monkeyMesh);
   upload_mesh(lostEmpireMesh);
 
-  _meshes["lostempire"] = lostEmpireMesh;
-  _meshes["monkey"] = monkeyMesh;
+  _meshNames["lostempire"] = _meshes.create(std::move(lostEmpireMesh));
+  _meshNames["monkey"] = _meshes.create(std::move(monkeyMesh));
 }
 
 void VulkanEngine::init_scene() {
-  RenderObject lostEmpire;
-  lostEmpire.mesh = get_mesh("lostempire");
-  lostEmpire.material = get_material("texturedmesh");
-  lostEmpire.transformMatrix = glm::mat4{1.0f};
-
   RenderObject monkey;
-  monkey.mesh = get_mesh("monkey");
-  monkey.material = get_material("defaultmesh");
-  monkey.transformMatrix = glm::mat4{1.0f};
-  monkey.transformMatrix =
-      glm::translate(monkey.transformMatrix, glm::vec3{-7.0f, 13.0f, -15.0f});
+  monkey.mesh = find_mesh("monkey");
+  monkey.material = find_material("defaultmesh");
+  monkey.transform =
+      _transforms.create(INVALID_TRANSFORM, glm::vec3{-7.0f, 13.0f, -15.0f});
+
+  add_renderable(monkey);
 
-  _renderables.push_back(monkey);
+  if (_config.voxelWorld) {
+    init_voxel_world();
+  } else {
+    RenderObject lostEmpire;
+    lostEmpire.mesh = find_mesh("lostempire");
+    lostEmpire.material = find_material("texturedmesh");
+    lostEmpire.transform = _transforms.create();
+
+    add_renderable(lostEmpire);
+  }
 
-  _renderables.push_back(lostEmpire);
+  if (_config.stressScene.count > 0) init_stress_scene();
 
-  Material* texturedMat = get_material("texturedmesh");
+  if (_config.lights.count > 0 || _config.compareLights) init_lights();
+
+  // draw_objects only rebinds when the material or mesh changes
+  sort_renderables();
+
+  Material* texturedMat = _materials.get(find_material("texturedmesh"));
 
   VkDescriptorSetAllocateInfo allocInfo = {};
   allocInfo.pNext = nullptr;
@@ -1167,12 +2174,12 @@ void VulkanEngine::init_scene() {
   VkSampler blockySampler;
   vkCreateSampler(_device, &samplerInfo, nullptr, &blockySampler);
 
-  _mainDeletionQueue.push_function(
-      [=]() { vkDestroySampler(_device, blockySampler, nullptr); });
+  _mainDeletionQueue.push_sampler(blockySampler);
 
   VkDescriptorImageInfo imageBufferInfo;
   imageBufferInfo.sampler = blockySampler;
-  imageBufferInfo.imageView = _loadedTextures["empire_diffuse"].imageView;
+  imageBufferInfo.imageView =
+      _textures.get(find_texture("empire_diffuse"))->imageView;
   imageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
   VkWriteDescriptorSet texture1 = vkinit::write_descriptor_image(
@@ -1180,10 +2187,246 @@ void VulkanEngine::init_scene() {
       &imageBufferInfo, 0);
 
   vkUpdateDescriptorSets(_device, 1, &texture1, 0, nullptr);
+
+  _materials.get(find_material("voxelmesh"))->textureSet =
+      texturedMat->textureSet;
+}
+
+void VulkanEngine::init_stress_scene() {
+  StressSceneSettings settings = _config.stressScene;
+  settings.center = STRESS_SCENE_CENTER;
+
+  std::vector<TransformId> transforms;
+  _stressScene.generate(settings, _transforms, &transforms);
+
+  RenderObject instance;
+  instance.mesh = find_mesh("monkey");
+  instance.material = find_material("defaultmesh");
+
+  _renderables.reserve(_renderables.size() + transforms.size());
+  for (TransformId transform : transforms) {
+    instance.transform = transform;
+    add_renderable(instance);
+  }
+
+  std::cout << "Stress scene: " << settings.count << " instances, "
+            << stress_layout_name(settings.layout) << " layout, "
+            << _stressScene.animated_count() << " animated" << std::endl;
+}
+
+void VulkanEngine::init_lights() {
+  LightSceneSettings settings = _config.lights;
+
+  // The comparison needs the largest count, smaller ones use a prefix
+  if (_config.compareLights) {
+    for (uint32_t count : LIGHT_BENCHMARK_COUNTS) {
+      settings.count = std::max(settings.count, count);
+    }
+  }
+  if (settings.count > MAX_LIGHTS) {
+    std::cerr << "Light count clamped to " << MAX_LIGHTS << std::endl;
+    settings.count = MAX_LIGHTS;
+  }
+
+  // The map is much wider than it is tall, keep the lights in a slab over
+  // its bounds
+  const Mesh* map = _meshes.get(find_mesh("lostempire"));
+  settings.center = map->_boundsCenter;
+  settings.extent = glm::vec3(1.4f, 0.4f, 1.4f) * map->_boundsRadius;
+
+  _lightScene.generate(settings);
+  _lightCount = std::min(_config.lights.count, _lightScene.count());
+
+  std::cout << "Light scene: " << _lightScene.count() << " lights, "
+            << _lightCount << " active" << std::endl;
+}
+
+void VulkanEngine::init_voxel_world() {
+  ObjVoxelStats objStats;
+  if (!voxelize_obj(path + "/models/lost_empire/lost_empire.obj",
+                    &_voxelWorld, &_voxelOrigin, &objStats)) {
+    std::cerr << "Failed to voxelize lost_empire" << std::endl;
+    return;
+  }
+
+  _chunkMaterial = find_material("voxelmesh");
+
+  _chunkRemesher.init(_voxelWorld, &_jobs);
+
+  _voxelEditStress.init(_voxelWorld, _config.voxelEditsPerSecond,
+                        VOXEL_EDIT_SEED);
+
+  _mainDeletionQueue.push_callback(
+      [](void* context) {
+        VulkanEngine* engine = static_cast<VulkanEngine*>(context);
+        engine->_chunkRemesher.shutdown();
+
+        for (auto& [coord, chunk] : engine->_chunkMeshes) {
+          const Mesh* mesh = engine->_meshes.get(chunk.mesh);
+          if (mesh->_vertices.empty()) continue;
+          engine->destroy_buffer(mesh->_vertexBuffer);
+          engine->destroy_buffer(mesh->_positionBuffer);
+        }
+      },
+      this);
+
+  // Every chunk starts out dirty, the workers mesh them all in parallel
+  _voxelWorld.take_dirty_chunks(&_dirtyChunks);
+
+  uint32_t visibleFaces = 0;
+  uint32_t quads = 0;
+  size_t next = 0;
+  ChunkMeshResult result;
+  while (next < _dirtyChunks.size() || _chunkRemesher.in_flight() > 0) {
+    while (next < _dirtyChunks.size() &&
+           _chunkRemesher.submit(_dirtyChunks[next])) {
+      next++;
+    }
+
+    if (!_chunkRemesher.pop_result(&result)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    visibleFaces += result.stats.visibleFaces;
+    quads += result.stats.quads;
+    apply_chunk_mesh(result);
+  }
+  _dirtyChunks.clear();
+
+  std::cout << "Voxel world: " << _voxelWorld.chunks().size() << " chunks, "
+            << objStats.blocks << " blocks, " << objStats.skippedTriangles
+            << " of " << objStats.triangles
+            << " OBJ triangles off the block grid, "
+            << _voxelWorld.memory_usage() / 1024 << " KB of chunks"
+            << std::endl;
+  std::cout << "Voxel triangles: " << objStats.blockTriangles
+            << " exported, " << visibleFaces * 2
+            << " with hidden faces removed, " << quads * 2 << " greedy meshed"
+            << std::endl;
+}
+
+void VulkanEngine::update_voxel_world(double deltaTime) {
+  ScopedCpuZone zone(_profiler, "update_voxel_world");
+
+  _voxelStats.edits += _voxelEditStress.update(&_voxelWorld, deltaTime);
+
+  _voxelWorld.take_dirty_chunks(&_dirtyChunks);
+  size_t submitted = 0;
+  while (submitted < _dirtyChunks.size() &&
+         _chunkRemesher.submit(_dirtyChunks[submitted])) {
+    submitted++;
+  }
+  _dirtyChunks.erase(_dirtyChunks.begin(), _dirtyChunks.begin() + submitted);
+
+  bool addedRenderables = false;
+  ChunkMeshResult result;
+  while (_chunkRemesher.pop_result(&result)) {
+    addedRenderables |= apply_chunk_mesh(result);
+
+    const auto done = std::chrono::steady_clock::now();
+    _voxelStats.remeshLatencyMs.push_back(
+        std::chrono::duration<float, std::milli>(done - result.submitted)
+            .count());
+    _voxelStats.remeshes++;
+  }
+
+  // draw_objects only rebinds when the material or mesh changes
+  if (addedRenderables) sort_renderables();
+}
+
+bool VulkanEngine::apply_chunk_mesh(ChunkMeshResult& result) {
+  auto it = _chunkMeshes.find(result.coord);
+  if (it != _chunkMeshes.end()) {
+    retire_chunk_buffers(*_meshes.get(it->second.mesh));
+  } else if (result.vertices.empty()) {
+    return false;
+  }
+
+  VoxelChunkMesh& chunk = _chunkMeshes[result.coord];
+  if (chunk.mesh.is_null()) chunk.mesh = _meshes.create(Mesh());
+  Mesh& mesh = *_meshes.get(chunk.mesh);
+  mesh._vertices = std::move(result.vertices);
+  mesh.compute_bounds();
+
+  // Chunks are small and rewritten on every edit, writing them in place
+  // skips the staging copy and the queue wait of upload_mesh
+  if (!mesh._vertices.empty()) {
+    std::vector<glm::vec3> positions(mesh._vertices.size());
+    for (size_t i = 0; i < mesh._vertices.size(); i++) {
+      positions[i] = mesh._vertices[i].position;
+    }
+
+    auto upload = [&](const void* data, size_t size) {
+      AllocatedBuffer buffer =
+          create_buffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                        VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategory::Mesh);
+      void* mapped;
+      vmaMapMemory(_allocator, buffer._allocation, &mapped);
+      memcpy(mapped, data, size);
+      vmaUnmapMemory(_allocator, buffer._allocation);
+      return buffer;
+    };
+
+    mesh._vertexBuffer =
+        upload(mesh._vertices.data(), mesh._vertices.size() * sizeof(Vertex));
+    mesh._positionBuffer =
+        upload(positions.data(), positions.size() * sizeof(glm::vec3));
+  }
+
+  if (chunk.transform == INVALID_TRANSFORM) {
+    chunk.transform = _transforms.create(
+        INVALID_TRANSFORM,
+        _voxelOrigin + glm::vec3(VoxelWorld::chunk_origin(result.coord)));
+
+    RenderObject object;
+    object.mesh = chunk.mesh;
+    object.material = _chunkMaterial;
+    object.transform = chunk.transform;
+    add_renderable(object);
+    return true;
+  }
+
+  GPUObjectData& data = _objectBuffer.data()[chunk.transform];
+  data.sphereBounds = glm::vec4(mesh._boundsCenter, mesh._boundsRadius);
+  data.vertexCount = static_cast<uint32_t>(mesh._vertices.size());
+  _objectBuffer.mark_dirty(chunk.transform, 1);
+  _sceneBvh.set_bounds(chunk.transform, object_bounds(chunk.transform));
+  return false;
 }
 
-void VulkanEngine::draw_objects(VkCommandBuffer cmd, RenderObject* first,
-                                int count) {
+void VulkanEngine::retire_chunk_buffers(Mesh& mesh) {
+  if (mesh._vertices.empty()) return;
+
+  retire_queue().push_buffer(mesh._vertexBuffer);
+  retire_queue().push_buffer(mesh._positionBuffer);
+  mesh._vertexBuffer = {};
+  mesh._positionBuffer = {};
+}
+
+void VulkanEngine::add_renderable(const RenderObject& object) {
+  _renderables.push_back(object);
+  _renderablesVersion++;
+
+  _objectBuffer.resize(static_cast<uint32_t>(_transforms.size()));
+
+  const Mesh* mesh = _meshes.get(object.mesh);
+  GPUObjectData& data = _objectBuffer.data()[object.transform];
+  data.sphereBounds = glm::vec4(mesh->_boundsCenter, mesh->_boundsRadius);
+  data.vertexCount = static_cast<uint32_t>(mesh->_vertices.size());
+  _objectBuffer.mark_dirty(object.transform, 1);
+
+  _sceneBvhDirty = true;
+}
+
+void VulkanEngine::prepare_frame_data(FrameSnapshot& snapshot) {
+  // Camera, scene and object data are memcpy'd into mapped memory, so the
+  // uploads are CPU work
+  ScopedCpuZone zone(_profiler, "prepare_frame_data");
+
+  const float znear = 0.1f;
+  const float zfar = 200.0f;
+
   // make a model view matrix for rendering the object camera view
   glm::mat4 view = camera.getViewMatrix();
 
@@ -1192,98 +2435,332 @@ void VulkanEngine::draw_objects(VkCommandBuffer cmd, RenderObject* first,
       glm::perspective(glm::radians(70.f),
                        static_cast<float>(_windowExtent.width) /
                            static_cast<float>(_windowExtent.height),
-                       0.1f, 200.0f);
+                       znear, zfar);
   projection[1][1] *= -1;
 
   GPUCameraData camData;
   camData.proj = projection;
   camData.view = view;
   camData.viewproj = projection * view;
+  _viewProj = camData.viewproj;
 
-  void* data;
-  vmaMapMemory(_allocator, get_current_frame().cameraBuffer._allocation, &data);
-  memcpy(data, &camData, sizeof(GPUCameraData));
-  vmaUnmapMemory(_allocator, get_current_frame().cameraBuffer._allocation);
+  TransientAllocation cameraAlloc = _transientAllocator.push(camData);
 
   float framed = (_frameNumber / 60.f);
   _sceneParameters.ambientColor = {sin(framed), 0, cos(framed), 1};
 
-  char* sceneData;
-  vmaMapMemory(_allocator, _sceneParameterBuffer._allocation,
-               (void**)&sceneData);
-  int frameIndex = _frameNumber % FRAME_OVERLAP;
-  sceneData += pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
-  memcpy(sceneData, &_sceneParameters, sizeof(GPUSceneData));
-  vmaUnmapMemory(_allocator, _sceneParameterBuffer._allocation);
+  // The clusters cover the rendered part of the target, which dynamic
+  // resolution may shrink
+  const glm::vec2 slices = ClusteredLighting::slice_params(znear, zfar);
+  _sceneParameters.clusterScale =
+      glm::vec4(static_cast<float>(CLUSTER_X) / _renderExtent.width,
+                static_cast<float>(CLUSTER_Y) / _renderExtent.height,
+                slices.x, slices.y);
+
+  TransientAllocation sceneAlloc = _transientAllocator.push(_sceneParameters);
+
+  TransientAllocation lightAlloc =
+      _transientAllocator.allocate(sizeof(GPULight) * MAX_LIGHTS);
+  _lightScene.animate(static_cast<float>(_animationTime),
+                      static_cast<GPULight*>(lightAlloc.data), _lightCount);
+
+  snapshot.renderExtent = _renderExtent;
+  snapshot.depthPrepass = _config.depthPrepass;
+  snapshot.occlusionCulling = _occlusionCulling;
+
+  // Dynamic offsets are consumed in binding order
+  snapshot.globalOffsets[0] = cameraAlloc.offset;
+  snapshot.globalOffsets[1] = sceneAlloc.offset;
+  snapshot.globalOffsets[2] = lightAlloc.offset;
+
+  // The binning pass needs the signed y scale to match gl_FragCoord
+  LightCullPushConstants& lightCullData = snapshot.lightCullData;
+  lightCullData.view = view;
+  lightCullData.P00 = projection[0][0];
+  lightCullData.P11 = projection[1][1];
+  lightCullData.znear = znear;
+  lightCullData.zfar = zfar;
+  lightCullData.lightCount = _lightCount;
+
+  // update_transforms() already wrote the changed matrices to the mirror.
+  // This frame's fence has signaled, so its copy and descriptor are free to
+  // be updated before anything binds them
+  const uint32_t frameIndex = snapshot.frameIndex;
+  if (_objectBuffer.flush(frameIndex)) {
+    write_object_descriptor(frameIndex);
+  }
 
-  void* objectData;
-  vmaMapMemory(_allocator, get_current_frame().objectBuffer._allocation,
-               &objectData);
-  GPUObjectData* objectSSBO = (GPUObjectData*)objectData;
-  for (int i = 0; i < count; i++) {
-    RenderObject& object = first[i];
+  capture_draws(snapshot);
 
-    objectSSBO[i].modelMatrix = object.transformMatrix;
+  if (!_occlusionCulling) return;
+
+  // Growing waits for the device and rewrites the culling sets of every
+  // slot, frames still being recorded use them
+  if (_objectBuffer.size() > _occlusionCuller.object_capacity()) {
+    wait_render_idle();
+  }
+  _occlusionCuller.reserve_objects(_objectBuffer.size());
+
+  snapshot.visibility = _occlusionCuller.visibility_buffer();
+  snapshot.earlyCommands = _occlusionCuller.early_commands();
+  snapshot.lateCommands = _occlusionCuller.late_commands();
+
+  // Side planes only depend on the projection scale, the y flip is irrelevant
+  // for the symmetric test
+  const float P00 = projection[0][0];
+  const float P11 = std::abs(projection[1][1]);
+
+  CullPushConstants& cullData = snapshot.cullData;
+  cullData.view = view;
+  cullData.frustum =
+      glm::vec4(P00, 1.0f, P11, 1.0f) /
+      glm::vec4(glm::vec2(std::sqrt(P00 * P00 + 1.0f)),
+                glm::vec2(std::sqrt(P11 * P11 + 1.0f)));
+  cullData.P00 = P00;
+  cullData.P11 = P11;
+  cullData.P22 = projection[2][2];
+  cullData.P32 = projection[3][2];
+  cullData.znear = znear;
+  cullData.zfar = zfar;
+  cullData.pyramidWidth = 0.0f;
+  cullData.pyramidHeight = 0.0f;
+  cullData.objectCount = _objectBuffer.size();
+  cullData.phase = 0;
+}
+
+void VulkanEngine::capture_draws(FrameSnapshot& snapshot) {
+  ScopedCpuZone zone(_profiler, "capture draws");
+
+  // Without the GPU culling pass the CPU frustum test decides, otherwise
+  // every renderable is drawn
+  if (!_occlusionCulling) {
+    cull_frustum(_viewProj);
+    snapshot.draws.clear();
+    for (const RenderObject& object : _renderables) {
+      if (_visibleObjects[object.transform]) snapshot.draws.push_back(object);
+    }
+    snapshot.drawsVersion = 0;
+  } else if (snapshot.drawsVersion != _renderablesVersion) {
+    snapshot.draws.assign(_renderables.begin(), _renderables.end());
+    snapshot.drawsVersion = _renderablesVersion;
+  }
+
+  // The snapshot still holds the pool items of the last frame it carried,
+  // only slots that changed since are copied
+  if (snapshot.materialsVersion != _materials.version()) {
+    snapshot.materials.resize(_materials.capacity());
+    for (uint32_t i = 0; i < _materials.capacity(); i++) {
+      if (_materials.slot_version(i) > snapshot.materialsVersion) {
+        snapshot.materials[i] = _materials.data()[i];
+      }
+    }
+    snapshot.materialsVersion = _materials.version();
+  }
+
+  if (snapshot.meshesVersion != _meshes.version()) {
+    snapshot.meshes.resize(_meshes.capacity());
+    for (uint32_t i = 0; i < _meshes.capacity(); i++) {
+      if (_meshes.slot_version(i) <= snapshot.meshesVersion) continue;
+
+      const Mesh& mesh = _meshes.data()[i];
+      MeshBinding& binding = snapshot.meshes[i];
+      binding.vertexCount = static_cast<uint32_t>(mesh._vertices.size());
+
+      // Free slots and emptied voxel chunks have no buffers
+      if (binding.vertexCount == 0) continue;
+      binding.vertexBuffer = mesh._vertexBuffer._buffer;
+      binding.positionBuffer = mesh._positionBuffer._buffer;
+    }
+    snapshot.meshesVersion = _meshes.version();
   }
-  vmaUnmapMemory(_allocator, get_current_frame().objectBuffer._allocation);
+}
+
+void VulkanEngine::cull_frustum(const glm::mat4& viewProj) {
+  ScopedCpuZone zone(_profiler, "frustum culling");
+
+  const Frustum frustum(viewProj);
+
+  // Only the objects visible last frame need to be reset
+  _visibleObjects.resize(_transforms.size());
+  for (uint32_t id : _visibleIds) {
+    _visibleObjects[id] = 0;
+  }
+
+  _visibleIds.clear();
+  _sceneBvh.query_frustum(frustum, &_visibleIds);
+  for (uint32_t id : _visibleIds) {
+    _visibleObjects[id] = 1;
+  }
+}
 
-  Mesh* lastMesh = nullptr;
-  Material* lastMaterial = nullptr;
-  for (int i = 0; i < count; i++) {
-    RenderObject& object = first[i];
+void VulkanEngine::sort_renderables() {
+  // Pool slots are already small dense ids for the sort key
+  DrawList list;
+  list.reserve(_renderables.size());
+  for (uint32_t i = 0; i < _renderables.size(); i++) {
+    const RenderObject& object = _renderables[i];
+    list.add(object.material.index(), object.mesh.index(), i);
+  }
+  list.sort();
+
+  std::vector<RenderObject> sorted;
+  sorted.reserve(_renderables.size());
+  for (const DrawItem& item : list.items()) {
+    sorted.push_back(_renderables[item.object]);
+  }
+  _renderables.swap(sorted);
+  _renderablesVersion++;
+
+  // The culling pass writes draw commands in this order, so objects that
+  // share a mesh and material end up in one consecutive range
+  for (uint32_t i = 0; i < _renderables.size(); i++) {
+    const TransformId transform = _renderables[i].transform;
+    GPUObjectData& data = _objectBuffer.data()[transform];
+    if (data.drawSlot == i) continue;
+    data.drawSlot = i;
+    _objectBuffer.mark_dirty(transform, 1);
+  }
+}
+
+void VulkanEngine::draw_objects(VkCommandBuffer cmd,
+                                const FrameSnapshot& snapshot,
+                                VkBuffer drawCommands) {
+  if (snapshot.depthPrepass) {
+    draw_depth_prepass(cmd, snapshot, drawCommands);
+  }
+
+  const VkDescriptorSet objectDescriptor =
+      _frames[snapshot.frameIndex].objectDescriptor;
+
+  const std::vector<RenderObject>& draws = snapshot.draws;
+  MeshHandle lastMesh;
+  MaterialHandle lastMaterial;
+  const Material* material = nullptr;
+  for (size_t begin = 0, end = 0; begin < draws.size(); begin = end) {
+    // Objects are sorted by material and mesh, each run is one batch
+    const RenderObject& object = draws[begin];
+    for (end = begin + 1; end < draws.size(); end++) {
+      if (draws[end].mesh != object.mesh ||
+          draws[end].material != object.material) {
+        break;
+      }
+    }
+
+    // Voxel chunks whose blocks were all removed have no buffers
+    const MeshBinding& mesh = snapshot.meshes[object.mesh.index()];
+    if (mesh.vertexCount == 0) continue;
 
     // only bind the pipeline if it doesn't match with the already bound one
     if (object.material != lastMaterial) {
+      material = &snapshot.materials[object.material.index()];
       vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        object.material->pipeline);
+                        snapshot.depthPrepass ? material->depthEqualPipeline
+                                              : material->pipeline);
       lastMaterial = object.material;
 
-      uint32_t uniform_offset =
-          pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
+      vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              material->pipelineLayout, 0, 1,
+                              &_globalDescriptor, GLOBAL_DYNAMIC_OFFSETS,
+                              snapshot.globalOffsets);
 
-      vkCmdBindDescriptorSets(
-          cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout,
-          0, 1, &get_current_frame().globalDescriptor, 1, &uniform_offset);
+      vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              material->pipelineLayout, 1, 1,
+                              &objectDescriptor, 0, nullptr);
 
-      vkCmdBindDescriptorSets(
-          cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout,
-          1, 1, &get_current_frame().objectDescriptor, 0, nullptr);
-
-      if (object.material->textureSet != VK_NULL_HANDLE) {
+      if (material->textureSet != VK_NULL_HANDLE) {
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                object.material->pipelineLayout, 2, 1,
-                                &object.material->textureSet, 0, nullptr);
+                                material->pipelineLayout, 2, 1,
+                                &material->textureSet, 0, nullptr);
       }
     }
 
-    MeshPushConstants constants;
-    constants.render_matrix = object.transformMatrix;
-
-    // upload the mesh to the GPU via push constants
-    vkCmdPushConstants(cmd, object.material->pipelineLayout,
-                       VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants),
-                       &constants);
-
     // only bind the mesh if it's a different one from last bind
     if (object.mesh != lastMesh) {
-      // bind the mesh vertex buffer with offset 0
       VkDeviceSize offset = 0;
-      vkCmdBindVertexBuffers(cmd, 0, 1, &object.mesh->_vertexBuffer._buffer,
-                             &offset);
+      vkCmdBindVertexBuffers(cmd, 0, 1, &mesh.vertexBuffer, &offset);
       lastMesh = object.mesh;
     }
-    // we can now draw
-    vkCmdDraw(cmd, object.mesh->_vertices.size(), 1, 0, i);
+
+    if (drawCommands != VK_NULL_HANDLE) {
+      // The culling pass wrote an instance count of 0 or 1 for each object
+      draw_indirect_range(cmd, drawCommands, static_cast<uint32_t>(begin),
+                          static_cast<uint32_t>(end - begin));
+    } else {
+      for (size_t i = begin; i < end; i++) {
+        vkCmdDraw(cmd, mesh.vertexCount, 1, 0, draws[i].transform);
+      }
+    }
+  }
+}
+
+void VulkanEngine::draw_depth_prepass(VkCommandBuffer cmd,
+                                      const FrameSnapshot& snapshot,
+                                      VkBuffer drawCommands) {
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    _depthPrepassPipeline);
+
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          _depthPrepassLayout, 0, 1, &_globalDescriptor,
+                          GLOBAL_DYNAMIC_OFFSETS, snapshot.globalOffsets);
+
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          _depthPrepassLayout, 1, 1,
+                          &_frames[snapshot.frameIndex].objectDescriptor, 0,
+                          nullptr);
+
+  // Only the mesh matters for depth, runs span material boundaries
+  const std::vector<RenderObject>& draws = snapshot.draws;
+  for (size_t begin = 0, end = 0; begin < draws.size(); begin = end) {
+    const MeshHandle meshHandle = draws[begin].mesh;
+    for (end = begin + 1; end < draws.size(); end++) {
+      if (draws[end].mesh != meshHandle) break;
+    }
+
+    // Voxel chunks whose blocks were all removed have no buffers
+    const MeshBinding& mesh = snapshot.meshes[meshHandle.index()];
+    if (mesh.vertexCount == 0) continue;
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &mesh.positionBuffer, &offset);
+
+    if (drawCommands != VK_NULL_HANDLE) {
+      draw_indirect_range(cmd, drawCommands, static_cast<uint32_t>(begin),
+                          static_cast<uint32_t>(end - begin));
+    } else {
+      for (size_t i = begin; i < end; i++) {
+        vkCmdDraw(cmd, mesh.vertexCount, 1, 0, draws[i].transform);
+      }
+    }
+  }
+}
+
+void VulkanEngine::draw_indirect_range(VkCommandBuffer cmd,
+                                       VkBuffer drawCommands, uint32_t first,
+                                       uint32_t count) {
+  const uint32_t stride = sizeof(VkDrawIndirectCommand);
+
+  // Without the feature a draw call takes at most one command
+  const uint32_t maxCount =
+      _multiDrawIndirect
+          ? std::max(_gpuProperties.limits.maxDrawIndirectCount, 1u)
+          : 1u;
+
+  while (count > 0) {
+    const uint32_t batch = std::min(count, maxCount);
+    vkCmdDrawIndirect(cmd, drawCommands, VkDeviceSize(first) * stride, batch,
+                      stride);
+    first += batch;
+    count -= batch;
   }
 }
 
 FrameData& VulkanEngine::get_current_frame() {
-  return _frames[_frameNumber % FRAME_OVERLAP];
+  return _frames[get_frame_index()];
 }
 
-AllocatedBuffer VulkanEngine::create_buffer(size_t allocSize,
-                                            VkBufferUsageFlags usage,
-                                            VmaMemoryUsage memoryUsage) {
+AllocatedBuffer VulkanEngine::create_buffer(
+    size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+    MemoryCategory category, VmaAllocationCreateFlags allocFlags) {
   VkBufferCreateInfo bufferInfo = {};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.pNext = nullptr;
@@ -1293,8 +2770,10 @@ AllocatedBuffer VulkanEngine::create_buffer(size_t allocSize,
 
   VmaAllocationCreateInfo vmaAllocInfo = {};
   vmaAllocInfo.usage = memoryUsage;
+  vmaAllocInfo.flags = allocFlags;
 
   AllocatedBuffer newBuffer;
+  VmaAllocationInfo allocationInfo;
 
   VK_CHECK(                        //
       vmaCreateBuffer(             //
@@ -1303,12 +2782,27 @@ AllocatedBuffer VulkanEngine::create_buffer(size_t allocSize,
           &vmaAllocInfo,           //
           &newBuffer._buffer,      //
           &newBuffer._allocation,  //
-          nullptr)                 //
+          &allocationInfo)         //
   );
 
+  // Persistently mapped buffers keep their pointer for their whole lifetime
+  newBuffer._mapped = allocationInfo.pMappedData;
+
+  _memoryTracker.track(newBuffer._allocation, category);
+
   return newBuffer;
 }
 
+void VulkanEngine::destroy_buffer(const AllocatedBuffer& buffer) {
+  _memoryTracker.untrack(buffer._allocation);
+  vmaDestroyBuffer(_allocator, buffer._buffer, buffer._allocation);
+}
+
+void VulkanEngine::destroy_image(const AllocatedImage& image) {
+  _memoryTracker.untrack(image._allocation);
+  vmaDestroyImage(_allocator, image._image, image._allocation);
+}
+
 // https://github.com/SaschaWillems/Vulkan/tree/master/examples/dynamicuniformbuffer
 size_t VulkanEngine::pad_uniform_buffer_size(size_t originalSize) {
   size_t minUboAlignment =
@@ -1359,9 +2853,7 @@ void VulkanEngine::load_images() {
 
   vkCreateImageView(_device, &imageinfo, nullptr, &lostEmpire.imageView);
 
-  _mainDeletionQueue.push_function([=]() {                       //
-    vkDestroyImageView(_device, lostEmpire.imageView, nullptr);  //
-  });
+  _mainDeletionQueue.push_image_view(lostEmpire.imageView);
 
-  _loadedTextures["empire_diffuse"] = lostEmpire;
+  _textureNames["empire_diffuse"] = _textures.create(std::move(lostEmpire));
 }
\ No newline at end of file
@@ -2,19 +2,52 @@
 #define C12F24BE_7752_44A1_B4B1_AA3E1F0F254D
 
 #include "vk_types.h"
+#include "vk_config.h"
 #include "vk_deletionQueue.h"
 #include "vk_mesh.h"
+#include "vk_transientAllocator.h"
+#include "vk_objectBuffer.h"
+#include "vk_memoryTracker.h"
+#include "vk_occlusionCulling.h"
+#include "vk_clusteredLighting.h"
+#include "vk_renderGraph.h"
+#include "vk_profiler.h"
+#include "vk_benchmark.h"
 
 #include "camera/camera.h"
-#include "Utility/FPSCounter.h"
-
+#include "camera/cameraPath.h"
+#include "camera/frustum.h"
+#include "scene/transformStore.h"
+#include "scene/bvh.h"
+#include "scene/stressScene.h"
+#include "scene/lightScene.h"
+#include "scene/drawList.h"
+#include "voxel/chunkRemesher.h"
+#include "voxel/voxelEditStress.h"
+#include "voxel/voxelWorld.h"
+#include "Utility/latencyTracker.h"
+#include "Utility/dynamicResolution.h"
+#include "Utility/frameStats.h"
+#include "Utility/handlePool.h"
+#include "Utility/jobSystem.h"
+#include "Utility/spscRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 #include <unordered_map>
 
 #include <glm/glm.hpp>
 
-constexpr unsigned FRAME_OVERLAP = 2;
+// Bytes of the transient ring reserved for each frame in flight
+constexpr size_t TRANSIENT_FRAME_SIZE = 4 * 1024 * 1024;
+
+// Camera, scene and light data of the global set
+constexpr uint32_t GLOBAL_DYNAMIC_OFFSETS = 3;
 
 struct UploadContext {
   VkFence _uploadFence;
@@ -30,13 +63,29 @@ struct MeshPushConstants {
 struct Material {
   VkDescriptorSet textureSet{VK_NULL_HANDLE};
   VkPipeline pipeline;
+  // Same shading with an equal depth test and no depth writes, for drawing
+  // after the depth prepass
+  VkPipeline depthEqualPipeline{VK_NULL_HANDLE};
   VkPipelineLayout pipelineLayout;
 };
 
+struct Texture;
+
+using MeshHandle = Handle<Mesh>;
+using MaterialHandle = Handle<Material>;
+using TextureHandle = Handle<Texture>;
+
 struct RenderObject {
-  Mesh* mesh;
-  Material* material;
-  glm::mat4 transformMatrix;
+  MeshHandle mesh;
+  MaterialHandle material;
+  // Also the index of the object in the object buffer
+  TransformId transform;
+};
+
+// One chunk of the voxel world, its mesh is replaced when the chunk changes
+struct VoxelChunkMesh {
+  MeshHandle mesh;
+  TransformId transform{INVALID_TRANSFORM};
 };
 
 struct GPUCameraData {
@@ -51,10 +100,8 @@ struct GPUSceneData {
   glm::vec4 ambientColor;
   glm::vec4 lightDirection;  // w for sun power
   glm::vec4 lightColor;
-};
-
-struct GPUObjectData {
-  glm::mat4 modelMatrix;
+  // xy clusters per pixel of the render extent, zw depth slice scale and bias
+  glm::vec4 clusterScale;
 };
 
 struct FrameData {
@@ -64,11 +111,10 @@ struct FrameData {
   VkCommandPool _commandPool;
   VkCommandBuffer _mainCommandBuffer;
 
-  AllocatedBuffer cameraBuffer;
-  AllocatedBuffer objectBuffer;
-
-  VkDescriptorSet globalDescriptor;
   VkDescriptorSet objectDescriptor;
+
+  // Flushed once _renderFence has signaled, see VulkanEngine::retire_queue
+  DeletionQueue _deletionQueue;
 };
 
 struct Texture {
@@ -76,13 +122,90 @@ struct Texture {
   VkImageView imageView;
 };
 
+// What drawing a mesh needs, without its CPU side vertices
+struct MeshBinding {
+  VkBuffer vertexBuffer{VK_NULL_HANDLE};
+  VkBuffer positionBuffer{VK_NULL_HANDLE};
+  uint32_t vertexCount{0};
+};
+
+// Everything the recording of a frame reads, captured when the frame is
+// prepared. Recording never looks at the scene or the resource pools, so the
+// main thread can update the next frame while this one is recorded. The
+// vectors keep their capacity from one use of the snapshot to the next.
+struct FrameSnapshot {
+  uint32_t frameIndex;
+  VkExtent2D renderExtent;
+  bool depthPrepass;
+  bool occlusionCulling;
+
+  // Dynamic offsets of the camera, scene and light data
+  uint32_t globalOffsets[GLOBAL_DYNAMIC_OFFSETS];
+  CullPushConstants cullData;
+  LightCullPushConstants lightCullData;
+
+  // The culling buffers are reallocated when the object count outgrows them
+  VkBuffer visibility;
+  VkBuffer earlyCommands;
+  VkBuffer lateCommands;
+
+  // Renderables in draw order, only the ones that passed the frustum test
+  // when occlusion culling is off
+  std::vector<RenderObject> draws;
+  // Indexed by handle index
+  std::vector<Material> materials;
+  std::vector<MeshBinding> meshes;
+
+  // Versions of the renderables and pools the lists above were copied at.
+  // Snapshots are reused, only what changed since is copied again. Draws
+  // filtered by the frustum test have version 0.
+  uint64_t drawsVersion{0};
+  uint64_t materialsVersion{0};
+  uint64_t meshesVersion{0};
+};
+
 class VulkanEngine {
  public:
+  // Set before init, some options are also toggled at runtime
+  EngineConfig _config;
+
   bool _isInitialized{false};
   int _frameNumber{0};
 
   VkExtent2D _windowExtent{1600, 800};
-  int _milisecondsPreviousFrame{0};
+  std::chrono::steady_clock::time_point _previousFrameTime;
+
+  // Set while a camera path is played back, input is ignored then
+  bool _benchmarking{false};
+  double _benchmarkTime{0.0};
+
+  // Drives the stress scene animation, the benchmark uses its own clock
+  double _sceneTime{0.0};
+  double _animationTime{0.0};
+  StressScene _stressScene;
+
+  // Lights are animated straight into the frame's light array. Only the
+  // first _lightCount of the generated lights are used.
+  LightScene _lightScene;
+  uint32_t _lightCount{0};
+
+  // lost_empire rebuilt as blocks from its OBJ, one greedy meshed renderable
+  // per chunk. _voxelOrigin is where block (0, 0, 0) sits in the scene.
+  VoxelWorld _voxelWorld;
+  glm::vec3 _voxelOrigin{0.0f};
+  std::unordered_map<ChunkCoord, VoxelChunkMesh, ChunkCoordHash> _chunkMeshes;
+  MaterialHandle _chunkMaterial;
+
+  // Edited chunks are remeshed on the job system and only their buffers are
+  // replaced. Chunks the remesh queue had no room for wait in _dirtyChunks.
+  ChunkRemesher _chunkRemesher;
+  VoxelEditStress _voxelEditStress;
+  std::vector<ChunkCoord> _dirtyChunks;
+  VoxelRunStats _voxelStats;
+
+  // Session time and the time of the last recorded camera keyframe
+  double _recordTime{0.0};
+  double _lastKeyframeTime{0.0};
 
   struct SDL_Window* _window{nullptr};
 
@@ -90,20 +213,43 @@ class VulkanEngine {
   VkDebugUtilsMessengerEXT _debug_messenger;
   VkPhysicalDevice _chosenGPU;
   VkPhysicalDeviceProperties _gpuProperties;
+  // Set when the device was created with pipelineStatisticsQuery
+  bool _pipelineStatistics{false};
+  // Set when the device was created with multiDrawIndirect, otherwise every
+  // indirect command is its own draw call
+  bool _multiDrawIndirect{false};
+
+  // Live allocations per category and heap budgets
+  MemoryTracker _memoryTracker;
   VkDevice _device;
 
   VkQueue _graphicsQueue;
   uint32_t _graphicsQueueFamily;
 
-  FrameData _frames[FRAME_OVERLAP];
+  // One per frame in flight, sized from the config at init
+  std::vector<FrameData> _frames;
 
+  // Only used to build the pipelines, the render graph creates compatible
+  // render passes for the scene passes
   VkRenderPass _renderPass;
 
+  // Passes of a frame with the barriers between them. Rebuilt when occlusion
+  // culling is toggled, the resources that change every frame are set on it
+  // before it is executed.
+  RenderGraph _renderGraph;
+  RGResource _rgSceneColor{RG_NO_RESOURCE};
+  RGResource _rgSwapchain{RG_NO_RESOURCE};
+  RGResource _rgVisibility{RG_NO_RESOURCE};
+  RGResource _rgEarlyCommands{RG_NO_RESOURCE};
+  RGResource _rgLateCommands{RG_NO_RESOURCE};
+
   VkSurfaceKHR _surface;
   VkSwapchainKHR _swapchain;
+  // What the swapchain was created with, vk-bootstrap falls back to another
+  // mode when the configured one isn't supported
+  VkPresentModeKHR _presentMode{VK_PRESENT_MODE_FIFO_KHR};
   VkFormat _swapchainImageFormat;
 
-  std::vector<VkFramebuffer> _framebuffers;
   std::vector<VkImage> _swapchainImages;
   std::vector<VkImageView> _swapchainImageViews;
 
@@ -115,16 +261,50 @@ class VulkanEngine {
   AllocatedImage _depthImage;
   VkFormat _depthFormat;
 
+  // The scene is rendered offscreen at _renderExtent, which may be smaller
+  // than the window, and blitted to the swapchain image at the end of the
+  // frame. Color and depth are allocated at the window size, color as a
+  // transient image of the render graph.
+  VkFormat _sceneColorFormat;
+  VkExtent2D _renderExtent;
+
+  DynamicResolution _dynamicResolution;
+
+  // GPU zones are collected when a frame slot's fence has signaled
+  Profiler _profiler;
+  FrameStats _frameStats;
+  float _gpuFrameMs{0.0f};
+  double _statsTimer{0.0};
+
   VkDescriptorSetLayout _globalSetLayout;
   VkDescriptorSetLayout _objectSetLayout;
   VkDescriptorSetLayout _singleTextureSetLayout;
   VkDescriptorPool _descriptorPool;
 
   GPUSceneData _sceneParameters;
-  AllocatedBuffer _sceneParameterBuffer;
+
+  // Per-frame uniform and storage data is bump allocated from this ring and
+  // bound through _globalDescriptor with dynamic offsets
+  AllocatedBuffer _transientBuffer;
+  TransientAllocator _transientAllocator;
+  VkDescriptorSet _globalDescriptor;
+
+  // Grows on demand and only uploads objects that changed
+  ObjectBuffer _objectBuffer;
+
+  OcclusionCuller _occlusionCuller;
+
+  ClusteredLighting _clusteredLighting;
+  bool _occlusionCulling{true};
+
+  // Depth only pipeline reading Mesh::_positionBuffer
+  VkPipeline _depthPrepassPipeline;
+  VkPipelineLayout _depthPrepassLayout;
 
   UploadContext _uploadContext;
 
+  LatencyTracker _latency;
+
   // initializes everything in the engine
   void init(void);
 
@@ -138,24 +318,82 @@ class VulkanEngine {
   void run(void);
 
   std::vector<RenderObject> _renderables;
+  // Bumped whenever _renderables is added to or reordered
+  uint64_t _renderablesVersion{1};
+
+  TransformStore _transforms;
+
+  // World bounds of every renderable by transform id. Moved objects are
+  // refitted each update, adding renderables rebuilds it.
+  Bvh _sceneBvh;
+  bool _sceneBvhDirty{true};
+
+  // Resources are referenced by handle. The names are only looked up while
+  // loading.
+  HandlePool<Material> _materials;
+  HandlePool<Mesh> _meshes;
+  HandlePool<Texture> _textures;
+  std::unordered_map<std::string, MaterialHandle> _materialNames;
+  std::unordered_map<std::string, MeshHandle> _meshNames;
+  std::unordered_map<std::string, TextureHandle> _textureNames;
+
+  MaterialHandle create_material(VkPipeline pipeline, VkPipelineLayout layout,
+                                 const std::string& name);
+
+  // The find functions return a null handle for unknown names
+  MaterialHandle find_material(const std::string& name) const;
 
-  std::unordered_map<std::string, Material> _materials;
-  std::unordered_map<std::string, Mesh> _meshes;
-  std::unordered_map<std::string, Texture> _loadedTextures;
+  MeshHandle find_mesh(const std::string& name) const;
 
-  Material* create_material(VkPipeline pipeline, VkPipelineLayout layout,
-                            const std::string& name);
+  TextureHandle find_texture(const std::string& name) const;
 
-  Material* get_material(const std::string& name);
+  // Registers the object for drawing and stores its bounds and vertex count
+  // in the object buffer for the culling pass
+  void add_renderable(const RenderObject& object);
 
-  Mesh* get_mesh(const std::string& name);
+  // Draws the snapshot's objects. With drawCommands set, the culling pass
+  // wrote one command per object at its position in the draw order, so
+  // every run of objects sharing a mesh and material is a single multi-draw.
+  // Otherwise the objects are drawn directly.
+  void draw_objects(VkCommandBuffer cmd, const FrameSnapshot& snapshot,
+                    VkBuffer drawCommands = VK_NULL_HANDLE);
 
-  void draw_objects(VkCommandBuffer cmd, RenderObject* first, int count);
+  // Fills depth for the same objects and commands as draw_objects
+  void draw_depth_prepass(VkCommandBuffer cmd, const FrameSnapshot& snapshot,
+                          VkBuffer drawCommands = VK_NULL_HANDLE);
+
+  // Issues the count consecutive commands starting at slot first
+  void draw_indirect_range(VkCommandBuffer cmd, VkBuffer drawCommands,
+                           uint32_t first, uint32_t count);
 
   FrameData& get_current_frame(void);
 
+  uint32_t get_frame_index(void) const {
+    return _frameNumber % static_cast<uint32_t>(_frames.size());
+  }
+
+  uint32_t frame_count(void) const {
+    return static_cast<uint32_t>(_frames.size());
+  }
+
+  // Resources pushed here are destroyed once every frame prepared so far has
+  // finished, without stalling. It is the queue of the last prepared frame,
+  // so retire resources outside of draw(): the frame that is being prepared
+  // may still use them after that.
+  DeletionQueue& retire_queue(void) {
+    return _frames[(_frameNumber + frame_count() - 1) % frame_count()]
+        ._deletionQueue;
+  }
+
   AllocatedBuffer create_buffer(size_t allocSize, VkBufferUsageFlags usage,
-                                VmaMemoryUsage memoryUsage);
+                                VmaMemoryUsage memoryUsage,
+                                MemoryCategory category,
+                                VmaAllocationCreateFlags allocFlags = 0);
+
+  // Untracks and frees buffers and images made with the engine's allocator
+  void destroy_buffer(const AllocatedBuffer& buffer);
+
+  void destroy_image(const AllocatedImage& image);
 
   size_t pad_uniform_buffer_size(size_t originalSize);
 
@@ -163,9 +401,45 @@ class VulkanEngine {
 
   void load_images();
 
+  bool load_shader_module(const std::string filePath,
+                          VkShaderModule* outShaderModule);
+
+  const std::string& get_path(void) const { return path; }
+
  private:
   std::string path;
 
+  // Worker threads shared by the subsystems: transform updates, BVH
+  // rebuilds, asset decode and chunk remeshing. Jobs that have to call SDL
+  // run on the main thread at the start of each frame.
+  JobSystem _jobs;
+
+  // Prepared frames are handed to recording through _snapshots, which has
+  // room for every frame in flight. Recording happens inline in draw()
+  // unless the render thread runs. A frame slot is only prepared again once
+  // the frame that last used it is finished, i.e. submitted and presented.
+  SpscRing<FrameSnapshot> _snapshots;
+  std::thread _renderThread;
+  std::atomic<int> _finishedFrames{0};
+
+  // The render thread sleeps while there's nothing to record and the main
+  // thread while it waits for a frame to finish. The ring never locks.
+  std::mutex _renderMutex;
+  std::condition_variable _renderWake;
+  std::condition_variable _frameFinished;
+  std::atomic<bool> _renderStop{false};
+
+  // Snapshot being recorded, the render graph passes read it
+  const FrameSnapshot* _recording{nullptr};
+
+  // Result of the CPU frustum test per transform id, 1 when visible
+  std::vector<uint8_t> _visibleObjects;
+  // Ids set in _visibleObjects, cleared again before the next test
+  std::vector<uint32_t> _visibleIds;
+
+  // Of the last prepared frame, rays for picking are unprojected with it
+  glm::mat4 _viewProj{1.0f};
+
   bool bQuit = false;
 
   int _mouseX{0}, _mouseY{0};
@@ -178,18 +452,73 @@ class VulkanEngine {
 
   void init_default_renderpass(void);
 
-  void init_framebuffers(void);
-
   void init_commands(void);
 
   void init_sync_structures(void);
 
+  void init_profiler(void);
+
+  void start_render_thread(void);
+
+  // Lets the render thread finish every published frame, then joins it
+  void stop_render_thread(void);
+
+  void render_thread_main(void);
+
+  // Blocks until every frame before frameNumber is finished
+  void wait_for_finished(int frameNumber);
+
+  // Waits for every published frame. Required before changing anything
+  // recording reads outside of a snapshot, like the render graph.
+  void wait_render_idle(void) { wait_for_finished(_frameNumber); }
+
+  // Records, submits and presents a prepared frame. Frame statistics belong
+  // to the main thread, which counts publishing a frame as presenting it
+  // while the render thread runs.
+  void render_frame(const FrameSnapshot& snapshot, bool onRenderThread);
+
+  // Picks this frame's render extent from the last measured GPU time
+  void update_render_scale(void);
+
+  void set_render_viewport(VkCommandBuffer cmd, VkExtent2D renderExtent);
+
+  // Declares the frame's passes and compiles them, the device has to be idle
+  void build_render_graph(void);
+
+  // Upscales the scene color to the swapchain image. Both images are
+  // transitioned by the render graph.
+  void blit_to_swapchain(VkCommandBuffer cmd, VkImage target,
+                         VkExtent2D renderExtent);
+
+  void print_stats(void);
+
+  // Returns false when nothing was rendered
+  bool run_frame(void);
+
+  // Plays the camera path once per configuration and writes the report
+  void run_benchmark(void);
+
+  BenchmarkRun run_benchmark_pass(const char* label, uint32_t frames);
+
+  void record_camera(double deltaTime);
+
   void update(void);
 
-  void handle_input(void);
+  // Writes changed world matrices straight into the object buffer mirror
+  void update_transforms(void);
 
-  bool load_shader_module(const std::string filePath,
-                          VkShaderModule* outShaderModule);
+  // Refits the bounds of moved objects, or rebuilds the tree after
+  // renderables were added
+  void update_scene_bvh(void);
+
+  // World box of the renderable's bounding sphere
+  Aabb object_bounds(TransformId id);
+
+  // Casts a ray through the window pixel and prints the first object box it
+  // hits
+  void pick_object(int x, int y);
+
+  void handle_input(void);
 
   void init_pipelines(void);
 
@@ -197,9 +526,52 @@ class VulkanEngine {
 
   void upload_mesh(Mesh& mesh);
 
+  // Copies the data to a new GPU only vertex buffer through a staging buffer
+  AllocatedBuffer upload_vertex_data(const void* data, size_t size);
+
   void init_scene(void);
 
+  // Adds the instances requested by _config.stressScene
+  void init_stress_scene(void);
+
+  void init_lights(void);
+
+  // Replaces the lostempire mesh with the chunks of _voxelWorld
+  void init_voxel_world(void);
+
+  // Makes the stress edits, queues dirty chunks for remeshing and swaps in
+  // the meshes that are done
+  void update_voxel_world(double deltaTime);
+
+  // Writes a finished chunk mesh to new host visible buffers and retires the
+  // old ones. Returns true if the chunk got a new renderable.
+  bool apply_chunk_mesh(ChunkMeshResult& result);
+
+  void retire_chunk_buffers(Mesh& mesh);
+
+  // Orders the renderables by material and then mesh
+  void sort_renderables(void);
+
+  // Fills _visibleObjects from _sceneBvh, used when occlusion culling is off
+  void cull_frustum(const glm::mat4& viewProj);
+
   void init_descriptors(void);
+
+  void init_occlusion_culling(void);
+
+  void init_clustered_lighting(void);
+
+  void init_render_graph(void);
+
+  // Uploads the camera, scene and object data of the frame and captures what
+  // recording it needs in the snapshot
+  void prepare_frame_data(FrameSnapshot& snapshot);
+
+  // Brings the snapshot's renderables to draw and the pool items they
+  // reference up to date, copying only what changed since it was last used
+  void capture_draws(FrameSnapshot& snapshot);
+
+  void write_object_descriptor(uint32_t frameIndex);
 };
 
 #endif /* C12F24BE_7752_44A1_B4B1_AA3E1F0F254D */
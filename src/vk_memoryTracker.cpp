@@ -0,0 +1,118 @@
+#include "vk_memoryTracker.h"
+
+#include <cstdio>
+#include <iostream>
+
+const char* memory_category_name(MemoryCategory category) {
+  switch (category) {
+    case MemoryCategory::Mesh:
+      return "mesh";
+    case MemoryCategory::Texture:
+      return "texture";
+    case MemoryCategory::PerFrame:
+      return "per-frame";
+    case MemoryCategory::Attachment:
+      return "attachment";
+    case MemoryCategory::Staging:
+      return "staging";
+    default:
+      return "other";
+  }
+}
+
+static double to_mib(VkDeviceSize bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+void MemoryTracker::init(VmaAllocator allocator, bool budgetExtension) {
+  _allocator = allocator;
+  _budgetExtension = budgetExtension;
+
+  const VkPhysicalDeviceMemoryProperties* memoryProperties;
+  vmaGetMemoryProperties(_allocator, &memoryProperties);
+
+  _heapCount = memoryProperties->memoryHeapCount;
+  for (uint32_t i = 0; i < memoryProperties->memoryTypeCount; i++) {
+    _typeHeaps[i] = memoryProperties->memoryTypes[i].heapIndex;
+  }
+
+  vmaGetBudget(_allocator, _budgets);
+}
+
+void MemoryTracker::track(VmaAllocation allocation, MemoryCategory category) {
+  VmaAllocationInfo info;
+  vmaGetAllocationInfo(_allocator, allocation, &info);
+
+  Entry entry;
+  entry.category = category;
+  entry.heap = _typeHeaps[info.memoryType];
+  entry.size = info.size;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _allocations[allocation] = entry;
+  _bytes[entry.heap][static_cast<size_t>(category)] += entry.size;
+}
+
+void MemoryTracker::untrack(VmaAllocation allocation) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto it = _allocations.find(allocation);
+  if (it == _allocations.end()) return;
+
+  const Entry& entry = it->second;
+  _bytes[entry.heap][static_cast<size_t>(entry.category)] -= entry.size;
+  _allocations.erase(it);
+}
+
+void MemoryTracker::update(uint32_t frameNumber) {
+  // VMA only queries the extension's budgets when the frame index changes
+  vmaSetCurrentFrameIndex(_allocator, frameNumber);
+  vmaGetBudget(_allocator, _budgets);
+
+  for (uint32_t heap = 0; heap < _heapCount; heap++) {
+    const VmaBudget& budget = _budgets[heap];
+    const bool near =
+        budget.budget > 0 &&
+        budget.usage > static_cast<VkDeviceSize>(budget.budget *
+                                                 MEMORY_BUDGET_WARNING);
+
+    if (near && !_nearBudget[heap]) {
+      std::cerr << "Memory heap " << heap << " is close to its budget: "
+                << to_mib(budget.usage) << " of " << to_mib(budget.budget)
+                << " MiB used" << std::endl;
+    }
+    _nearBudget[heap] = near;
+  }
+}
+
+VkDeviceSize MemoryTracker::category_bytes(MemoryCategory category) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  VkDeviceSize total = 0;
+  for (uint32_t heap = 0; heap < _heapCount; heap++) {
+    total += _bytes[heap][static_cast<size_t>(category)];
+  }
+  return total;
+}
+
+void MemoryTracker::print() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  printf("GPU memory (%s budget)\n",
+         _budgetExtension ? "driver" : "estimated");
+
+  for (uint32_t heap = 0; heap < _heapCount; heap++) {
+    const VmaBudget& budget = _budgets[heap];
+    printf("  heap %u: %.1f / %.1f MiB used, %.1f MiB in blocks, %.1f MiB "
+           "allocated\n",
+           heap, to_mib(budget.usage), to_mib(budget.budget),
+           to_mib(budget.blockBytes), to_mib(budget.allocationBytes));
+
+    for (size_t category = 0; category < CATEGORY_COUNT; category++) {
+      if (_bytes[heap][category] == 0) continue;
+      printf("    %-10s %8.2f MiB\n",
+             memory_category_name(static_cast<MemoryCategory>(category)),
+             to_mib(_bytes[heap][category]));
+    }
+  }
+}
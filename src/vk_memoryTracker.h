@@ -0,0 +1,75 @@
+#ifndef E4C7A2D9_3B61_4F08_8D5E_A19F6C3B72E0
+#define E4C7A2D9_3B61_4F08_8D5E_A19F6C3B72E0
+
+#include "vk_types.h"
+
+#include <mutex>
+#include <unordered_map>
+
+// What an allocation is used for. Staging buffers only live for the duration
+// of an upload but still count while they exist.
+enum class MemoryCategory {
+  Mesh,
+  Texture,
+  PerFrame,
+  Attachment,
+  Staging,
+  Other,
+  Count
+};
+
+const char* memory_category_name(MemoryCategory category);
+
+// A heap is reported once its usage crosses this fraction of its budget
+constexpr float MEMORY_BUDGET_WARNING = 0.9f;
+
+// Keeps live byte counts of the allocator's allocations per category and
+// heap, and watches the heap budgets. With VK_EXT_memory_budget the budgets
+// come from the driver and include memory allocated outside of VMA, otherwise
+// VMA estimates them from the heap sizes.
+//
+// Every allocation has to be tracked right after it is created and untracked
+// right before it is destroyed.
+class MemoryTracker {
+ public:
+  void init(VmaAllocator allocator, bool budgetExtension);
+
+  void track(VmaAllocation allocation, MemoryCategory category);
+
+  void untrack(VmaAllocation allocation);
+
+  // Refreshes the heap budgets and warns about heaps close to their budget.
+  // Call once per frame, the budgets are only queried from the driver here.
+  void update(uint32_t frameNumber);
+
+  VkDeviceSize category_bytes(MemoryCategory category) const;
+
+  void print(void) const;
+
+ private:
+  static constexpr size_t CATEGORY_COUNT =
+      static_cast<size_t>(MemoryCategory::Count);
+
+  struct Entry {
+    MemoryCategory category;
+    uint32_t heap;
+    VkDeviceSize size;
+  };
+
+  VmaAllocator _allocator{VK_NULL_HANDLE};
+  bool _budgetExtension{false};
+  uint32_t _heapCount{0};
+  // Heap of every memory type
+  uint32_t _typeHeaps[VK_MAX_MEMORY_TYPES];
+
+  // track and untrack may be called from any thread
+  mutable std::mutex _mutex;
+  std::unordered_map<VmaAllocation, Entry> _allocations;
+  VkDeviceSize _bytes[VK_MAX_MEMORY_HEAPS][CATEGORY_COUNT]{};
+
+  VmaBudget _budgets[VK_MAX_MEMORY_HEAPS]{};
+  // Set while a heap is above the warning threshold so it warns only once
+  bool _nearBudget[VK_MAX_MEMORY_HEAPS]{};
+};
+
+#endif /* E4C7A2D9_3B61_4F08_8D5E_A19F6C3B72E0 */
@@ -1,6 +1,10 @@
 #include "vk_mesh.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
 
 #include <tiny_obj_loader.h>
 
@@ -46,7 +50,29 @@ VertexInputDescription Vertex::get_vertex_description() {
   return description;
 }
 
-bool Mesh::load_from_obj(const std::string& filename) {
+VertexInputDescription Vertex::get_position_only_description() {
+  VertexInputDescription description;
+
+  VkVertexInputBindingDescription positionBinding{};
+  positionBinding.binding = 0;
+  positionBinding.stride = sizeof(glm::vec3);
+  positionBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  description.bindings.push_back(positionBinding);
+
+  VkVertexInputAttributeDescription positionAttribute{};
+  positionAttribute.binding = 0;
+  positionAttribute.location = 0;
+  positionAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+  positionAttribute.offset = 0;
+
+  description.attributes.push_back(positionAttribute);
+
+  return description;
+}
+
+bool Mesh::load_from_obj(const std::string& filename,
+                         std::string* outWarning) {
   // Container for the vertex data
   tinyobj::attrib_t attrib;
 
@@ -62,7 +88,9 @@ bool Mesh::load_from_obj(const std::string& filename) {
   tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename.c_str(),
                    nullptr);
 
-  if (!warn.empty()) {
+  if (outWarning) {
+    *outWarning = warn;
+  } else if (!warn.empty()) {
     std::cout << "WARN: " << warn << std::endl;
   }
 
@@ -110,5 +138,33 @@ bool Mesh::load_from_obj(const std::string& filename) {
     }
   }
 
+  compute_bounds();
+
   return true;
+}
+
+void Mesh::compute_bounds() {
+  if (_vertices.empty()) {
+    _boundsCenter = glm::vec3(0.0f);
+    _boundsRadius = 0.0f;
+    return;
+  }
+
+  // Sphere around the center of the axis aligned box. Not the tightest fit
+  // but cheap and good enough for culling.
+  glm::vec3 minPos = _vertices[0].position;
+  glm::vec3 maxPos = _vertices[0].position;
+  for (const Vertex& vertex : _vertices) {
+    minPos = glm::min(minPos, vertex.position);
+    maxPos = glm::max(maxPos, vertex.position);
+  }
+
+  _boundsCenter = (minPos + maxPos) * 0.5f;
+
+  float radiusSquared = 0.0f;
+  for (const Vertex& vertex : _vertices) {
+    const glm::vec3 offset = vertex.position - _boundsCenter;
+    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+  }
+  _boundsRadius = std::sqrt(radiusSquared);
 }
\ No newline at end of file
@@ -23,6 +23,9 @@ struct Vertex {
   glm::vec2 uv;
 
   static VertexInputDescription get_vertex_description();
+
+  // Single tightly packed position stream, used by depth only pipelines
+  static VertexInputDescription get_position_only_description();
 };
 
 struct Mesh {
@@ -30,7 +33,18 @@ struct Mesh {
 
   AllocatedBuffer _vertexBuffer;
 
-  bool load_from_obj(const std::string& filename);
+  // Positions split from _vertices at upload time
+  AllocatedBuffer _positionBuffer;
+
+  // Bounding sphere in model space, used for GPU culling
+  glm::vec3 _boundsCenter{0.0f};
+  float _boundsRadius{0.0f};
+
+  // Parser warnings are printed, or stored in outWarning when it is given
+  bool load_from_obj(const std::string& filename,
+                     std::string* outWarning = nullptr);
+
+  void compute_bounds(void);
 };
 
 #endif /* B75A0784_44B4_4B00_A0C0_899C54E55663 */
@@ -0,0 +1,168 @@
+#include "vk_objectBuffer.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+// Ranges closer than this many objects are uploaded as one copy
+constexpr uint32_t DIRTY_MERGE_GAP = 8;
+
+constexpr uint32_t MIN_OBJECT_CAPACITY = 1024;
+
+void ObjectBuffer::init(VmaAllocator allocator, MemoryTracker* tracker,
+                        uint32_t frameCount, uint32_t initialCapacity) {
+  _allocator = allocator;
+  _tracker = tracker;
+
+  _copies.resize(frameCount);
+  for (FrameCopy& copy : _copies) {
+    allocate_copy(copy, std::max(initialCapacity, MIN_OBJECT_CAPACITY));
+  }
+}
+
+void ObjectBuffer::cleanup() {
+  for (FrameCopy& copy : _copies) {
+    free_copy(copy);
+  }
+  _copies.clear();
+  _objects.clear();
+}
+
+void ObjectBuffer::resize(uint32_t count) {
+  const uint32_t oldCount = size();
+  _objects.resize(count);
+
+  if (count > oldCount) {
+    mark_dirty(oldCount, count - oldCount);
+  }
+}
+
+void ObjectBuffer::set(uint32_t index, const GPUObjectData& object) {
+  assert(index < _objects.size());
+
+  if (memcmp(&_objects[index], &object, sizeof(GPUObjectData)) == 0) return;
+
+  _objects[index] = object;
+  mark_dirty(index, 1);
+}
+
+void ObjectBuffer::mark_dirty(uint32_t first, uint32_t count) {
+  if (count == 0) return;
+
+  for (FrameCopy& copy : _copies) {
+    // Cheap coalescing for the common case of sequential writes
+    if (!copy.dirty.empty()) {
+      DirtyRange& last = copy.dirty.back();
+      if (first >= last.first && first <= last.first + last.count) {
+        last.count = std::max(last.count, first + count - last.first);
+        continue;
+      }
+    }
+    copy.dirty.push_back({first, count});
+  }
+}
+
+bool ObjectBuffer::flush(uint32_t frameIndex) {
+  FrameCopy& copy = _copies[frameIndex];
+  const uint32_t count = size();
+
+  _uploadedBytes = 0;
+
+  bool reallocated = false;
+  if (copy.capacity < count) {
+    // The fence of this frame has signaled so its old buffer is unused
+    free_copy(copy);
+    allocate_copy(copy, std::max(count, copy.capacity * 2));
+
+    // The new buffer has no content yet, upload everything
+    copy.dirty.clear();
+    copy.dirty.push_back({0, count});
+    reallocated = true;
+  }
+
+  if (copy.dirty.empty()) return reallocated;
+
+  std::sort(copy.dirty.begin(), copy.dirty.end(),
+            [](const DirtyRange& a, const DirtyRange& b) {
+              return a.first < b.first;
+            });
+
+  GPUObjectData* dst = static_cast<GPUObjectData*>(copy.buffer._mapped);
+
+  uint32_t flushBegin = UINT32_MAX;
+  uint32_t flushEnd = 0;
+
+  size_t i = 0;
+  while (i < copy.dirty.size()) {
+    uint32_t begin = copy.dirty[i].first;
+    uint32_t end = begin + copy.dirty[i].count;
+
+    // Merge every following range that overlaps or nearly touches this one
+    for (i++; i < copy.dirty.size(); i++) {
+      if (copy.dirty[i].first > end + DIRTY_MERGE_GAP) break;
+      end = std::max(end, copy.dirty[i].first + copy.dirty[i].count);
+    }
+
+    // Objects may have been removed since the range was recorded
+    end = std::min(end, count);
+    if (begin >= end) continue;
+
+    memcpy(dst + begin, _objects.data() + begin,
+           sizeof(GPUObjectData) * (end - begin));
+
+    _uploadedBytes += sizeof(GPUObjectData) * (end - begin);
+    flushBegin = std::min(flushBegin, begin);
+    flushEnd = std::max(flushEnd, end);
+  }
+
+  copy.dirty.clear();
+
+  if (flushBegin < flushEnd) {
+    vmaFlushAllocation(_allocator, copy.buffer._allocation,
+                       sizeof(GPUObjectData) * flushBegin,
+                       sizeof(GPUObjectData) * (flushEnd - flushBegin));
+  }
+
+  return reallocated;
+}
+
+VkDescriptorBufferInfo ObjectBuffer::descriptor_info(
+    uint32_t frameIndex) const {
+  const FrameCopy& copy = _copies[frameIndex];
+
+  VkDescriptorBufferInfo info = {};
+  info.buffer = copy.buffer._buffer;
+  info.offset = 0;
+  info.range = sizeof(GPUObjectData) * copy.capacity;
+
+  return info;
+}
+
+void ObjectBuffer::allocate_copy(FrameCopy& copy, uint32_t capacity) {
+  VkBufferCreateInfo bufferInfo = {};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.pNext = nullptr;
+  bufferInfo.size = sizeof(GPUObjectData) * capacity;
+  bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+  VmaAllocationCreateInfo vmaAllocInfo = {};
+  vmaAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+  vmaAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+  VmaAllocationInfo allocationInfo;
+  VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &vmaAllocInfo,
+                           &copy.buffer._buffer, &copy.buffer._allocation,
+                           &allocationInfo));
+
+  copy.buffer._mapped = allocationInfo.pMappedData;
+  copy.capacity = capacity;
+
+  if (_tracker != nullptr) {
+    _tracker->track(copy.buffer._allocation, MemoryCategory::PerFrame);
+  }
+}
+
+void ObjectBuffer::free_copy(FrameCopy& copy) {
+  if (_tracker != nullptr) _tracker->untrack(copy.buffer._allocation);
+  vmaDestroyBuffer(_allocator, copy.buffer._buffer, copy.buffer._allocation);
+}
@@ -0,0 +1,80 @@
+#ifndef F0B6D2A4_8C1E_4A57_B3D9_6E2C7A90F1D4
+#define F0B6D2A4_8C1E_4A57_B3D9_6E2C7A90F1D4
+
+#include "vk_types.h"
+#include "vk_memoryTracker.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct GPUObjectData {
+  glm::mat4 modelMatrix;
+  glm::vec4 sphereBounds;  // xyz for the model space center, w for radius
+  uint32_t vertexCount;    // 0 for transforms that have nothing to draw
+  uint32_t drawSlot;       // where culling writes the object's draw command
+  uint32_t padding[2];
+};
+
+// Object storage buffer with one persistently mapped copy per frame in flight.
+// The CPU keeps a mirror of every object; writes mark dirty ranges and each
+// frame copy only receives the ranges that changed since it was last used.
+// A frame copy is reallocated when the object count outgrows it.
+class ObjectBuffer {
+ public:
+  // The tracker is optional and counts the copies as per-frame memory
+  void init(VmaAllocator allocator, MemoryTracker* tracker,
+            uint32_t frameCount, uint32_t initialCapacity);
+
+  void cleanup(void);
+
+  // Grows or shrinks the object count. New objects are marked dirty.
+  void resize(uint32_t count);
+
+  uint32_t size(void) const { return static_cast<uint32_t>(_objects.size()); }
+
+  // Stores the data and only marks the object dirty if it actually changed
+  void set(uint32_t index, const GPUObjectData& object);
+
+  // Bulk writers can fill the mirror directly, they are responsible for
+  // calling mark_dirty on what they wrote
+  GPUObjectData* data(void) { return _objects.data(); }
+
+  void mark_dirty(uint32_t first, uint32_t count);
+
+  // Brings the copy of frameIndex up to date. Must only be called once the
+  // fence of that frame has signaled. Returns true if the buffer of that frame
+  // was reallocated, in which case its descriptor has to be rewritten.
+  bool flush(uint32_t frameIndex);
+
+  VkDescriptorBufferInfo descriptor_info(uint32_t frameIndex) const;
+
+  // Bytes written to the GPU copy by the last flush
+  size_t uploaded_bytes(void) const { return _uploadedBytes; }
+
+ private:
+  struct DirtyRange {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  struct FrameCopy {
+    AllocatedBuffer buffer{};
+    uint32_t capacity{0};
+    std::vector<DirtyRange> dirty;
+  };
+
+  void allocate_copy(FrameCopy& copy, uint32_t capacity);
+
+  void free_copy(FrameCopy& copy);
+
+  VmaAllocator _allocator{VK_NULL_HANDLE};
+  MemoryTracker* _tracker{nullptr};
+
+  std::vector<GPUObjectData> _objects;
+  std::vector<FrameCopy> _copies;
+
+  size_t _uploadedBytes{0};
+};
+
+#endif /* F0B6D2A4_8C1E_4A57_B3D9_6E2C7A90F1D4 */
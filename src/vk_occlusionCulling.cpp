@@ -0,0 +1,444 @@
+#include "vk_occlusionCulling.h"
+#include "vk_engine.h"
+#include "vk_initializers.h"
+
+#include <algorithm>
+
+constexpr uint32_t MIN_CULL_CAPACITY = 1024;
+
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+constexpr uint32_t REDUCE_GROUP_SIZE = 32;
+
+// The pyramid is at most this many mips, enough for 32k wide targets
+constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+
+static uint32_t previous_pow2(uint32_t value) {
+  uint32_t result = 1;
+  while (result * 2 <= value) result *= 2;
+  return result;
+}
+
+static VkPipeline create_compute_pipeline(VkDevice device,
+                                          VkShaderModule module,
+                                          VkPipelineLayout layout) {
+  VkComputePipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.pNext = nullptr;
+  pipelineInfo.stage = vkinit::pipeline_shader_stage_create_info(
+      VK_SHADER_STAGE_COMPUTE_BIT, module);
+  pipelineInfo.layout = layout;
+
+  VkPipeline pipeline;
+  VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
+                                    nullptr, &pipeline));
+  return pipeline;
+}
+
+static void compute_barrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStage,
+                            VkAccessFlags srcAccess,
+                            VkPipelineStageFlags dstStage,
+                            VkAccessFlags dstAccess) {
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+
+  vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0,
+                       nullptr);
+}
+
+void OcclusionCuller::init(VulkanEngine& engine, VkImageView depthView,
+                           VkExtent2D extent) {
+  _engine = &engine;
+  VkDevice device = engine._device;
+  const uint32_t frameCount = engine.frame_count();
+
+  std::vector<VkDescriptorPoolSize> sizes = {
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * frameCount},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+       frameCount + MAX_PYRAMID_LEVELS},
+      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_PYRAMID_LEVELS},
+  };
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.flags = 0;
+  poolInfo.maxSets = frameCount + MAX_PYRAMID_LEVELS;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+  poolInfo.pPoolSizes = sizes.data();
+
+  VK_CHECK(
+      vkCreateDescriptorPool(device, &poolInfo, nullptr, &_descriptorPool));
+
+  // Culling set: objects, visibility, early and late commands, pyramid
+  VkDescriptorSetLayoutBinding cullBindings[5];
+  for (uint32_t i = 0; i < 4; i++) {
+    cullBindings[i] = vkinit::descriptorset_layout_binding(
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, i);
+  }
+  cullBindings[4] = vkinit::descriptorset_layout_binding(
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT,
+      4);
+
+  VkDescriptorSetLayoutCreateInfo cullSetInfo = {};
+  cullSetInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  cullSetInfo.pNext = nullptr;
+  cullSetInfo.bindingCount = 5;
+  cullSetInfo.flags = 0;
+  cullSetInfo.pBindings = cullBindings;
+
+  VK_CHECK(vkCreateDescriptorSetLayout(device, &cullSetInfo, nullptr,
+                                       &_cullSetLayout));
+
+  // Reduce set: source mip (or the depth image) and destination mip
+  VkDescriptorSetLayoutBinding reduceBindings[2] = {
+      vkinit::descriptorset_layout_binding(
+          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          VK_SHADER_STAGE_COMPUTE_BIT, 0),
+      vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                           VK_SHADER_STAGE_COMPUTE_BIT, 1),
+  };
+
+  VkDescriptorSetLayoutCreateInfo reduceSetInfo = cullSetInfo;
+  reduceSetInfo.bindingCount = 2;
+  reduceSetInfo.pBindings = reduceBindings;
+
+  VK_CHECK(vkCreateDescriptorSetLayout(device, &reduceSetInfo, nullptr,
+                                       &_reduceSetLayout));
+
+  VkPushConstantRange cullPushConstant;
+  cullPushConstant.offset = 0;
+  cullPushConstant.size = sizeof(CullPushConstants);
+  cullPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkPipelineLayoutCreateInfo cullLayoutInfo =
+      vkinit::pipeline_layout_create_info();
+  cullLayoutInfo.setLayoutCount = 1;
+  cullLayoutInfo.pSetLayouts = &_cullSetLayout;
+  cullLayoutInfo.pushConstantRangeCount = 1;
+  cullLayoutInfo.pPushConstantRanges = &cullPushConstant;
+
+  VK_CHECK(
+      vkCreatePipelineLayout(device, &cullLayoutInfo, nullptr, &_cullLayout));
+
+  VkPushConstantRange reducePushConstant = cullPushConstant;
+  reducePushConstant.size = sizeof(DepthReducePushConstants);
+
+  VkPipelineLayoutCreateInfo reduceLayoutInfo = cullLayoutInfo;
+  reduceLayoutInfo.pSetLayouts = &_reduceSetLayout;
+  reduceLayoutInfo.pPushConstantRanges = &reducePushConstant;
+
+  VK_CHECK(vkCreatePipelineLayout(device, &reduceLayoutInfo, nullptr,
+                                  &_reduceLayout));
+
+  VkShaderModule cullShader;
+  if (!engine.load_shader_module(
+          engine.get_path() + "/shaders/occlusion_cull.comp.spv",
+          &cullShader)) {
+    std::cout << "Error when building the occlusion culling shader"
+              << std::endl;
+  }
+
+  VkShaderModule reduceShader;
+  if (!engine.load_shader_module(
+          engine.get_path() + "/shaders/depth_reduce.comp.spv",
+          &reduceShader)) {
+    std::cout << "Error when building the depth reduce shader" << std::endl;
+  }
+
+  _cullPipeline = create_compute_pipeline(device, cullShader, _cullLayout);
+  _reducePipeline =
+      create_compute_pipeline(device, reduceShader, _reduceLayout);
+
+  vkDestroyShaderModule(device, cullShader, nullptr);
+  vkDestroyShaderModule(device, reduceShader, nullptr);
+
+  // Depth is fetched texel by texel, no filtering involved
+  VkSamplerCreateInfo samplerInfo = vkinit::sampler_create_info(
+      VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+  VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &_pyramidSampler));
+
+  _cullSets.resize(frameCount);
+  _objectInfos.resize(frameCount);
+  for (uint32_t i = 0; i < frameCount; i++) {
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.descriptorPool = _descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &_cullSetLayout;
+
+    VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &_cullSets[i]));
+  }
+
+  create_pyramid(depthView, extent);
+  create_object_buffers(MIN_CULL_CAPACITY);
+}
+
+void OcclusionCuller::cleanup() {
+  VkDevice device = _engine->_device;
+
+  destroy_object_buffers();
+
+  for (VkImageView view : _pyramidMips) {
+    vkDestroyImageView(device, view, nullptr);
+  }
+  vkDestroyImageView(device, _pyramidView, nullptr);
+  _engine->destroy_image(_pyramid);
+
+  vkDestroySampler(device, _pyramidSampler, nullptr);
+
+  vkDestroyPipeline(device, _cullPipeline, nullptr);
+  vkDestroyPipeline(device, _reducePipeline, nullptr);
+  vkDestroyPipelineLayout(device, _cullLayout, nullptr);
+  vkDestroyPipelineLayout(device, _reduceLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, _cullSetLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, _reduceSetLayout, nullptr);
+
+  vkDestroyDescriptorPool(device, _descriptorPool, nullptr);
+}
+
+void OcclusionCuller::reserve_objects(uint32_t count) {
+  if (count <= _objectCapacity) return;
+
+  // Frames in flight may still read the old buffers
+  vkDeviceWaitIdle(_engine->_device);
+
+  const uint32_t capacity = std::max(count, _objectCapacity * 2);
+  destroy_object_buffers();
+  create_object_buffers(capacity);
+  write_cull_descriptors();
+}
+
+void OcclusionCuller::write_object_descriptor(
+    uint32_t frameIndex, const VkDescriptorBufferInfo& objectInfo) {
+  _objectInfos[frameIndex] = objectInfo;
+
+  VkDescriptorBufferInfo visibilityInfo = {_visibility._buffer, 0,
+                                           VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo earlyInfo = {_earlyCommands._buffer, 0,
+                                      VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo lateInfo = {_lateCommands._buffer, 0, VK_WHOLE_SIZE};
+
+  VkDescriptorImageInfo pyramidInfo = {};
+  pyramidInfo.sampler = _pyramidSampler;
+  pyramidInfo.imageView = _pyramidView;
+  pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+  VkDescriptorSet set = _cullSets[frameIndex];
+
+  VkWriteDescriptorSet writes[] = {
+      vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, set,
+                                      &_objectInfos[frameIndex], 0),
+      vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, set,
+                                      &visibilityInfo, 1),
+      vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, set,
+                                      &earlyInfo, 2),
+      vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, set,
+                                      &lateInfo, 3),
+      vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                     set, &pyramidInfo, 4),
+  };
+
+  vkUpdateDescriptorSets(_engine->_device, 5, writes, 0, nullptr);
+}
+
+void OcclusionCuller::cull_early(VkCommandBuffer cmd, uint32_t frameIndex,
+                                 const CullPushConstants& cullData) {
+  CullPushConstants constants = cullData;
+  constants.phase = 0;
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullLayout, 0,
+                          1, &_cullSets[frameIndex], 0, nullptr);
+  vkCmdPushConstants(cmd, _cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(CullPushConstants), &constants);
+  vkCmdDispatch(cmd, (constants.objectCount + CULL_GROUP_SIZE - 1) /
+                         CULL_GROUP_SIZE,
+                1, 1);
+}
+
+void OcclusionCuller::cull_late(VkCommandBuffer cmd, uint32_t frameIndex,
+                                CullPushConstants cullData,
+                                VkExtent2D depthExtent) {
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _reducePipeline);
+
+  glm::ivec2 srcSize(depthExtent.width, depthExtent.height);
+  for (uint32_t level = 0; level < _pyramidMips.size(); level++) {
+    DepthReducePushConstants reduceData;
+    reduceData.srcSize = srcSize;
+    reduceData.dstSize =
+        glm::ivec2(std::max(1u, _pyramidExtent.width >> level),
+                   std::max(1u, _pyramidExtent.height >> level));
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _reduceLayout,
+                            0, 1, &_reduceSets[level], 0, nullptr);
+    vkCmdPushConstants(cmd, _reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(DepthReducePushConstants), &reduceData);
+    vkCmdDispatch(
+        cmd, (reduceData.dstSize.x + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+        (reduceData.dstSize.y + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+
+    // The next level reads what this one wrote
+    compute_barrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT);
+
+    srcSize = reduceData.dstSize;
+  }
+
+  cullData.phase = 1;
+  cullData.pyramidWidth = static_cast<float>(_pyramidExtent.width);
+  cullData.pyramidHeight = static_cast<float>(_pyramidExtent.height);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullLayout, 0,
+                          1, &_cullSets[frameIndex], 0, nullptr);
+  vkCmdPushConstants(cmd, _cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(CullPushConstants), &cullData);
+  vkCmdDispatch(
+      cmd, (cullData.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1,
+      1);
+}
+
+void OcclusionCuller::create_pyramid(VkImageView depthView,
+                                     VkExtent2D extent) {
+  VkDevice device = _engine->_device;
+
+  // Power of two sizes make every level exactly half of the previous one
+  _pyramidExtent.width = previous_pow2(extent.width);
+  _pyramidExtent.height = previous_pow2(extent.height);
+
+  uint32_t levels = 1;
+  while (levels < MAX_PYRAMID_LEVELS &&
+         (std::max(_pyramidExtent.width, _pyramidExtent.height) >> levels) >
+             0) {
+    levels++;
+  }
+
+  VkImageCreateInfo imageInfo = vkinit::image_create_info(
+      VK_FORMAT_R32_SFLOAT,
+      VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+      VkExtent3D{_pyramidExtent.width, _pyramidExtent.height, 1});
+  imageInfo.mipLevels = levels;
+
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  VK_CHECK(vmaCreateImage(_engine->_allocator, &imageInfo, &allocInfo,
+                          &_pyramid._image, &_pyramid._allocation, nullptr));
+  _engine->_memoryTracker.track(_pyramid._allocation,
+                                MemoryCategory::Attachment);
+
+  VkImageViewCreateInfo viewInfo = vkinit::image_view_create_info(
+      VK_FORMAT_R32_SFLOAT, _pyramid._image, VK_IMAGE_ASPECT_COLOR_BIT);
+  viewInfo.subresourceRange.levelCount = levels;
+  VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &_pyramidView));
+
+  _pyramidMips.resize(levels);
+  for (uint32_t level = 0; level < levels; level++) {
+    VkImageViewCreateInfo mipInfo = vkinit::image_view_create_info(
+        VK_FORMAT_R32_SFLOAT, _pyramid._image, VK_IMAGE_ASPECT_COLOR_BIT);
+    mipInfo.subresourceRange.baseMipLevel = level;
+    VK_CHECK(
+        vkCreateImageView(device, &mipInfo, nullptr, &_pyramidMips[level]));
+  }
+
+  // The pyramid is written and sampled by compute only, so it simply stays
+  // in the general layout
+  _engine->immediate_submit([&](VkCommandBuffer cmd) {
+    VkImageMemoryBarrier toGeneral = {};
+    toGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toGeneral.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.image = _pyramid._image;
+    toGeneral.subresourceRange = viewInfo.subresourceRange;
+    toGeneral.srcAccessMask = 0;
+    toGeneral.dstAccessMask =
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &toGeneral);
+  });
+
+  _reduceSets.resize(levels);
+  for (uint32_t level = 0; level < levels; level++) {
+    VkDescriptorSetAllocateInfo setAlloc = {};
+    setAlloc.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAlloc.pNext = nullptr;
+    setAlloc.descriptorPool = _descriptorPool;
+    setAlloc.descriptorSetCount = 1;
+    setAlloc.pSetLayouts = &_reduceSetLayout;
+
+    VK_CHECK(vkAllocateDescriptorSets(device, &setAlloc, &_reduceSets[level]));
+
+    // Level 0 reduces the depth attachment, every other level the previous mip
+    VkDescriptorImageInfo srcInfo = {};
+    srcInfo.sampler = _pyramidSampler;
+    srcInfo.imageView = level == 0 ? depthView : _pyramidMips[level - 1];
+    srcInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                     : VK_IMAGE_LAYOUT_GENERAL;
+
+    VkDescriptorImageInfo dstInfo = {};
+    dstInfo.sampler = VK_NULL_HANDLE;
+    dstInfo.imageView = _pyramidMips[level];
+    dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet writes[] = {
+        vkinit::write_descriptor_image(
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _reduceSets[level],
+            &srcInfo, 0),
+        vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                       _reduceSets[level], &dstInfo, 1),
+    };
+
+    vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+  }
+}
+
+void OcclusionCuller::create_object_buffers(uint32_t capacity) {
+  _objectCapacity = std::max(capacity, MIN_CULL_CAPACITY);
+
+  _visibility = _engine->create_buffer(
+      sizeof(uint32_t) * _objectCapacity,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategory::Other);
+
+  const VkBufferUsageFlags commandUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  _earlyCommands =
+      _engine->create_buffer(sizeof(VkDrawIndirectCommand) * _objectCapacity,
+                             commandUsage, VMA_MEMORY_USAGE_GPU_ONLY,
+                             MemoryCategory::Other);
+  _lateCommands =
+      _engine->create_buffer(sizeof(VkDrawIndirectCommand) * _objectCapacity,
+                             commandUsage, VMA_MEMORY_USAGE_GPU_ONLY,
+                             MemoryCategory::Other);
+
+  // Nothing is considered visible at first, the late pass will pick up
+  // everything that passes the pyramid test
+  _engine->immediate_submit([&](VkCommandBuffer cmd) {
+    vkCmdFillBuffer(cmd, _visibility._buffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(cmd, _earlyCommands._buffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(cmd, _lateCommands._buffer, 0, VK_WHOLE_SIZE, 0);
+  });
+}
+
+void OcclusionCuller::destroy_object_buffers() {
+  _engine->destroy_buffer(_visibility);
+  _engine->destroy_buffer(_earlyCommands);
+  _engine->destroy_buffer(_lateCommands);
+}
+
+void OcclusionCuller::write_cull_descriptors() {
+  for (uint32_t i = 0; i < _cullSets.size(); i++) {
+    if (_objectInfos[i].buffer == VK_NULL_HANDLE) continue;
+    write_object_descriptor(i, _objectInfos[i]);
+  }
+}
@@ -0,0 +1,114 @@
+#ifndef C5D8E2A7_6B1F_4D93_A04E_2F7B9C3D6E18
+#define C5D8E2A7_6B1F_4D93_A04E_2F7B9C3D6E18
+
+#include "vk_types.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class VulkanEngine;
+
+struct CullPushConstants {
+  glm::mat4 view;
+  glm::vec4 frustum;  // normalized side planes, xy horizontal, zw vertical
+  float P00, P11;     // projection scale
+  float P22, P32;     // projection depth terms
+  float znear, zfar;
+  float pyramidWidth, pyramidHeight;
+  uint32_t objectCount;
+  uint32_t phase;  // 0 draws last frame's visible set, 1 tests the pyramid
+};
+
+struct DepthReducePushConstants {
+  glm::ivec2 srcSize;
+  glm::ivec2 dstSize;
+};
+
+// Two phase occlusion culling against a hierarchical depth pyramid.
+//
+// The early phase draws what was visible last frame (if it's still in the
+// frustum). The depth of that pass is reduced into a max-depth mip chain, and
+// the late phase tests every object's bounding sphere against it. Objects that
+// became visible are drawn by the late pass, and the visibility of every
+// object is stored for the next frame.
+class OcclusionCuller {
+ public:
+  void init(VulkanEngine& engine, VkImageView depthView, VkExtent2D extent);
+
+  void cleanup(void);
+
+  // Makes sure the per object buffers can hold count objects. Reallocating
+  // waits for the device to be idle, so buffers grow geometrically.
+  void reserve_objects(uint32_t count);
+
+  uint32_t object_capacity(void) const { return _objectCapacity; }
+
+  // Points the culling set of a frame at that frame's object buffer
+  void write_object_descriptor(uint32_t frameIndex,
+                               const VkDescriptorBufferInfo& objectInfo);
+
+  // Fills the early draw commands, to be called outside of a render pass.
+  // The render graph synchronizes the buffers and images with the passes
+  // around the culling, only barriers within a call are recorded here.
+  void cull_early(VkCommandBuffer cmd, uint32_t frameIndex,
+                  const CullPushConstants& cullData);
+
+  // Builds the pyramid from the depth of the early pass and fills the late
+  // draw commands. The depth image has to be in SHADER_READ_ONLY_OPTIMAL.
+  void cull_late(VkCommandBuffer cmd, uint32_t frameIndex,
+                 CullPushConstants cullData, VkExtent2D depthExtent);
+
+  VkBuffer early_commands(void) const { return _earlyCommands._buffer; }
+  VkBuffer late_commands(void) const { return _lateCommands._buffer; }
+  VkBuffer visibility_buffer(void) const { return _visibility._buffer; }
+
+  // The pyramid always stays in the general layout
+  VkImage pyramid_image(void) const { return _pyramid._image; }
+  VkImageView pyramid_view(void) const { return _pyramidView; }
+  uint32_t pyramid_levels(void) const {
+    return static_cast<uint32_t>(_pyramidMips.size());
+  }
+
+  VkExtent2D pyramid_extent(void) const { return _pyramidExtent; }
+
+ private:
+  void create_pyramid(VkImageView depthView, VkExtent2D extent);
+
+  void create_object_buffers(uint32_t capacity);
+
+  void destroy_object_buffers(void);
+
+  void write_cull_descriptors(void);
+
+  VulkanEngine* _engine{nullptr};
+
+  VkDescriptorPool _descriptorPool;
+
+  VkDescriptorSetLayout _cullSetLayout;
+  VkPipelineLayout _cullLayout;
+  VkPipeline _cullPipeline;
+
+  VkDescriptorSetLayout _reduceSetLayout;
+  VkPipelineLayout _reduceLayout;
+  VkPipeline _reducePipeline;
+
+  VkSampler _pyramidSampler;
+
+  AllocatedImage _pyramid;
+  VkImageView _pyramidView;
+  std::vector<VkImageView> _pyramidMips;
+  std::vector<VkDescriptorSet> _reduceSets;
+  VkExtent2D _pyramidExtent;
+
+  uint32_t _objectCapacity{0};
+  AllocatedBuffer _visibility;
+  AllocatedBuffer _earlyCommands;
+  AllocatedBuffer _lateCommands;
+
+  // One set per frame in flight since each frame has its own object buffer
+  std::vector<VkDescriptorSet> _cullSets;
+  std::vector<VkDescriptorBufferInfo> _objectInfos;
+};
+
+#endif /* C5D8E2A7_6B1F_4D93_A04E_2F7B9C3D6E18 */
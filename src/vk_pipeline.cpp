@@ -5,15 +5,25 @@
 
 VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass) {
   // Make viewport state
-  // At the moment we won't support multiple viewports or scissors
+  // At the moment we won't support multiple viewports or scissors. Both are
+  // dynamic since the render resolution changes from frame to frame
   VkPipelineViewportStateCreateInfo viewportState = {};
   viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
   viewportState.pNext = nullptr;
 
   viewportState.viewportCount = 1;
-  viewportState.pViewports = &_viewport;
+  viewportState.pViewports = nullptr;
   viewportState.scissorCount = 1;
-  viewportState.pScissors = &_scissor;
+  viewportState.pScissors = nullptr;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
+                                    VK_DYNAMIC_STATE_SCISSOR};
+
+  VkPipelineDynamicStateCreateInfo dynamicState = {};
+  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.pNext = nullptr;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates = dynamicStates;
 
   // Setup dummy color blending. We arent using transparent objects yet
   VkPipelineColorBlendStateCreateInfo colorBlending = {};
@@ -44,6 +54,7 @@ VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass) {
   pipelineInfo.subpass = 0;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
   pipelineInfo.pDepthStencilState = &_depthStencil;
+  pipelineInfo.pDynamicState = &dynamicState;
 
   VkPipeline newPipeline;
   if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
@@ -10,8 +10,6 @@ class PipelineBuilder {
   std::vector<VkPipelineShaderStageCreateInfo> _shaderStages;
   VkPipelineVertexInputStateCreateInfo _vertexInputInfo;
   VkPipelineInputAssemblyStateCreateInfo _inputAssembly;
-  VkViewport _viewport;
-  VkRect2D _scissor;
   VkPipelineRasterizationStateCreateInfo _rasterizer;
   VkPipelineColorBlendAttachmentState _colorBlendAttachment;
   VkPipelineMultisampleStateCreateInfo _multisampling;
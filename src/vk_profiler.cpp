@@ -0,0 +1,334 @@
+#include "vk_profiler.h"
+#include "vk_engine.h"
+
+#include <cstdio>
+#include <fstream>
+
+void Profiler::init(VulkanEngine& engine) {
+  _device = engine._device;
+  _epoch = Clock::now();
+  _slots.resize(engine.frame_count());
+
+  // The device only enables the feature when it was requested and supported
+  if (engine._pipelineStatistics) {
+    VkQueryPoolCreateInfo statsPoolInfo = {};
+    statsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    statsPoolInfo.pNext = nullptr;
+    statsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    statsPoolInfo.queryCount = engine.frame_count();
+    // Results come back in the order of the bits
+    statsPoolInfo.pipelineStatistics =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    VK_CHECK(vkCreateQueryPool(_device, &statsPoolInfo, nullptr, &_statsPool));
+  }
+
+  // Without timestamps only CPU zones are available
+  if (!engine._gpuProperties.limits.timestampComputeAndGraphics) {
+    std::cerr << "Timestamps are not supported, GPU zones are disabled"
+              << std::endl;
+    return;
+  }
+
+  _timestampPeriodNs = engine._gpuProperties.limits.timestampPeriod;
+
+  // Every slot owns MAX_GPU_ZONES pairs, the last query is for calibration
+  VkQueryPoolCreateInfo queryPoolInfo = {};
+  queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolInfo.pNext = nullptr;
+  queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolInfo.queryCount = engine.frame_count() * MAX_GPU_ZONES * 2 + 1;
+
+  VK_CHECK(vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &_queryPool));
+
+  calibrate(engine);
+}
+
+void Profiler::cleanup() {
+  if (_queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(_device, _queryPool, nullptr);
+    _queryPool = VK_NULL_HANDLE;
+  }
+  if (_statsPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(_device, _statsPool, nullptr);
+    _statsPool = VK_NULL_HANDLE;
+  }
+}
+
+void Profiler::calibrate(VulkanEngine& engine) {
+  const uint32_t query = engine.frame_count() * MAX_GPU_ZONES * 2;
+
+  // The timestamp is taken somewhere between submit and the fence wait
+  // returning, the middle of both is close enough for a trace
+  const Clock::time_point before = Clock::now();
+  engine.immediate_submit([&](VkCommandBuffer cmd) {
+    vkCmdResetQueryPool(cmd, _queryPool, query, 1);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool,
+                        query);
+  });
+  const Clock::time_point after = Clock::now();
+
+  VK_CHECK(vkGetQueryPoolResults(
+      _device, _queryPool, query, 1, sizeof(uint64_t), &_calibrationTicks,
+      sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+  _calibrationUs = (cpu_time_to_us(before) + cpu_time_to_us(after)) * 0.5;
+}
+
+double Profiler::gpu_ticks_to_us(uint64_t ticks) const {
+  const double deltaTicks =
+      static_cast<double>(static_cast<int64_t>(ticks - _calibrationTicks));
+  return _calibrationUs + deltaTicks * _timestampPeriodNs / 1000.0;
+}
+
+double Profiler::cpu_time_to_us(Clock::time_point time) const {
+  return std::chrono::duration<double, std::micro>(time - _epoch).count();
+}
+
+void Profiler::collect(uint32_t frameIndex) {
+  collect_pipeline_stats(frameIndex);
+
+  if (!gpu_supported()) return;
+
+  FrameSlot& slot = _slots[frameIndex];
+  if (slot.zones.empty()) return;
+
+  const uint32_t firstQuery = frameIndex * MAX_GPU_ZONES * 2;
+  const uint32_t queryCount = static_cast<uint32_t>(slot.zones.size()) * 2;
+
+  uint64_t timestamps[MAX_GPU_ZONES * 2];
+  VkResult result = vkGetQueryPoolResults(
+      _device, _queryPool, firstQuery, queryCount, sizeof(timestamps),
+      timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+  // The fence has signaled so the results should be there, never wait
+  if (result == VK_SUCCESS) {
+    const uint64_t frameBegin = timestamps[0];
+
+    _lastZones.clear();
+    for (size_t i = 0; i < slot.zones.size(); i++) {
+      const uint64_t begin = timestamps[i * 2];
+      const uint64_t end = timestamps[i * 2 + 1];
+
+      GpuZoneResult zone;
+      zone.name = slot.zones[i].name;
+      zone.beginMs = static_cast<double>(begin - frameBegin) *
+                     _timestampPeriodNs / 1000000.0;
+      zone.durationMs =
+          static_cast<double>(end - begin) * _timestampPeriodNs / 1000000.0;
+      _lastZones.push_back(zone);
+
+      TraceEvent event;
+      event.name = zone.name;
+      event.beginUs = gpu_ticks_to_us(begin);
+      event.durationUs = zone.durationMs * 1000.0;
+      event.thread = GPU_TRACE_THREAD;
+      add_event(event);
+    }
+  }
+
+  slot.zones.clear();
+}
+
+void Profiler::collect_pipeline_stats(uint32_t frameIndex) {
+  FrameSlot& slot = _slots[frameIndex];
+  if (!pipeline_stats_enabled() || !slot.pipelineStats) return;
+
+  uint64_t counters[4];
+  VkResult result = vkGetQueryPoolResults(
+      _device, _statsPool, frameIndex, 1, sizeof(counters), counters,
+      sizeof(counters), VK_QUERY_RESULT_64_BIT);
+
+  if (result == VK_SUCCESS) {
+    _lastPipelineStats.inputVertices = counters[0];
+    _lastPipelineStats.vertexInvocations = counters[1];
+    _lastPipelineStats.clippingPrimitives = counters[2];
+    _lastPipelineStats.fragmentInvocations = counters[3];
+    _lastPipelineStats.renderPixels = slot.renderPixels;
+    _hasPipelineStats = true;
+  }
+
+  slot.pipelineStats = false;
+}
+
+void Profiler::begin_frame(VkCommandBuffer cmd, uint32_t frameIndex) {
+  _currentSlotIndex = frameIndex;
+  _currentSlot = &_slots[frameIndex];
+  _currentSlot->zones.clear();
+  _currentSlot->pipelineStats = false;
+
+  if (pipeline_stats_enabled()) {
+    vkCmdResetQueryPool(cmd, _statsPool, frameIndex, 1);
+  }
+
+  if (!gpu_supported()) return;
+
+  vkCmdResetQueryPool(cmd, _queryPool, frameIndex * MAX_GPU_ZONES * 2,
+                      MAX_GPU_ZONES * 2);
+
+  begin_gpu_zone(cmd, "frame");
+}
+
+void Profiler::end_frame(VkCommandBuffer cmd) { end_gpu_zone(cmd, 0); }
+
+uint32_t Profiler::begin_gpu_zone(VkCommandBuffer cmd, const char* name) {
+  if (!gpu_supported() || _currentSlot == nullptr ||
+      _currentSlot->zones.size() >= MAX_GPU_ZONES) {
+    return UINT32_MAX;
+  }
+
+  const uint32_t zone = static_cast<uint32_t>(_currentSlot->zones.size());
+  const uint32_t query = _currentSlotIndex * MAX_GPU_ZONES * 2 + zone * 2;
+
+  _currentSlot->zones.push_back({name, query});
+
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool,
+                      query);
+
+  return zone;
+}
+
+void Profiler::end_gpu_zone(VkCommandBuffer cmd, uint32_t zone) {
+  if (zone == UINT32_MAX || _currentSlot == nullptr) return;
+
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool,
+                      _currentSlot->zones[zone].query + 1);
+}
+
+void Profiler::begin_pipeline_stats(VkCommandBuffer cmd,
+                                    VkExtent2D renderExtent) {
+  if (!pipeline_stats_enabled() || _currentSlot == nullptr) return;
+
+  _currentSlot->pipelineStats = true;
+  _currentSlot->renderPixels =
+      static_cast<uint64_t>(renderExtent.width) * renderExtent.height;
+
+  vkCmdBeginQuery(cmd, _statsPool, _currentSlotIndex, 0);
+}
+
+void Profiler::end_pipeline_stats(VkCommandBuffer cmd) {
+  if (_currentSlot == nullptr || !_currentSlot->pipelineStats) return;
+
+  vkCmdEndQuery(cmd, _statsPool, _currentSlotIndex);
+}
+
+void Profiler::add_cpu_zone(const char* name, Clock::time_point begin,
+                            Clock::time_point end) {
+  if (!_recording) return;
+
+  TraceEvent event;
+  event.name = name;
+  event.beginUs = cpu_time_to_us(begin);
+  event.durationUs = std::chrono::duration<double, std::micro>(end - begin)
+                         .count();
+
+  std::lock_guard<std::mutex> lock(_traceMutex);
+  event.thread = thread_index(std::this_thread::get_id());
+  if (_events.size() >= MAX_TRACE_EVENTS) {
+    _truncated = true;
+    return;
+  }
+  _events.push_back(event);
+}
+
+bool Profiler::last_gpu_frame_ms(float* outMs) const {
+  if (_lastZones.empty()) return false;
+  *outMs = static_cast<float>(_lastZones[0].durationMs);
+  return true;
+}
+
+bool Profiler::last_pipeline_stats(PipelineStatsResult* outStats) const {
+  if (!_hasPipelineStats) return false;
+  *outStats = _lastPipelineStats;
+  return true;
+}
+
+uint32_t Profiler::thread_index(std::thread::id id) {
+  auto it = _threads.find(id);
+  if (it != _threads.end()) return it->second;
+
+  const uint32_t index = static_cast<uint32_t>(_threads.size());
+  _threads[id] = index;
+  return index;
+}
+
+void Profiler::add_event(const TraceEvent& event) {
+  if (!_recording) return;
+
+  std::lock_guard<std::mutex> lock(_traceMutex);
+  if (_events.size() >= MAX_TRACE_EVENTS) {
+    _truncated = true;
+    return;
+  }
+  _events.push_back(event);
+}
+
+void Profiler::start_trace() {
+  std::lock_guard<std::mutex> lock(_traceMutex);
+  _events.clear();
+  _truncated = false;
+  _recording = true;
+}
+
+void Profiler::stop_trace() {
+  std::lock_guard<std::mutex> lock(_traceMutex);
+  _recording = false;
+}
+
+static void write_json_string(std::ofstream& file, const char* text) {
+  file << '"';
+  for (const char* c = text; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') file << '\\';
+    file << *c;
+  }
+  file << '"';
+}
+
+bool Profiler::write_trace(const std::string& filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open trace file " << filename << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_traceMutex);
+
+  if (_truncated) {
+    std::cerr << "Trace was truncated at " << MAX_TRACE_EVENTS << " events"
+              << std::endl;
+  }
+
+  char number[64];
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+  // Thread names first so the viewer labels the tracks
+  file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+       << GPU_TRACE_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+  for (const auto& thread : _threads) {
+    file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << thread.second << ",\"args\":{\"name\":\"";
+    if (thread.second == 0) {
+      file << "Main";
+    } else {
+      file << "Worker " << thread.second;
+    }
+    file << "\"}}";
+  }
+
+  for (const TraceEvent& event : _events) {
+    file << ",\n{\"name\":";
+    write_json_string(file, event.name);
+    snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f",
+             event.beginUs, event.durationUs);
+    file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << number
+         << "}";
+  }
+
+  file << "\n]}\n";
+
+  return file.good();
+}
@@ -0,0 +1,224 @@
+#ifndef B9D4E2F7_1C85_4A36_A7E0_6F3B8C2D5A19
+#define B9D4E2F7_1C85_4A36_A7E0_6F3B8C2D5A19
+
+#include "vk_types.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class VulkanEngine;
+
+// Timestamp pairs available to the GPU zones of one frame
+constexpr uint32_t MAX_GPU_ZONES = 32;
+
+// Stops recording the trace past this many events to bound memory
+constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+struct GpuZoneResult {
+  const char* name;
+  double beginMs;  // relative to the start of the frame
+  double durationMs;
+};
+
+// Pipeline statistics of the scene passes of one frame
+struct PipelineStatsResult {
+  uint64_t inputVertices{0};
+  uint64_t vertexInvocations{0};
+  uint64_t clippingPrimitives{0};
+  uint64_t fragmentInvocations{0};
+  // Pixels of the render target the counters were taken at
+  uint64_t renderPixels{0};
+
+  // Fragment shader invocations per pixel, includes helper invocations and
+  // fragments that fail the depth test after shading
+  double overdraw(void) const {
+    return renderPixels > 0 ? static_cast<double>(fragmentInvocations) /
+                                  static_cast<double>(renderPixels)
+                            : 0.0;
+  }
+
+  // Vertices fetched per vertex shader invocation. Non-indexed draws shade
+  // every vertex so this stays at 1 without an index buffer.
+  double vertex_reuse(void) const {
+    return vertexInvocations > 0 ? static_cast<double>(inputVertices) /
+                                       static_cast<double>(vertexInvocations)
+                                 : 0.0;
+  }
+
+  PipelineStatsResult& operator+=(const PipelineStatsResult& other) {
+    inputVertices += other.inputVertices;
+    vertexInvocations += other.vertexInvocations;
+    clippingPrimitives += other.clippingPrimitives;
+    fragmentInvocations += other.fragmentInvocations;
+    renderPixels += other.renderPixels;
+    return *this;
+  }
+};
+
+// GPU and CPU profiler. GPU zones are timestamp pairs written into a query
+// range owned by the frame slot; they are read back without waiting once the
+// slot's fence has signaled, so results lag by the number of frames in
+// flight. CPU zones are timed with steady_clock from any thread. While a
+// trace is recording, both are collected as events for the Chrome trace /
+// Perfetto JSON format.
+//
+// Pipeline statistics are optional, they need the pipelineStatisticsQuery
+// device feature. One query per slot brackets all scene passes and is read
+// back the same way as the timestamps.
+//
+// Zone names must outlive the profiler, string literals are expected.
+class Profiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void init(VulkanEngine& engine);
+
+  void cleanup(void);
+
+  bool gpu_supported(void) const { return _queryPool != VK_NULL_HANDLE; }
+
+  bool pipeline_stats_enabled(void) const {
+    return _statsPool != VK_NULL_HANDLE;
+  }
+
+  // Reads back the zones the slot recorded last time. Only call this after
+  // the slot's fence has signaled.
+  void collect(uint32_t frameIndex);
+
+  // Resets the queries of the slot and opens the frame zone. Has to be
+  // recorded outside of a render pass.
+  void begin_frame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+  void end_frame(VkCommandBuffer cmd);
+
+  // Returns UINT32_MAX when out of zones, end_gpu_zone ignores that value
+  uint32_t begin_gpu_zone(VkCommandBuffer cmd, const char* name);
+
+  void end_gpu_zone(VkCommandBuffer cmd, uint32_t zone);
+
+  // Brackets the scene passes of the frame. Has to be recorded outside of a
+  // render pass and at most once per frame.
+  void begin_pipeline_stats(VkCommandBuffer cmd, VkExtent2D renderExtent);
+
+  void end_pipeline_stats(VkCommandBuffer cmd);
+
+  void add_cpu_zone(const char* name, Clock::time_point begin,
+                    Clock::time_point end);
+
+  // Results of the most recently collected frame, the frame zone comes first
+  const std::vector<GpuZoneResult>& last_gpu_zones(void) const {
+    return _lastZones;
+  }
+
+  // Returns false until a frame has been collected
+  bool last_gpu_frame_ms(float* outMs) const;
+
+  // Returns false until pipeline statistics have been collected
+  bool last_pipeline_stats(PipelineStatsResult* outStats) const;
+
+  void start_trace(void);
+
+  void stop_trace(void);
+
+  bool write_trace(const std::string& filename) const;
+
+ private:
+  struct ZoneRecord {
+    const char* name;
+    uint32_t query;
+  };
+
+  struct FrameSlot {
+    // Zone 0 is the whole frame
+    std::vector<ZoneRecord> zones;
+    // Set when the pipeline statistics query was recorded
+    bool pipelineStats{false};
+    uint64_t renderPixels{0};
+  };
+
+  struct TraceEvent {
+    const char* name;
+    double beginUs;
+    double durationUs;
+    uint32_t thread;
+  };
+
+  // Thread id used in the trace for GPU events
+  static constexpr uint32_t GPU_TRACE_THREAD = 1000;
+
+  // Finds the offset between GPU ticks and the CPU clock
+  void calibrate(VulkanEngine& engine);
+
+  double gpu_ticks_to_us(uint64_t ticks) const;
+
+  void collect_pipeline_stats(uint32_t frameIndex);
+
+  double cpu_time_to_us(Clock::time_point time) const;
+
+  uint32_t thread_index(std::thread::id id);
+
+  void add_event(const TraceEvent& event);
+
+  VkDevice _device{VK_NULL_HANDLE};
+  VkQueryPool _queryPool{VK_NULL_HANDLE};
+  double _timestampPeriodNs{1.0};
+  // One pipeline statistics query per slot, null when disabled
+  VkQueryPool _statsPool{VK_NULL_HANDLE};
+
+  std::vector<FrameSlot> _slots;
+  FrameSlot* _currentSlot{nullptr};
+  uint32_t _currentSlotIndex{0};
+
+  std::vector<GpuZoneResult> _lastZones;
+  PipelineStatsResult _lastPipelineStats;
+  bool _hasPipelineStats{false};
+
+  Clock::time_point _epoch;
+  // GPU tick and CPU time (in trace microseconds) taken at the same moment
+  uint64_t _calibrationTicks{0};
+  double _calibrationUs{0.0};
+
+  mutable std::mutex _traceMutex;
+  bool _recording{false};
+  bool _truncated{false};
+  std::vector<TraceEvent> _events;
+  std::unordered_map<std::thread::id, uint32_t> _threads;
+};
+
+// Times the enclosing scope as a CPU zone
+class ScopedCpuZone {
+ public:
+  ScopedCpuZone(Profiler& profiler, const char* name)
+      : _profiler(profiler), _name(name), _begin(Profiler::Clock::now()) {}
+
+  ~ScopedCpuZone() {
+    _profiler.add_cpu_zone(_name, _begin, Profiler::Clock::now());
+  }
+
+ private:
+  Profiler& _profiler;
+  const char* _name;
+  Profiler::Clock::time_point _begin;
+};
+
+// Brackets the commands recorded in the enclosing scope with timestamps
+class ScopedGpuZone {
+ public:
+  ScopedGpuZone(Profiler& profiler, VkCommandBuffer cmd, const char* name)
+      : _profiler(profiler), _cmd(cmd) {
+    _zone = _profiler.begin_gpu_zone(cmd, name);
+  }
+
+  ~ScopedGpuZone() { _profiler.end_gpu_zone(_cmd, _zone); }
+
+ private:
+  Profiler& _profiler;
+  VkCommandBuffer _cmd;
+  uint32_t _zone;
+};
+
+#endif /* B9D4E2F7_1C85_4A36_A7E0_6F3B8C2D5A19 */
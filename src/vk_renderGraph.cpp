@@ -0,0 +1,512 @@
+#include "vk_renderGraph.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Access bits that make memory dirty, only these need to be made available
+constexpr VkAccessFlags WRITE_ACCESS =
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT |
+    VK_ACCESS_MEMORY_WRITE_BIT;
+
+struct UsageInfo {
+  VkPipelineStageFlags stages;
+  VkAccessFlags access;
+  VkImageLayout layout;
+  VkImageUsageFlags imageUsage;
+};
+
+static UsageInfo usage_info(RGUsage usage) {
+  switch (usage) {
+    case RGUsage::ColorAttachment:
+      return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+              VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                  VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+    case RGUsage::DepthAttachment:
+      return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                  VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+              VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+    case RGUsage::SampledFragment:
+      return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              VK_IMAGE_USAGE_SAMPLED_BIT};
+    case RGUsage::SampledCompute:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              VK_IMAGE_USAGE_SAMPLED_BIT};
+    case RGUsage::StorageRead:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+              VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+    case RGUsage::StorageWrite:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+              VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+    case RGUsage::StorageReadWrite:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+              VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+    case RGUsage::StorageReadFragment:
+      return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+              VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+    case RGUsage::IndirectRead:
+      return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+              VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+              0};
+    case RGUsage::TransferSrc:
+      return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+    case RGUsage::TransferDst:
+      return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+    case RGUsage::Present:
+      return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+              VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0};
+    default:
+      return {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+              0};
+  }
+}
+
+static VkImageAspectFlags format_aspect(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+RGPassBuilder& RGPassBuilder::read(RGResource resource, RGUsage usage) {
+  _graph._passes[_pass].accesses.push_back({resource, usage, false, true});
+  return *this;
+}
+
+RGPassBuilder& RGPassBuilder::write(RGResource resource, RGUsage usage) {
+  const bool reads = usage == RGUsage::StorageReadWrite;
+  _graph._passes[_pass].accesses.push_back({resource, usage, true, reads});
+  return *this;
+}
+
+RGPassBuilder& RGPassBuilder::color_attachment(RGResource resource) {
+  RenderGraph::Pass& pass = _graph._passes[_pass];
+  pass.colorAttachments.push_back(resource);
+  pass.accesses.push_back({resource, RGUsage::ColorAttachment, true, true});
+  return *this;
+}
+
+RGPassBuilder& RGPassBuilder::depth_attachment(RGResource resource) {
+  RenderGraph::Pass& pass = _graph._passes[_pass];
+  pass.depthAttachment = resource;
+  pass.accesses.push_back({resource, RGUsage::DepthAttachment, true, true});
+  return *this;
+}
+
+RGPassBuilder& RGPassBuilder::clear(RGResource resource,
+                                    const VkClearValue& value) {
+  RenderGraph::Pass& pass = _graph._passes[_pass];
+  pass.clears.push_back({resource, value});
+
+  // A cleared attachment doesn't depend on what was there before
+  for (RenderGraph::Access& access : pass.accesses) {
+    if (access.resource == resource &&
+        (access.usage == RGUsage::ColorAttachment ||
+         access.usage == RGUsage::DepthAttachment)) {
+      access.reads = false;
+    }
+  }
+  return *this;
+}
+
+RGPassBuilder& RGPassBuilder::side_effect() {
+  _graph._passes[_pass].sideEffect = true;
+  return *this;
+}
+
+RGPassBuilder& RGPassBuilder::execute(
+    std::function<void(VkCommandBuffer cmd)>&& function) {
+  _graph._passes[_pass].function = std::move(function);
+  return *this;
+}
+
+RGResource RenderGraph::import_image(const char* name, VkImage image,
+                                     VkImageView view,
+                                     const RGImageDesc& desc,
+                                     VkImageLayout layout, bool preserve) {
+  Resource resource;
+  resource.name = name;
+  resource.isImage = true;
+  resource.imported = true;
+  resource.preserve = preserve;
+  resource.desc = desc;
+  resource.aspect = format_aspect(desc.format);
+  resource.image = image;
+  resource.view = view;
+  resource.layout = layout;
+  _resources.push_back(resource);
+  return static_cast<RGResource>(_resources.size() - 1);
+}
+
+RGResource RenderGraph::import_buffer(const char* name, VkBuffer buffer) {
+  // Buffers have no layout, their contents always survive
+  Resource resource;
+  resource.name = name;
+  resource.imported = true;
+  resource.preserve = true;
+  resource.buffer = buffer;
+  _resources.push_back(resource);
+  return static_cast<RGResource>(_resources.size() - 1);
+}
+
+RGResource RenderGraph::create_image(const char* name,
+                                     const RGImageDesc& desc) {
+  Resource resource;
+  resource.name = name;
+  resource.isImage = true;
+  resource.desc = desc;
+  resource.aspect = format_aspect(desc.format);
+  _resources.push_back(resource);
+  return static_cast<RGResource>(_resources.size() - 1);
+}
+
+void RenderGraph::set_image(RGResource resource, VkImage image,
+                            VkImageView view) {
+  _resources[resource].image = image;
+  _resources[resource].view = view;
+}
+
+void RenderGraph::set_buffer(RGResource resource, VkBuffer buffer) {
+  _resources[resource].buffer = buffer;
+}
+
+VkImage RenderGraph::image(RGResource resource) const {
+  return _resources[resource].image;
+}
+
+VkImageView RenderGraph::image_view(RGResource resource) const {
+  return _resources[resource].view;
+}
+
+VkBuffer RenderGraph::buffer(RGResource resource) const {
+  return _resources[resource].buffer;
+}
+
+void RenderGraph::set_output(RGResource resource, RGUsage finalUsage) {
+  _resources[resource].output = true;
+  _resources[resource].finalUsage = finalUsage;
+}
+
+RGPassBuilder RenderGraph::add_pass(const char* name, RGPassType type) {
+  Pass pass;
+  pass.name = name;
+  pass.type = type;
+  _passes.push_back(std::move(pass));
+  return RGPassBuilder(*this, static_cast<uint32_t>(_passes.size() - 1));
+}
+
+std::vector<std::vector<RenderGraph::Use>> RenderGraph::plan(
+    const std::function<VkMemoryRequirements(RGResource)>& memory) {
+  cull_passes();
+
+  std::vector<std::vector<Use>> uses = collect_uses();
+
+  std::vector<VkMemoryRequirements> requirements(_resources.size());
+  for (RGResource i = 0; i < _resources.size(); i++) {
+    if (transient(_resources[i])) requirements[i] = memory(i);
+  }
+  assign_memory_slots(requirements);
+
+  build_barriers(uses);
+  return uses;
+}
+
+void RenderGraph::compile_offline(
+    const std::function<VkMemoryRequirements(const RGImageDesc&)>& memory) {
+  if (_compiled) {
+    std::cerr << "Render graph is already compiled, reset it first"
+              << std::endl;
+    return;
+  }
+
+  plan([&](RGResource resource) { return memory(_resources[resource].desc); });
+  _compiled = true;
+}
+
+uint32_t RenderGraph::memory_slot(RGResource resource) const {
+  return _resources[resource].slot;
+}
+
+VkDeviceSize RenderGraph::memory_slot_size(uint32_t slot) const {
+  return _slots[slot].requirements.size;
+}
+
+void RenderGraph::cull_passes() {
+  // Walk back from the outputs. A pass survives if a later pass or the
+  // outside reads something it writes, and then needs what it reads itself.
+  std::vector<bool> needed(_resources.size());
+  for (size_t i = 0; i < _resources.size(); i++) {
+    needed[i] = _resources[i].output;
+  }
+
+  for (size_t i = _passes.size(); i-- > 0;) {
+    Pass& pass = _passes[i];
+
+    bool alive = pass.sideEffect;
+    for (const Access& access : pass.accesses) {
+      if (access.write && needed[access.resource]) alive = true;
+    }
+
+    pass.culled = !alive;
+    if (!alive) continue;
+
+    for (const Access& access : pass.accesses) {
+      if (access.reads) needed[access.resource] = true;
+    }
+  }
+
+  _order.clear();
+  for (uint32_t i = 0; i < _passes.size(); i++) {
+    if (!_passes[i].culled) _order.push_back(i);
+  }
+}
+
+std::vector<std::vector<RenderGraph::Use>> RenderGraph::collect_uses() {
+  std::vector<std::vector<Use>> uses(_resources.size());
+
+  for (uint32_t i = 0; i < _order.size(); i++) {
+    const Pass& pass = _passes[_order[i]];
+
+    for (const Access& access : pass.accesses) {
+      Resource& resource = _resources[access.resource];
+      const UsageInfo info = usage_info(access.usage);
+
+      SyncState state;
+      state.stages = info.stages;
+      state.access = info.access;
+      state.layout =
+          resource.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+      state.write = access.write;
+
+      resource.imageUsage |= info.imageUsage;
+
+      // Several usages of a resource in one pass need a single layout
+      std::vector<Use>& list = uses[access.resource];
+      if (!list.empty() && list.back().pass == i) {
+        SyncState& merged = list.back().state;
+        if (merged.layout != state.layout) {
+          std::cerr << "Pass " << pass.name << " uses " << resource.name
+                    << " in two layouts" << std::endl;
+        }
+        merged.stages |= state.stages;
+        merged.access |= state.access;
+        merged.write = merged.write || state.write;
+      } else {
+        list.push_back({i, state});
+      }
+
+      resource.firstPass = std::min(resource.firstPass, i);
+      resource.lastPass = std::max(resource.lastPass, i);
+    }
+  }
+
+  for (size_t i = 0; i < _resources.size(); i++) {
+    Resource& resource = _resources[i];
+    if (uses[i].empty()) continue;
+
+    resource.lastState = uses[i].back().state;
+
+    if (!resource.imported && !uses[i].front().state.write) {
+      std::cerr << "Transient image " << resource.name
+                << " is read before it is written" << std::endl;
+    }
+  }
+
+  return uses;
+}
+
+void RenderGraph::assign_memory_slots(
+    const std::vector<VkMemoryRequirements>& requirements) {
+  std::vector<RGResource> transients;
+  for (RGResource i = 0; i < _resources.size(); i++) {
+    if (transient(_resources[i])) transients.push_back(i);
+  }
+
+  // Largest first, so smaller images fill the slots the large ones opened
+  std::stable_sort(transients.begin(), transients.end(),
+                   [&](RGResource a, RGResource b) {
+                     return requirements[a].size > requirements[b].size;
+                   });
+
+  for (RGResource index : transients) {
+    Resource& resource = _resources[index];
+    const VkMemoryRequirements& required = requirements[index];
+
+    for (uint32_t slotIndex = 0; slotIndex < _slots.size(); slotIndex++) {
+      MemorySlot& slot = _slots[slotIndex];
+      if ((slot.requirements.memoryTypeBits & required.memoryTypeBits) == 0) {
+        continue;
+      }
+
+      bool overlaps = false;
+      for (RGResource other : slot.resources) {
+        if (_resources[other].lastPass >= resource.firstPass &&
+            resource.lastPass >= _resources[other].firstPass) {
+          overlaps = true;
+        }
+      }
+      if (overlaps) continue;
+
+      slot.requirements.size = std::max(slot.requirements.size, required.size);
+      slot.requirements.alignment =
+          std::max(slot.requirements.alignment, required.alignment);
+      slot.requirements.memoryTypeBits &= required.memoryTypeBits;
+      slot.resources.push_back(index);
+      resource.slot = slotIndex;
+      break;
+    }
+
+    if (resource.slot == UINT32_MAX) {
+      MemorySlot slot;
+      slot.requirements = required;
+      slot.resources.push_back(index);
+      resource.slot = static_cast<uint32_t>(_slots.size());
+      _slots.push_back(slot);
+    }
+  }
+}
+
+RenderGraph::SyncState RenderGraph::initial_state(
+    RGResource index, const std::vector<std::vector<Use>>& uses) const {
+  const Resource& resource = _resources[index];
+
+  // Whatever touched the memory last: the resource itself in the previous
+  // frame, or for aliased images the image before it in the same slot
+  RGResource previous = index;
+  if (resource.slot != UINT32_MAX) {
+    RGResource before = RG_NO_RESOURCE;
+    RGResource last = index;
+    for (RGResource other : _slots[resource.slot].resources) {
+      const uint32_t otherLast = _resources[other].lastPass;
+      if (otherLast < resource.firstPass &&
+          (before == RG_NO_RESOURCE ||
+           otherLast > _resources[before].lastPass)) {
+        before = other;
+      }
+      if (otherLast > _resources[last].lastPass) last = other;
+    }
+    previous = before != RG_NO_RESOURCE ? before : last;
+  }
+
+  const SyncState& lastState = _resources[previous].lastState;
+
+  SyncState state;
+  state.stages = lastState.stages;
+  state.access = lastState.write ? lastState.access & WRITE_ACCESS : 0;
+  state.write = lastState.write;
+  // The real layout of preserved images is only known when recording
+  state.layout = resource.preserve ? uses[index].back().state.layout
+                                   : VK_IMAGE_LAYOUT_UNDEFINED;
+  return state;
+}
+
+void RenderGraph::build_barriers(const std::vector<std::vector<Use>>& uses) {
+  for (RGResource index = 0; index < _resources.size(); index++) {
+    const std::vector<Use>& list = uses[index];
+    if (list.empty()) continue;
+
+    const Resource& resource = _resources[index];
+    const bool preservedImage = resource.isImage && resource.preserve;
+
+    const SyncState initial = initial_state(index, uses);
+    VkPipelineStageFlags stages =
+        initial.stages != 0 ? initial.stages
+                            : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags pendingWrites = initial.access;
+    VkImageLayout layout = initial.layout;
+
+    size_t i = 0;
+    while (i < list.size()) {
+      const Use& use = list[i];
+
+      Barrier barrier;
+      barrier.resource = index;
+      barrier.srcStages = stages;
+      barrier.srcAccess = pendingWrites;
+      barrier.oldLayout = layout;
+      barrier.newLayout = use.state.layout;
+      barrier.currentLayout = preservedImage && i == 0;
+
+      size_t next = i + 1;
+      if (use.state.write) {
+        // Writes always wait, for earlier writes and for earlier reads
+        barrier.dstStages = use.state.stages;
+        barrier.dstAccess = use.state.access;
+        stages = use.state.stages;
+        pendingWrites = use.state.access & WRITE_ACCESS;
+      } else {
+        // Reads in the same layout up to the next write share one barrier
+        VkPipelineStageFlags readStages = use.state.stages;
+        VkAccessFlags readAccess = use.state.access;
+        while (next < list.size() && !list[next].state.write &&
+               list[next].state.layout == use.state.layout) {
+          readStages |= list[next].state.stages;
+          readAccess |= list[next].state.access;
+          next++;
+        }
+
+        barrier.dstStages = readStages;
+        barrier.dstAccess = readAccess;
+
+        // Reads after reads in the same layout don't need to wait, but the
+        // next write has to wait for all of them
+        if (pendingWrites == 0 && layout == use.state.layout &&
+            !barrier.currentLayout) {
+          stages |= readStages;
+          i = next;
+          continue;
+        }
+
+        stages = readStages;
+        pendingWrites = 0;
+      }
+
+      layout = use.state.layout;
+      _passes[_order[use.pass]].barriers.push_back(barrier);
+      i = next;
+    }
+
+    if (resource.output && resource.finalUsage != RGUsage::None) {
+      const UsageInfo info = usage_info(resource.finalUsage);
+
+      Barrier barrier;
+      barrier.resource = index;
+      barrier.srcStages = stages;
+      barrier.srcAccess = pendingWrites;
+      barrier.dstStages = info.stages;
+      barrier.dstAccess = info.access;
+      barrier.oldLayout = layout;
+      barrier.newLayout = resource.isImage ? info.layout : layout;
+      barrier.currentLayout = false;
+      _finalBarriers.push_back(barrier);
+    }
+  }
+}
+
+VkImageLayout RenderGraph::end_layout(const Resource& resource) const {
+  if (resource.output && resource.finalUsage != RGUsage::None) {
+    return usage_info(resource.finalUsage).layout;
+  }
+  return resource.lastState.layout;
+}
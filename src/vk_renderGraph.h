@@ -0,0 +1,290 @@
+#ifndef F7A3C9E1_2D84_4B6F_9E05_C8B1D4A6E273
+#define F7A3C9E1_2D84_4B6F_9E05_C8B1D4A6E273
+
+#include "vk_types.h"
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+class VulkanEngine;
+class Profiler;
+
+// Index of a resource in its graph, valid until the graph is reset
+using RGResource = uint32_t;
+constexpr RGResource RG_NO_RESOURCE = UINT32_MAX;
+
+// How a pass uses a resource. Every usage stands for fixed pipeline stages,
+// access flags and, for images, a layout.
+enum class RGUsage {
+  None,
+  ColorAttachment,
+  DepthAttachment,
+  SampledFragment,
+  SampledCompute,
+  StorageRead,
+  StorageWrite,
+  StorageReadWrite,
+  // Storage buffers read by fragment shaders
+  StorageReadFragment,
+  IndirectRead,
+  TransferSrc,
+  TransferDst,
+  Present
+};
+
+enum class RGPassType { Graphics, Compute, Transfer };
+
+struct RGImageDesc {
+  VkFormat format;
+  VkExtent2D extent;
+  uint32_t mipLevels{1};
+};
+
+class RenderGraph;
+
+// Declares what a pass reads and writes. Returned by RenderGraph::add_pass.
+class RGPassBuilder {
+ public:
+  RGPassBuilder(RenderGraph& graph, uint32_t pass)
+      : _graph(graph), _pass(pass) {}
+
+  RGPassBuilder& read(RGResource resource, RGUsage usage);
+
+  RGPassBuilder& write(RGResource resource, RGUsage usage);
+
+  // Attachments of a graphics pass, colors in the order of the pipeline's
+  // render pass. Their contents are loaded unless they are cleared.
+  RGPassBuilder& color_attachment(RGResource resource);
+
+  RGPassBuilder& depth_attachment(RGResource resource);
+
+  RGPassBuilder& clear(RGResource resource, const VkClearValue& value);
+
+  // Keeps the pass even if nothing it writes is used
+  RGPassBuilder& side_effect(void);
+
+  RGPassBuilder& execute(std::function<void(VkCommandBuffer cmd)>&& function);
+
+ private:
+  RenderGraph& _graph;
+  uint32_t _pass;
+};
+
+// Frame graph of passes that declare the resources they use. compile() culls
+// the passes that contribute nothing to an output, derives the barriers
+// between passes, creates the render passes and framebuffers of graphics
+// passes and allocates transient images, sharing memory between transient
+// images whose lifetimes don't overlap.
+//
+// A compiled graph is executed every frame. Execution wraps around, so the
+// first use of a resource in a frame also waits for its last use in the
+// previous frame. Imported resources can change between frames with
+// set_image and set_buffer, except for attachments whose framebuffers are
+// built by compile.
+//
+// Everything that creates or records Vulkan objects lives in
+// vk_renderGraphDevice.cpp, the rest of the graph runs without a device.
+class RenderGraph {
+ public:
+  void init(VulkanEngine& engine);
+
+  // Frees everything compile created and forgets all passes and resources.
+  // The device must be done executing the graph.
+  void reset(void);
+
+  // Images without preserve start every frame in an undefined layout. The
+  // graph keeps track of the layout of preserved images between frames.
+  RGResource import_image(const char* name, VkImage image, VkImageView view,
+                          const RGImageDesc& desc, VkImageLayout layout,
+                          bool preserve);
+
+  RGResource import_buffer(const char* name, VkBuffer buffer);
+
+  // Allocated by compile, the contents don't survive the frame
+  RGResource create_image(const char* name, const RGImageDesc& desc);
+
+  void set_image(RGResource resource, VkImage image, VkImageView view);
+
+  void set_buffer(RGResource resource, VkBuffer buffer);
+
+  VkImage image(RGResource resource) const;
+
+  VkImageView image_view(RGResource resource) const;
+
+  VkBuffer buffer(RGResource resource) const;
+
+  // The resource is used after the graph, passes contributing to it are
+  // kept. A final usage other than None adds a transition at the end.
+  void set_output(RGResource resource, RGUsage finalUsage = RGUsage::None);
+
+  RGPassBuilder add_pass(const char* name, RGPassType type);
+
+  void compile(void);
+
+  // Culls passes, derives barriers and assigns memory slots like compile,
+  // with memory giving the requirements of a transient image, but creates
+  // no Vulkan objects. For inspecting a graph without a device, the graph
+  // can't be executed.
+  void compile_offline(
+      const std::function<VkMemoryRequirements(const RGImageDesc& desc)>&
+          memory);
+
+  // Memory slot a compiled transient image was assigned, UINT32_MAX for
+  // imported and unused resources
+  uint32_t memory_slot(RGResource resource) const;
+
+  // Bytes shared by the images of a slot
+  VkDeviceSize memory_slot_size(uint32_t slot) const;
+
+  // Records the passes with their barriers. Graphics passes render to
+  // renderArea, clamped to their attachments. Every pass gets a GPU zone
+  // when a profiler is given.
+  void execute(VkCommandBuffer cmd, VkExtent2D renderArea,
+               Profiler* profiler);
+
+  void print(void) const;
+
+ private:
+  friend class RGPassBuilder;
+
+  // Stages, accesses and layout of a usage, or of all usages of a resource
+  // merged within one pass
+  struct SyncState {
+    VkPipelineStageFlags stages{0};
+    VkAccessFlags access{0};
+    VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+    bool write{false};
+  };
+
+  struct Resource {
+    const char* name;
+    bool isImage{false};
+    bool imported{false};
+    bool preserve{false};
+    bool output{false};
+    RGUsage finalUsage{RGUsage::None};
+
+    RGImageDesc desc{};
+    VkImageAspectFlags aspect{0};
+    VkImageUsageFlags imageUsage{0};
+    VkImage image{VK_NULL_HANDLE};
+    VkImageView view{VK_NULL_HANDLE};
+    VkBuffer buffer{VK_NULL_HANDLE};
+    // Layout the image is in between executions of the graph
+    VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+
+    // Compiled: index into _order of the first and last pass using it, and
+    // the memory slot of transient images
+    uint32_t firstPass{UINT32_MAX};
+    uint32_t lastPass{0};
+    uint32_t slot{UINT32_MAX};
+    SyncState lastState;
+  };
+
+  struct Access {
+    RGResource resource;
+    RGUsage usage;
+    bool write;
+    // Needs the previous contents, reads and attachments that load
+    bool reads;
+  };
+
+  struct Barrier {
+    RGResource resource;
+    VkPipelineStageFlags srcStages;
+    VkAccessFlags srcAccess;
+    VkPipelineStageFlags dstStages;
+    VkAccessFlags dstAccess;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    // The old layout is the one the image was left in by the last execution
+    bool currentLayout;
+  };
+
+  struct Pass {
+    const char* name;
+    RGPassType type;
+    std::vector<Access> accesses;
+    std::vector<RGResource> colorAttachments;
+    RGResource depthAttachment{RG_NO_RESOURCE};
+    std::vector<std::pair<RGResource, VkClearValue>> clears;
+    bool sideEffect{false};
+    std::function<void(VkCommandBuffer cmd)> function;
+
+    // Compiled
+    bool culled{false};
+    std::vector<Barrier> barriers;
+    VkRenderPass renderPass{VK_NULL_HANDLE};
+    VkFramebuffer framebuffer{VK_NULL_HANDLE};
+    VkExtent2D extent{};
+    std::vector<VkClearValue> clearValues;
+  };
+
+  // Memory shared by transient images with disjoint lifetimes
+  struct MemorySlot {
+    VkMemoryRequirements requirements;
+    std::vector<RGResource> resources;
+    VmaAllocation allocation{VK_NULL_HANDLE};
+  };
+
+  // One resource's merged state in one pass
+  struct Use {
+    uint32_t pass;
+    SyncState state;
+  };
+
+  // Images the graph allocates itself that a surviving pass uses
+  static bool transient(const Resource& resource) {
+    return !resource.imported && resource.isImage &&
+           resource.firstPass != UINT32_MAX;
+  }
+
+  // The device independent part of compiling, memory returns the
+  // requirements of a transient image
+  std::vector<std::vector<Use>> plan(
+      const std::function<VkMemoryRequirements(RGResource resource)>& memory);
+
+  void cull_passes(void);
+
+  std::vector<std::vector<Use>> collect_uses(void);
+
+  void assign_memory_slots(
+      const std::vector<VkMemoryRequirements>& requirements);
+
+  void build_barriers(const std::vector<std::vector<Use>>& uses);
+
+  SyncState initial_state(RGResource resource,
+                          const std::vector<std::vector<Use>>& uses) const;
+
+  VkMemoryRequirements create_transient_image(RGResource resource);
+
+  void allocate_transient_memory(void);
+
+  void create_render_pass(uint32_t orderIndex,
+                          const std::vector<std::vector<Use>>& uses);
+
+  void record_barriers(VkCommandBuffer cmd,
+                       const std::vector<Barrier>& barriers);
+
+  // Layout a preserved image is left in at the end of the graph
+  VkImageLayout end_layout(const Resource& resource) const;
+
+  VulkanEngine* _engine{nullptr};
+
+  std::vector<Resource> _resources;
+  std::vector<Pass> _passes;
+  std::vector<MemorySlot> _slots;
+  bool _compiled{false};
+
+  // Passes that survived culling, in submission order
+  std::vector<uint32_t> _order;
+  std::vector<Barrier> _finalBarriers;
+
+  // Scratch space of record_barriers
+  std::vector<VkImageMemoryBarrier> _imageBarriers;
+  std::vector<VkBufferMemoryBarrier> _bufferBarriers;
+};
+
+#endif /* F7A3C9E1_2D84_4B6F_9E05_C8B1D4A6E273 */
@@ -0,0 +1,340 @@
+#include "vk_renderGraph.h"
+#include "vk_engine.h"
+#include "vk_initializers.h"
+#include "vk_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+void RenderGraph::init(VulkanEngine& engine) { _engine = &engine; }
+
+void RenderGraph::reset() {
+  if (_engine != nullptr) {
+    VkDevice device = _engine->_device;
+
+    for (Pass& pass : _passes) {
+      if (pass.framebuffer != VK_NULL_HANDLE) {
+        vkDestroyFramebuffer(device, pass.framebuffer, nullptr);
+      }
+      if (pass.renderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(device, pass.renderPass, nullptr);
+      }
+    }
+
+    for (Resource& resource : _resources) {
+      if (resource.imported || !resource.isImage) continue;
+      if (resource.view != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, resource.view, nullptr);
+      }
+      if (resource.image != VK_NULL_HANDLE) {
+        vkDestroyImage(device, resource.image, nullptr);
+      }
+    }
+
+    for (MemorySlot& slot : _slots) {
+      _engine->_memoryTracker.untrack(slot.allocation);
+      vmaFreeMemory(_engine->_allocator, slot.allocation);
+    }
+  }
+
+  _resources.clear();
+  _passes.clear();
+  _slots.clear();
+  _order.clear();
+  _finalBarriers.clear();
+  _compiled = false;
+}
+
+void RenderGraph::compile() {
+  if (_compiled) {
+    std::cerr << "Render graph is already compiled, reset it first"
+              << std::endl;
+    return;
+  }
+
+  // The images have to exist before their memory needs are known
+  const std::vector<std::vector<Use>> uses = plan(
+      [this](RGResource resource) { return create_transient_image(resource); });
+
+  allocate_transient_memory();
+
+  for (uint32_t i = 0; i < _order.size(); i++) {
+    if (_passes[_order[i]].type == RGPassType::Graphics) {
+      create_render_pass(i, uses);
+    }
+  }
+
+  _compiled = true;
+}
+
+VkMemoryRequirements RenderGraph::create_transient_image(RGResource index) {
+  Resource& resource = _resources[index];
+
+  VkImageCreateInfo imageInfo = vkinit::image_create_info(
+      resource.desc.format, resource.imageUsage,
+      VkExtent3D{resource.desc.extent.width, resource.desc.extent.height, 1});
+  imageInfo.mipLevels = resource.desc.mipLevels;
+
+  VK_CHECK(
+      vkCreateImage(_engine->_device, &imageInfo, nullptr, &resource.image));
+
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(_engine->_device, resource.image,
+                               &requirements);
+  return requirements;
+}
+
+void RenderGraph::allocate_transient_memory() {
+  VkDevice device = _engine->_device;
+
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  for (MemorySlot& slot : _slots) {
+    VK_CHECK(vmaAllocateMemory(_engine->_allocator, &slot.requirements,
+                               &allocInfo, &slot.allocation, nullptr));
+    _engine->_memoryTracker.track(slot.allocation,
+                                  MemoryCategory::Attachment);
+
+    for (RGResource index : slot.resources) {
+      Resource& resource = _resources[index];
+
+      VK_CHECK(vmaBindImageMemory(_engine->_allocator, slot.allocation,
+                                  resource.image));
+
+      VkImageViewCreateInfo viewInfo = vkinit::image_view_create_info(
+          resource.desc.format, resource.image, resource.aspect);
+      viewInfo.subresourceRange.levelCount = resource.desc.mipLevels;
+      VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &resource.view));
+    }
+  }
+}
+
+void RenderGraph::create_render_pass(
+    uint32_t orderIndex, const std::vector<std::vector<Use>>& uses) {
+  Pass& pass = _passes[_order[orderIndex]];
+
+  std::vector<VkAttachmentDescription> attachments;
+  std::vector<VkImageView> views;
+  pass.extent = {UINT32_MAX, UINT32_MAX};
+
+  auto add_attachment = [&](RGResource index, VkImageLayout layout) {
+    const Resource& resource = _resources[index];
+    const std::vector<Use>& list = uses[index];
+
+    // Where this pass is among the uses of the resource
+    size_t position = 0;
+    while (list[position].pass != orderIndex) position++;
+
+    const VkClearValue* clear = nullptr;
+    for (const auto& entry : pass.clears) {
+      if (entry.first == index) clear = &entry.second;
+    }
+
+    const bool hasContents = position > 0 || resource.preserve;
+    const bool usedLater =
+        position + 1 < list.size() || resource.output || resource.preserve;
+
+    VkAttachmentDescription attachment = {};
+    attachment.format = resource.desc.format;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = clear != nullptr ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                        : hasContents    ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                         : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.storeOp = usedLater ? VK_ATTACHMENT_STORE_OP_STORE
+                                   : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // The graph's barriers do the transitions, the pass keeps the layout
+    attachment.initialLayout = layout;
+    attachment.finalLayout = layout;
+
+    attachments.push_back(attachment);
+    views.push_back(resource.view);
+    pass.clearValues.push_back(clear != nullptr ? *clear : VkClearValue{});
+
+    pass.extent.width = std::min(pass.extent.width, resource.desc.extent.width);
+    pass.extent.height =
+        std::min(pass.extent.height, resource.desc.extent.height);
+  };
+
+  std::vector<VkAttachmentReference> colorRefs;
+  for (RGResource index : pass.colorAttachments) {
+    colorRefs.push_back({static_cast<uint32_t>(attachments.size()),
+                         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+    add_attachment(index, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  }
+
+  VkAttachmentReference depthRef = {};
+  if (pass.depthAttachment != RG_NO_RESOURCE) {
+    depthRef = {static_cast<uint32_t>(attachments.size()),
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    add_attachment(pass.depthAttachment,
+                   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+  }
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+  subpass.pColorAttachments = colorRefs.data();
+  subpass.pDepthStencilAttachment =
+      pass.depthAttachment != RG_NO_RESOURCE ? &depthRef : nullptr;
+
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+
+  VK_CHECK(vkCreateRenderPass(_engine->_device, &renderPassInfo, nullptr,
+                              &pass.renderPass));
+
+  VkFramebufferCreateInfo framebufferInfo = {};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.pNext = nullptr;
+  framebufferInfo.renderPass = pass.renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+  framebufferInfo.pAttachments = views.data();
+  framebufferInfo.width = pass.extent.width;
+  framebufferInfo.height = pass.extent.height;
+  framebufferInfo.layers = 1;
+
+  VK_CHECK(vkCreateFramebuffer(_engine->_device, &framebufferInfo, nullptr,
+                               &pass.framebuffer));
+}
+
+void RenderGraph::record_barriers(VkCommandBuffer cmd,
+                                  const std::vector<Barrier>& barriers) {
+  if (barriers.empty()) return;
+
+  _imageBarriers.clear();
+  _bufferBarriers.clear();
+
+  VkPipelineStageFlags srcStages = 0;
+  VkPipelineStageFlags dstStages = 0;
+
+  for (const Barrier& barrier : barriers) {
+    const Resource& resource = _resources[barrier.resource];
+    srcStages |= barrier.srcStages;
+    dstStages |= barrier.dstStages;
+
+    if (resource.isImage) {
+      VkImageMemoryBarrier imageBarrier = {};
+      imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      imageBarrier.pNext = nullptr;
+      imageBarrier.srcAccessMask = barrier.srcAccess;
+      imageBarrier.dstAccessMask = barrier.dstAccess;
+      imageBarrier.oldLayout =
+          barrier.currentLayout ? resource.layout : barrier.oldLayout;
+      imageBarrier.newLayout = barrier.newLayout;
+      imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      imageBarrier.image = resource.image;
+      imageBarrier.subresourceRange.aspectMask = resource.aspect;
+      imageBarrier.subresourceRange.baseMipLevel = 0;
+      imageBarrier.subresourceRange.levelCount = resource.desc.mipLevels;
+      imageBarrier.subresourceRange.baseArrayLayer = 0;
+      imageBarrier.subresourceRange.layerCount = 1;
+      _imageBarriers.push_back(imageBarrier);
+    } else {
+      VkBufferMemoryBarrier bufferBarrier = {};
+      bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      bufferBarrier.pNext = nullptr;
+      bufferBarrier.srcAccessMask = barrier.srcAccess;
+      bufferBarrier.dstAccessMask = barrier.dstAccess;
+      bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      bufferBarrier.buffer = resource.buffer;
+      bufferBarrier.offset = 0;
+      bufferBarrier.size = VK_WHOLE_SIZE;
+      _bufferBarriers.push_back(bufferBarrier);
+    }
+  }
+
+  vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr,
+                       static_cast<uint32_t>(_bufferBarriers.size()),
+                       _bufferBarriers.data(),
+                       static_cast<uint32_t>(_imageBarriers.size()),
+                       _imageBarriers.data());
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, VkExtent2D renderArea,
+                          Profiler* profiler) {
+  for (uint32_t index : _order) {
+    Pass& pass = _passes[index];
+
+    const uint32_t zone = profiler != nullptr
+                              ? profiler->begin_gpu_zone(cmd, pass.name)
+                              : UINT32_MAX;
+
+    record_barriers(cmd, pass.barriers);
+
+    if (pass.renderPass != VK_NULL_HANDLE) {
+      const VkExtent2D area = {std::min(renderArea.width, pass.extent.width),
+                               std::min(renderArea.height, pass.extent.height)};
+
+      VkRenderPassBeginInfo rpInfo = vkinit::render_pass_begin_info(
+          pass.renderPass, area, pass.framebuffer);
+      rpInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+      rpInfo.pClearValues = pass.clearValues.data();
+
+      vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    if (pass.function) pass.function(cmd);
+
+    if (pass.renderPass != VK_NULL_HANDLE) vkCmdEndRenderPass(cmd);
+
+    if (profiler != nullptr) profiler->end_gpu_zone(cmd, zone);
+  }
+
+  record_barriers(cmd, _finalBarriers);
+
+  for (Resource& resource : _resources) {
+    if (resource.isImage && resource.preserve &&
+        resource.firstPass != UINT32_MAX) {
+      resource.layout = end_layout(resource);
+    }
+  }
+}
+
+void RenderGraph::print() const {
+  size_t barrierCount = _finalBarriers.size();
+  for (uint32_t index : _order) barrierCount += _passes[index].barriers.size();
+
+  printf("Render graph: %zu passes (%zu culled), %zu barriers\n",
+         _order.size(), _passes.size() - _order.size(), barrierCount);
+
+  for (const Pass& pass : _passes) {
+    if (pass.culled) {
+      printf("  %-12s culled\n", pass.name);
+    } else {
+      printf("  %-12s %zu barriers\n", pass.name, pass.barriers.size());
+    }
+  }
+
+  if (_slots.empty()) return;
+
+  VkDeviceSize aliasedBytes = 0;
+  VkDeviceSize separateBytes = 0;
+  size_t imageCount = 0;
+  for (const MemorySlot& slot : _slots) {
+    aliasedBytes += slot.requirements.size;
+    imageCount += slot.resources.size();
+  }
+  for (const Resource& resource : _resources) {
+    if (resource.imported || resource.slot == UINT32_MAX) continue;
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_engine->_device, resource.image,
+                                 &requirements);
+    separateBytes += requirements.size;
+  }
+
+  printf("  %zu transient images in %zu allocations, %.2f MiB (%.2f MiB "
+         "without aliasing)\n",
+         imageCount, _slots.size(),
+         static_cast<double>(aliasedBytes) / (1024.0 * 1024.0),
+         static_cast<double>(separateBytes) / (1024.0 * 1024.0));
+}
@@ -27,7 +27,8 @@ bool vkutil::load_image_from_file(VulkanEngine& engine, const std::string file,
   VkFormat image_format = VK_FORMAT_R8G8B8A8_SRGB;
 
   AllocatedBuffer stagingBuffer = engine.create_buffer(
-      imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+      imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY,
+      MemoryCategory::Staging);
 
   void* data;
   vmaMapMemory(engine._allocator, stagingBuffer._allocation, &data);
@@ -53,6 +54,7 @@ bool vkutil::load_image_from_file(VulkanEngine& engine, const std::string file,
 
   vmaCreateImage(engine._allocator, &dimg_info, &dimg_allocinfo,
                  &newImage._image, &newImage._allocation, nullptr);
+  engine._memoryTracker.track(newImage._allocation, MemoryCategory::Texture);
 
   engine.immediate_submit([&](VkCommandBuffer cmd) {
     VkImageSubresourceRange range;
@@ -106,12 +108,9 @@ bool vkutil::load_image_from_file(VulkanEngine& engine, const std::string file,
                          0, nullptr, 1, &imageBarrier_toReadable);
   });
 
-  engine._mainDeletionQueue.push_function([=]() {
-    vmaDestroyImage(engine._allocator, newImage._image, newImage._allocation);
-  });
+  engine._mainDeletionQueue.push_image(newImage);
 
-  vmaDestroyBuffer(engine._allocator, stagingBuffer._buffer,
-                   stagingBuffer._allocation);
+  engine.destroy_buffer(stagingBuffer);
 
 #if defined(DEBUG)
   std::cout << "Texture loaded successfully " << file << std::endl;
@@ -0,0 +1,52 @@
+#include "vk_transientAllocator.h"
+
+#include <assert.h>
+#include <iostream>
+
+void TransientAllocator::init(VmaAllocator allocator, AllocatedBuffer buffer,
+                              size_t frameSize, size_t alignment) {
+  assert(buffer._mapped != nullptr);
+  // Alignments reported by Vulkan are always powers of two
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+  _allocator = allocator;
+  _buffer = buffer;
+  _alignment = alignment;
+  // Keep every frame region aligned so offsets stay valid dynamic offsets
+  _frameSize = aligned_frame_size(frameSize, alignment);
+  _frameBegin = 0;
+  _head = 0;
+}
+
+void TransientAllocator::begin_frame(uint32_t frameIndex) {
+  _frameBegin = _frameSize * frameIndex;
+  _head = _frameBegin;
+}
+
+void TransientAllocator::end_frame() {
+  if (_head == _frameBegin) return;
+
+  vmaFlushAllocation(_allocator, _buffer._allocation, _frameBegin,
+                     _head - _frameBegin);
+}
+
+TransientAllocation TransientAllocator::allocate(size_t size) {
+  const size_t alignedSize = (size + _alignment - 1) & ~(_alignment - 1);
+
+  if (_head + alignedSize > _frameBegin + _frameSize) {
+    std::cerr << "Transient allocator out of memory: requested " << size
+              << " bytes with " << (_frameBegin + _frameSize - _head)
+              << " bytes left in the frame" << std::endl;
+    abort();
+  }
+
+  TransientAllocation allocation;
+  allocation.data = static_cast<char*>(_buffer._mapped) + _head;
+  allocation.buffer = _buffer._buffer;
+  allocation.offset = static_cast<uint32_t>(_head);
+  allocation.size = size;
+
+  _head += alignedSize;
+
+  return allocation;
+}
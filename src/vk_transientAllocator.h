@@ -0,0 +1,67 @@
+#ifndef E4A27C51_3B9D_4F0E_9C66_2D8F1A7B5E30
+#define E4A27C51_3B9D_4F0E_9C66_2D8F1A7B5E30
+
+#include "vk_types.h"
+
+#include <cstring>
+
+// A sub-range of the transient ring. The offset is meant to be passed as a
+// dynamic offset when binding a descriptor that points at the ring buffer.
+struct TransientAllocation {
+  void* data{nullptr};
+  VkBuffer buffer{VK_NULL_HANDLE};
+  uint32_t offset{0};
+  size_t size{0};
+};
+
+// Linear bump allocator over one persistently mapped CPU_TO_GPU buffer. The
+// buffer is split into one region per frame in flight; every frame rewinds its
+// own region, so data written this frame stays valid until the frame's fence
+// has signaled.
+class TransientAllocator {
+ public:
+  // Frame regions are aligned_frame_size(frameSize, alignment) apart, the
+  // buffer has to hold one of them per frame in flight
+  void init(VmaAllocator allocator, AllocatedBuffer buffer, size_t frameSize,
+            size_t alignment);
+
+  // Size of one frame region, rounded up so every region starts aligned
+  static size_t aligned_frame_size(size_t frameSize, size_t alignment) {
+    return (frameSize + alignment - 1) & ~(alignment - 1);
+  }
+
+  // Rewinds the region owned by frameIndex. Only call this after the fence of
+  // that frame has been waited on.
+  void begin_frame(uint32_t frameIndex);
+
+  // Flushes the bytes written this frame in case the memory is not coherent.
+  void end_frame(void);
+
+  TransientAllocation allocate(size_t size);
+
+  template <typename T>
+  TransientAllocation push(const T& value) {
+    TransientAllocation allocation = allocate(sizeof(T));
+    memcpy(allocation.data, &value, sizeof(T));
+    return allocation;
+  }
+
+  VkBuffer buffer(void) const { return _buffer._buffer; }
+
+  // Bytes handed out since the last begin_frame
+  size_t used(void) const { return _head - _frameBegin; }
+
+  size_t frame_size(void) const { return _frameSize; }
+
+ private:
+  VmaAllocator _allocator{VK_NULL_HANDLE};
+  AllocatedBuffer _buffer{};
+
+  size_t _frameSize{0};
+  size_t _alignment{1};
+
+  size_t _frameBegin{0};
+  size_t _head{0};
+};
+
+#endif /* E4A27C51_3B9D_4F0E_9C66_2D8F1A7B5E30 */
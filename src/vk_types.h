@@ -4,9 +4,23 @@
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 
+#include <iostream>
+
+// Defined to imediately abort when there is an arror.
+#define VK_CHECK(x)                                               \
+  do {                                                            \
+    VkResult err = x;                                             \
+    if (err) {                                                    \
+      std::cout << "Detected Vulkan error: " << err << std::endl; \
+      abort();                                                    \
+    }                                                             \
+  } while (0);
+
 struct AllocatedBuffer {
   VkBuffer _buffer;
   VmaAllocation _allocation;
+  // Only set for buffers created with VMA_ALLOCATION_CREATE_MAPPED_BIT
+  void* _mapped{nullptr};
 };
 
 struct AllocatedImage {
@@ -0,0 +1,76 @@
+#include "chunkRemesher.h"
+
+void ChunkRemesher::init(const VoxelWorld& world, JobSystem* jobs,
+                         uint32_t queueCapacity) {
+  _world = &world;
+  _jobs = jobs;
+
+  // Nothing is ever in flight beyond the queue's capacity, so results always
+  // fit
+  _results.init(queueCapacity);
+}
+
+void ChunkRemesher::shutdown() {
+  if (_jobs) _jobs->wait(&_meshing);
+
+  std::unique_ptr<Result> result;
+  while (_results.try_pop(&result)) {
+  }
+  _versions.clear();
+  _inFlight = 0;
+}
+
+bool ChunkRemesher::submit(const ChunkCoord& coord) {
+  if (_inFlight >= _results.capacity()) return false;
+
+  std::unique_ptr<Request> request = std::make_unique<Request>();
+  request->remesher = this;
+  request->coord = coord;
+  request->version = ++_versions[coord];
+  request->submitted = std::chrono::steady_clock::now();
+
+  request->blocks.resize(PADDED_CHUNK_VOLUME);
+  if (!gather_chunk_blocks(*_world, coord, request->blocks.data())) {
+    request->blocks.clear();
+  }
+
+  // The job frees the request when it is done
+  Request* owned = request.release();
+  owned->job.function = mesh_chunk;
+  owned->job.context = owned;
+  _inFlight++;
+  _jobs->run(&owned->job, &_meshing);
+  return true;
+}
+
+bool ChunkRemesher::pop_result(ChunkMeshResult* out) {
+  std::unique_ptr<Result> result;
+  while (_results.try_pop(&result)) {
+    _inFlight--;
+
+    // A newer submit of the same chunk is still on its way
+    if (result->version != _versions[result->mesh.coord]) continue;
+
+    *out = std::move(result->mesh);
+    return true;
+  }
+  return false;
+}
+
+void ChunkRemesher::mesh_chunk(Job& job) {
+  std::unique_ptr<Request> request(static_cast<Request*>(job.context));
+  ChunkRemesher& remesher = *request->remesher;
+
+  std::unique_ptr<Result> result = std::make_unique<Result>();
+  result->version = request->version;
+  result->mesh.coord = request->coord;
+  result->mesh.submitted = request->submitted;
+  if (!request->blocks.empty()) {
+    result->mesh.stats = mesh_chunk_blocks(*remesher._world,
+                                           request->blocks.data(),
+                                           &result->mesh.vertices);
+  }
+
+  // Can't fail, see init
+  remesher._results.try_push(std::move(result));
+}
@@ -0,0 +1,75 @@
+#ifndef B9D4E2A6_1C58_4F73_8B0D_6E3A9C5F2D14
+#define B9D4E2A6_1C58_4F73_8B0D_6E3A9C5F2D14
+
+#include "greedyMesher.h"
+#include "Utility/jobSystem.h"
+#include "Utility/mpmcQueue.h"
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct ChunkMeshResult {
+  ChunkCoord coord;
+  // Empty when the chunk has no visible face anymore
+  std::vector<Vertex> vertices;
+  ChunkMeshStats stats;
+  std::chrono::steady_clock::time_point submitted;
+};
+
+// Meshes dirty chunks on the job system. submit copies the chunk and its
+// border out of the world on the editing thread and hands the copy to a job,
+// so the workers never touch the world's chunks while it is being edited.
+// Finished meshes come back through a lock-free queue.
+//
+// A chunk edited again before its mesh is back is simply submitted again,
+// only the mesh of its latest submit is returned.
+class ChunkRemesher {
+ public:
+  // The world's block types must stay unchanged until shutdown
+  void init(const VoxelWorld& world, JobSystem* jobs,
+            uint32_t queueCapacity = 1024);
+
+  // Waits for the meshes still being built and drops them
+  void shutdown(void);
+
+  // Returns false if too many meshes are in flight, submit again later
+  bool submit(const ChunkCoord& coord);
+
+  // Pops a finished mesh, false if none is ready
+  bool pop_result(ChunkMeshResult* out);
+
+  // Submitted chunks whose mesh hasn't been popped yet
+  uint32_t in_flight(void) const { return _inFlight; }
+
+ private:
+  struct Request {
+    Job job;
+    ChunkRemesher* remesher;
+    ChunkCoord coord;
+    uint32_t version;
+    std::chrono::steady_clock::time_point submitted;
+    // Empty for a chunk that was removed or has no blocks left
+    std::vector<BlockId> blocks;
+  };
+
+  struct Result {
+    uint32_t version;
+    ChunkMeshResult mesh;
+  };
+
+  static void mesh_chunk(Job& job);
+
+  const VoxelWorld* _world{nullptr};
+  JobSystem* _jobs{nullptr};
+
+  JobCounter _meshing;
+  MpmcQueue<std::unique_ptr<Result>> _results;
+
+  // Only touched by the submitting thread
+  std::unordered_map<ChunkCoord, uint32_t, ChunkCoordHash> _versions;
+  uint32_t _inFlight{0};
+};
+
+#endif /* B9D4E2A6_1C58_4F73_8B0D_6E3A9C5F2D14 */
@@ -0,0 +1,206 @@
+#include "greedyMesher.h"
+
+#include <algorithm>
+
+static int32_t padded_index(const glm::ivec3& position) {
+  return (position.x + 1) +
+         ((position.z + 1) + (position.y + 1) * PADDED_CHUNK_SIZE) *
+             PADDED_CHUNK_SIZE;
+}
+
+// Repeat coordinates of a quad corner that is a blocks along the quad's
+// first axis and b along its second, out of w and h. Side faces keep the
+// texture's up pointing at +y.
+static glm::vec2 tile_coord(uint32_t axis, float a, float b, float w,
+                            float h) {
+  switch (axis) {
+    case 0:  // first axis is y, second is z
+      return {b, w - a};
+    case 1:  // first axis is z, second is x
+      return {b, a};
+    default:  // first axis is x, second is y
+      return {a, h - b};
+  }
+}
+
+static void emit_quad(uint32_t face, const glm::ivec3& base, int32_t w,
+                      int32_t h, const BlockTile& tile,
+                      std::vector<Vertex>* outVertices) {
+  const uint32_t axis = face / 2;
+  const uint32_t u = (axis + 1) % 3;
+  const uint32_t v = (axis + 2) % 3;
+
+  glm::vec3 du(0.0f);
+  du[u] = static_cast<float>(w);
+  glm::vec3 dv(0.0f);
+  dv[v] = static_cast<float>(h);
+
+  const glm::vec3 origin(base);
+  const glm::vec3 normal(block_face_direction(face));
+  const glm::vec3 color(tile.origin, tile.size);
+
+  const float fw = static_cast<float>(w);
+  const float fh = static_cast<float>(h);
+
+  Vertex corners[4];
+  corners[0] = {origin, normal, color, tile_coord(axis, 0, 0, fw, fh)};
+  corners[1] = {origin + du, normal, color, tile_coord(axis, fw, 0, fw, fh)};
+  corners[2] = {origin + du + dv, normal, color,
+                tile_coord(axis, fw, fh, fw, fh)};
+  corners[3] = {origin + dv, normal, color, tile_coord(axis, 0, fh, fw, fh)};
+
+  // u cross v is the positive axis, flip the winding for negative faces so
+  // every quad is counter-clockwise seen from outside
+  static const uint32_t positiveOrder[6] = {0, 1, 2, 0, 2, 3};
+  static const uint32_t negativeOrder[6] = {0, 2, 1, 0, 3, 2};
+  const uint32_t* order = (face % 2 == 0) ? positiveOrder : negativeOrder;
+  for (uint32_t i = 0; i < 6; i++) {
+    outVertices->push_back(corners[order[i]]);
+  }
+}
+
+bool gather_chunk_blocks(const VoxelWorld& world, const ChunkCoord& coord,
+                         BlockId* outBlocks) {
+  const Chunk* chunk = world.find_chunk(coord);
+  if (!chunk || chunk->empty()) return false;
+
+  std::fill(outBlocks, outBlocks + PADDED_CHUNK_VOLUME, AIR_BLOCK);
+
+  for (int32_t y = 0; y < CHUNK_SIZE; y++) {
+    for (int32_t z = 0; z < CHUNK_SIZE; z++) {
+      BlockId* row = outBlocks + padded_index(glm::ivec3(0, y, z));
+      for (int32_t x = 0; x < CHUNK_SIZE; x++) {
+        row[x] = chunk->get(x, y, z);
+      }
+    }
+  }
+
+  // One lookup per neighbour, then its touching layer is copied
+  for (uint32_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+    const glm::ivec3 step = block_face_direction(face);
+    const Chunk* neighbour = world.find_chunk(
+        {coord.x + step.x, coord.y + step.y, coord.z + step.z});
+    if (!neighbour) continue;
+
+    const uint32_t axis = face / 2;
+    const uint32_t u = (axis + 1) % 3;
+    const uint32_t v = (axis + 2) % 3;
+    const bool positive = face % 2 == 0;
+
+    for (int32_t j = 0; j < CHUNK_SIZE; j++) {
+      for (int32_t i = 0; i < CHUNK_SIZE; i++) {
+        glm::ivec3 source;
+        source[axis] = positive ? 0 : CHUNK_SIZE - 1;
+        source[u] = i;
+        source[v] = j;
+
+        glm::ivec3 target = source;
+        target[axis] = positive ? CHUNK_SIZE : -1;
+
+        outBlocks[padded_index(target)] =
+            neighbour->get(source.x, source.y, source.z);
+      }
+    }
+  }
+
+  return true;
+}
+
+ChunkMeshStats mesh_chunk_blocks(const VoxelWorld& world,
+                                 const BlockId* blocks,
+                                 std::vector<Vertex>* outVertices) {
+  ChunkMeshStats stats;
+
+  std::vector<uint8_t> opaque(world.block_type_count());
+  std::vector<uint8_t> visible(world.block_type_count());
+  for (uint32_t i = 0; i < world.block_type_count(); i++) {
+    opaque[i] = world.block_type(static_cast<BlockId>(i)).opaque;
+    visible[i] = world.block_type(static_cast<BlockId>(i)).visible;
+  }
+
+  // Block type of every visible face in one layer, [j * CHUNK_SIZE + i]
+  // with i along the layer's first axis and j along its second
+  std::vector<BlockId> mask(CHUNK_SIZE * CHUNK_SIZE);
+
+  for (uint32_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+    const uint32_t axis = face / 2;
+    const uint32_t u = (axis + 1) % 3;
+    const uint32_t v = (axis + 2) % 3;
+    const glm::ivec3 step = block_face_direction(face);
+
+    for (int32_t layer = 0; layer < CHUNK_SIZE; layer++) {
+      for (int32_t j = 0; j < CHUNK_SIZE; j++) {
+        for (int32_t i = 0; i < CHUNK_SIZE; i++) {
+          glm::ivec3 position;
+          position[axis] = layer;
+          position[u] = i;
+          position[v] = j;
+
+          const BlockId block = blocks[padded_index(position)];
+          const BlockId neighbour = blocks[padded_index(position + step)];
+
+          // Air is neither visible nor opaque. Touching faces of the same
+          // see-through block, like water, are dropped as well.
+          const bool shown =
+              visible[block] && !opaque[neighbour] && neighbour != block;
+          mask[j * CHUNK_SIZE + i] = shown ? block : AIR_BLOCK;
+          stats.visibleFaces += shown;
+        }
+      }
+
+      for (int32_t j = 0; j < CHUNK_SIZE; j++) {
+        for (int32_t i = 0; i < CHUNK_SIZE;) {
+          const BlockId block = mask[j * CHUNK_SIZE + i];
+          if (block == AIR_BLOCK) {
+            i++;
+            continue;
+          }
+
+          // Widest run along the row, then as many rows as match it
+          int32_t w = 1;
+          while (i + w < CHUNK_SIZE && mask[j * CHUNK_SIZE + i + w] == block) {
+            w++;
+          }
+
+          int32_t h = 1;
+          for (; j + h < CHUNK_SIZE; h++) {
+            bool rowMatches = true;
+            for (int32_t k = 0; k < w; k++) {
+              if (mask[(j + h) * CHUNK_SIZE + i + k] != block) {
+                rowMatches = false;
+                break;
+              }
+            }
+            if (!rowMatches) break;
+          }
+
+          for (int32_t y = 0; y < h; y++) {
+            for (int32_t x = 0; x < w; x++) {
+              mask[(j + y) * CHUNK_SIZE + i + x] = AIR_BLOCK;
+            }
+          }
+
+          glm::ivec3 base;
+          base[axis] = layer + ((face % 2 == 0) ? 1 : 0);
+          base[u] = i;
+          base[v] = j;
+          emit_quad(face, base, w, h, world.block_type(block).tiles[face],
+                    outVertices);
+          stats.quads++;
+
+          i += w;
+        }
+      }
+    }
+  }
+
+  return stats;
+}
+
+ChunkMeshStats mesh_chunk(const VoxelWorld& world, const ChunkCoord& coord,
+                          std::vector<Vertex>* outVertices) {
+  std::vector<BlockId> blocks(PADDED_CHUNK_VOLUME);
+  if (!gather_chunk_blocks(world, coord, blocks.data())) return {};
+
+  return mesh_chunk_blocks(world, blocks.data(), outVertices);
+}
@@ -0,0 +1,47 @@
+#ifndef C6F1A8D3_9B24_4E5C_87A2_1D4E9B3F6C05
+#define C6F1A8D3_9B24_4E5C_87A2_1D4E9B3F6C05
+
+#include "vk_mesh.h"
+#include "voxelWorld.h"
+
+#include <cstdint>
+#include <vector>
+
+struct ChunkMeshStats {
+  // Block faces next to air or a see-through block, what hidden face removal
+  // alone draws
+  uint32_t visibleFaces{0};
+  // Quads left after merging neighbouring faces of the same block type
+  uint32_t quads{0};
+};
+
+// The blocks of a chunk plus a one block border from its six neighbours,
+// the border's edges and corners are never read and stay air
+constexpr int32_t PADDED_CHUNK_SIZE = CHUNK_SIZE + 2;
+constexpr int32_t PADDED_CHUNK_VOLUME =
+    PADDED_CHUNK_SIZE * PADDED_CHUNK_SIZE * PADDED_CHUNK_SIZE;
+
+// Copies a chunk and its border into outBlocks, PADDED_CHUNK_VOLUME entries.
+// Returns false without writing if the chunk is missing or empty.
+bool gather_chunk_blocks(const VoxelWorld& world, const ChunkCoord& coord,
+                         BlockId* outBlocks);
+
+// Builds the triangles of gathered blocks in chunk local coordinates, 0 to
+// CHUNK_SIZE on every axis, and appends them to outVertices. Faces hidden by
+// an opaque neighbour are skipped, also across chunk borders, and the
+// remaining faces of every layer are merged into the largest rectangles of
+// one block type. Only the block types are read from the world, so this can
+// run on any thread.
+//
+// A merged quad repeats its block's tile, so the vertices carry the tile
+// instead of a color: color.xy is the tile origin and color.z its size in the
+// atlas, uv counts blocks across the quad. voxel_lit.frag undoes this.
+ChunkMeshStats mesh_chunk_blocks(const VoxelWorld& world,
+                                 const BlockId* blocks,
+                                 std::vector<Vertex>* outVertices);
+
+// Gathers and meshes a chunk in one go
+ChunkMeshStats mesh_chunk(const VoxelWorld& world, const ChunkCoord& coord,
+                          std::vector<Vertex>* outVertices);
+
+#endif /* C6F1A8D3_9B24_4E5C_87A2_1D4E9B3F6C05 */
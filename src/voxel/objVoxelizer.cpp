@@ -0,0 +1,245 @@
+#include "objVoxelizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+#include <tiny_obj_loader.h>
+
+// Tolerance of the grid tests, exports round their coordinates
+constexpr float GRID_EPSILON = 1e-3f;
+
+// Resolution the grid offset is searched at
+constexpr int32_t GRID_OFFSET_STEPS = 16;
+
+struct BlockFaceRecord {
+  glm::ivec3 block;
+  uint32_t face;
+};
+
+static bool near_integer(float value) {
+  return std::abs(value - std::round(value)) < GRID_EPSILON;
+}
+
+// 21 bits per axis, enough for a million blocks in every direction
+static uint64_t cell_key(const glm::ivec3& position) {
+  const uint64_t mask = (1u << 21) - 1;
+  return (static_cast<uint64_t>(position.x + (1 << 20)) & mask) |
+         ((static_cast<uint64_t>(position.y + (1 << 20)) & mask) << 21) |
+         ((static_cast<uint64_t>(position.z + (1 << 20)) & mask) << 42);
+}
+
+// Block corners all share the same fraction on an axis, pick the most common
+static glm::vec3 find_grid_offset(const std::vector<float>& positions) {
+  uint32_t histogram[3][GRID_OFFSET_STEPS] = {};
+  for (size_t i = 0; i < positions.size(); i++) {
+    const float fraction = positions[i] - std::floor(positions[i]);
+    const int32_t step =
+        static_cast<int32_t>(std::lround(fraction * GRID_OFFSET_STEPS)) %
+        GRID_OFFSET_STEPS;
+    histogram[i % 3][step]++;
+  }
+
+  glm::vec3 offset(0.0f);
+  for (int32_t axis = 0; axis < 3; axis++) {
+    const uint32_t* counts = histogram[axis];
+    const int32_t best = static_cast<int32_t>(
+        std::max_element(counts, counts + GRID_OFFSET_STEPS) - counts);
+    offset[axis] = static_cast<float>(best) / GRID_OFFSET_STEPS;
+  }
+  return offset;
+}
+
+bool voxelize_obj(const std::string& filename, VoxelWorld* world,
+                  glm::vec3* outGridOffset, ObjVoxelStats* outStats) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+
+  std::string warn;
+  std::string err;
+
+  tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename.c_str(),
+                   nullptr);
+
+  if (!warn.empty()) {
+    std::cout << "WARN: " << warn << std::endl;
+  }
+
+  if (!err.empty()) {
+    std::cerr << err << std::endl;
+    return false;
+  }
+
+  ObjVoxelStats stats;
+  world->clear();
+
+  const glm::vec3 gridOffset = find_grid_offset(attrib.vertices);
+
+  // Material i becomes block type i + 1
+  for (const tinyobj::material_t& material : materials) {
+    BlockType type;
+    type.name = material.name;
+    world->add_block_type(type);
+  }
+
+  std::vector<uint8_t> hasTile(world->block_type_count() * BLOCK_FACE_COUNT);
+  std::vector<BlockFaceRecord> faces;
+  std::vector<glm::ivec3> placed;
+
+  for (const tinyobj::shape_t& shape : shapes) {
+    size_t indexOffset = 0;
+    for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+      const size_t faceVertices = shape.mesh.num_face_vertices[f];
+      const tinyobj::index_t* indices = &shape.mesh.indices[indexOffset];
+      indexOffset += faceVertices;
+
+      stats.triangles++;
+
+      const int materialId = shape.mesh.material_ids[f];
+      if (faceVertices != 3 || materialId < 0) {
+        stats.skippedTriangles++;
+        continue;
+      }
+
+      glm::vec3 p[3];
+      for (uint32_t v = 0; v < 3; v++) {
+        const int index = indices[v].vertex_index;
+        p[v] = glm::vec3(attrib.vertices[3 * index + 0],
+                         attrib.vertices[3 * index + 1],
+                         attrib.vertices[3 * index + 2]) -
+               gridOffset;
+      }
+
+      glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+      const float area = glm::length(normal);
+      if (area < GRID_EPSILON) {
+        stats.skippedTriangles++;
+        continue;
+      }
+      normal /= area;
+
+      // The stored normal wins over the winding
+      if (indices[0].normal_index >= 0) {
+        const int index = indices[0].normal_index;
+        const glm::vec3 stored(attrib.normals[3 * index + 0],
+                               attrib.normals[3 * index + 1],
+                               attrib.normals[3 * index + 2]);
+        if (glm::dot(stored, normal) < 0.0f) normal = -normal;
+      }
+
+      const glm::vec3 absNormal = glm::abs(normal);
+      const uint32_t axis =
+          (absNormal.x > absNormal.y && absNormal.x > absNormal.z)
+              ? 0
+              : (absNormal.y > absNormal.z ? 1 : 2);
+      const uint32_t u = (axis + 1) % 3;
+      const uint32_t v = (axis + 2) % 3;
+
+      // Half of a full block face: flat, one block wide and tall, and with
+      // its corners on the grid
+      const glm::vec3 lo = glm::min(glm::min(p[0], p[1]), p[2]);
+      const glm::vec3 hi = glm::max(glm::max(p[0], p[1]), p[2]);
+      const bool onGrid = absNormal[axis] > 1.0f - GRID_EPSILON &&
+                          std::abs(hi[u] - lo[u] - 1.0f) < GRID_EPSILON &&
+                          std::abs(hi[v] - lo[v] - 1.0f) < GRID_EPSILON &&
+                          near_integer(lo[axis]) && near_integer(lo[u]) &&
+                          near_integer(lo[v]);
+      if (!onGrid) {
+        stats.skippedTriangles++;
+        continue;
+      }
+
+      const bool positive = normal[axis] > 0.0f;
+      const uint32_t face = axis * 2 + (positive ? 0 : 1);
+
+      glm::ivec3 block;
+      block[u] = static_cast<int32_t>(std::lround(lo[u]));
+      block[v] = static_cast<int32_t>(std::lround(lo[v]));
+      block[axis] = static_cast<int32_t>(std::lround(lo[axis])) -
+                    (positive ? 1 : 0);
+
+      const BlockId id = static_cast<BlockId>(materialId + 1);
+      if (world->get_block(block) == AIR_BLOCK) {
+        world->set_block(block, id);
+        placed.push_back(block);
+      }
+      faces.push_back({block, face});
+      stats.blockTriangles++;
+
+      const size_t tileSlot = id * BLOCK_FACE_COUNT + face;
+      if (!hasTile[tileSlot] && indices[0].texcoord_index >= 0 &&
+          indices[1].texcoord_index >= 0 && indices[2].texcoord_index >= 0) {
+        glm::vec2 uvLo(1.0f);
+        glm::vec2 uvHi(0.0f);
+        for (uint32_t c = 0; c < 3; c++) {
+          const int index = indices[c].texcoord_index;
+          const glm::vec2 uv(attrib.texcoords[2 * index + 0],
+                             attrib.texcoords[2 * index + 1]);
+          uvLo = glm::min(uvLo, uv);
+          uvHi = glm::max(uvHi, uv);
+        }
+
+        // Same flip as Mesh::load_from_obj
+        BlockTile& tile = world->block_type(id).tiles[face];
+        tile.origin = glm::vec2(uvLo.x, 1.0f - uvHi.y);
+        tile.size = uvHi.x - uvLo.x;
+        hasTile[tileSlot] = 1;
+      }
+    }
+  }
+
+  // Faces that were never exported borrow a tile of the same block
+  for (uint32_t id = 1; id < world->block_type_count(); id++) {
+    BlockType& type = world->block_type(static_cast<BlockId>(id));
+    for (uint32_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+      if (!hasTile[id * BLOCK_FACE_COUNT + face]) continue;
+      for (uint32_t other = 0; other < BLOCK_FACE_COUNT; other++) {
+        if (!hasTile[id * BLOCK_FACE_COUNT + other]) {
+          type.tiles[other] = type.tiles[face];
+          hasTile[id * BLOCK_FACE_COUNT + other] = 1;
+        }
+      }
+      break;
+    }
+  }
+
+  // A face exported against a block means that block is see-through, glass
+  // or leaves. The cells in front of all other faces are air.
+  std::unordered_set<uint64_t> knownAir;
+  for (const BlockFaceRecord& record : faces) {
+    const glm::ivec3 front = record.block + block_face_direction(record.face);
+    const BlockId neighbour = world->get_block(front);
+    if (neighbour != AIR_BLOCK) {
+      world->block_type(neighbour).opaque = false;
+    } else {
+      knownAir.insert(cell_key(front));
+    }
+  }
+
+  BlockType hidden;
+  hidden.name = "Hidden";
+  hidden.visible = false;
+  const BlockId hiddenId = world->add_block_type(hidden);
+
+  // The export dropped the faces towards these cells, so something filled
+  // them, maybe a block we skipped
+  for (const glm::ivec3& block : placed) {
+    for (uint32_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+      const glm::ivec3 cell = block + block_face_direction(face);
+      if (world->get_block(cell) == AIR_BLOCK &&
+          knownAir.count(cell_key(cell)) == 0) {
+        world->set_block(cell, hiddenId);
+        stats.occluders++;
+      }
+    }
+  }
+
+  stats.blocks = static_cast<uint32_t>(placed.size());
+
+  *outGridOffset = gridOffset;
+  *outStats = stats;
+  return true;
+}
@@ -0,0 +1,35 @@
+#ifndef F5C3A7E1_8D46_4B92_9E3F_2A6D1C8B4F70
+#define F5C3A7E1_8D46_4B92_9E3F_2A6D1C8B4F70
+
+#include "voxelWorld.h"
+
+#include <cstdint>
+#include <string>
+
+#include <glm/glm.hpp>
+
+struct ObjVoxelStats {
+  uint32_t triangles{0};
+  // Triangles that are half of a unit block face and were turned into blocks
+  uint32_t blockTriangles{0};
+  // Slabs, plants, torches and anything else off the block grid
+  uint32_t skippedTriangles{0};
+  uint32_t blocks{0};
+  // Invisible blocks standing in for cells the export hid faces against
+  uint32_t occluders{0};
+};
+
+// Rebuilds the blocks of a Minecraft map exported to OBJ, like lost_empire.
+// Every material becomes a block type, every axis aligned unit square on the
+// block grid marks the block behind it, and the uv rectangle of the square
+// becomes the tile of that face. The export only contains faces next to air,
+// so cells that hid a face are filled with an invisible opaque block and
+// blocks that other faces were exported against are marked see-through.
+// That way meshing the world hides the same faces the export did.
+//
+// Returns false if the file can't be read. outGridOffset is where block
+// (0, 0, 0) starts in the OBJ's space.
+bool voxelize_obj(const std::string& filename, VoxelWorld* world,
+                  glm::vec3* outGridOffset, ObjVoxelStats* outStats);
+
+#endif /* F5C3A7E1_8D46_4B92_9E3F_2A6D1C8B4F70 */
@@ -0,0 +1,117 @@
+#include "voxelChunk.h"
+
+// Words needed to store every block's index with the given width
+static size_t word_count(uint32_t bits) {
+  return (static_cast<size_t>(CHUNK_VOLUME) * bits + 63) / 64;
+}
+
+Chunk::Chunk() {
+  // A new chunk is one palette entry of air and needs no indices
+  _palette.push_back(AIR_BLOCK);
+  _paletteCounts.push_back(CHUNK_VOLUME);
+}
+
+void Chunk::set(int32_t x, int32_t y, int32_t z, BlockId block) {
+  const int32_t slot = index(x, y, z);
+  const uint32_t oldIndex = read_index(slot);
+  const BlockId old = _palette[oldIndex];
+  if (old == block) return;
+
+  // Freeing the old entry first lets the new block reuse it
+  if (--_paletteCounts[oldIndex] == 0) _usedEntries--;
+
+  const uint32_t newIndex = find_or_add(block);
+  if (_paletteCounts[newIndex]++ == 0) _usedEntries++;
+  write_index(slot, newIndex);
+
+  _solidCount += (block != AIR_BLOCK) - (old != AIR_BLOCK);
+
+  // Narrowing only once the used entries fill half of the narrower width
+  // keeps a chunk that hovers around a boundary from repacking every edit.
+  // A chunk down to one block type always drops its indices.
+  if (_bits > 0 && (_usedEntries == 1 ||
+                    _usedEntries <= (1u << (_bits / 2)) / 2)) {
+    compact();
+  }
+}
+
+size_t Chunk::memory_usage() const {
+  return sizeof(Chunk) + _palette.capacity() * sizeof(BlockId) +
+         _paletteCounts.capacity() * sizeof(uint32_t) +
+         _words.capacity() * sizeof(uint64_t);
+}
+
+void Chunk::write_index(int32_t block, uint32_t paletteIndex) {
+  if (_bits == 0) return;
+  const uint32_t bit = static_cast<uint32_t>(block) * _bits;
+  const uint64_t mask = ((uint64_t(1) << _bits) - 1) << (bit % 64);
+  uint64_t& word = _words[bit / 64];
+  word = (word & ~mask) | (static_cast<uint64_t>(paletteIndex) << (bit % 64));
+}
+
+uint32_t Chunk::find_or_add(BlockId block) {
+  uint32_t unused = UINT32_MAX;
+  for (uint32_t i = 0; i < _palette.size(); i++) {
+    if (_paletteCounts[i] == 0) {
+      if (unused == UINT32_MAX) unused = i;
+    } else if (_palette[i] == block) {
+      return i;
+    }
+  }
+
+  if (unused != UINT32_MAX) {
+    _palette[unused] = block;
+    return unused;
+  }
+
+  const uint32_t entry = static_cast<uint32_t>(_palette.size());
+  _palette.push_back(block);
+  _paletteCounts.push_back(0);
+
+  if (_palette.size() > (size_t(1) << _bits)) {
+    repack(_bits == 0 ? 1 : _bits * 2);
+  }
+  return entry;
+}
+
+void Chunk::compact() {
+  std::vector<uint32_t> remap(_palette.size(), 0);
+  std::vector<BlockId> palette;
+  std::vector<uint32_t> counts;
+  for (uint32_t i = 0; i < _palette.size(); i++) {
+    if (_paletteCounts[i] == 0) continue;
+    remap[i] = static_cast<uint32_t>(palette.size());
+    palette.push_back(_palette[i]);
+    counts.push_back(_paletteCounts[i]);
+  }
+
+  uint32_t bits = 0;
+  while ((size_t(1) << bits) < palette.size()) bits = bits == 0 ? 1 : bits * 2;
+
+  std::vector<uint64_t> words(word_count(bits), 0);
+  if (bits > 0) {
+    for (int32_t block = 0; block < CHUNK_VOLUME; block++) {
+      const uint64_t value = remap[read_index(block)];
+      const uint32_t bit = static_cast<uint32_t>(block) * bits;
+      words[bit / 64] |= value << (bit % 64);
+    }
+  }
+
+  _palette.swap(palette);
+  _paletteCounts.swap(counts);
+  _words.swap(words);
+  _words.shrink_to_fit();
+  _bits = bits;
+}
+
+void Chunk::repack(uint32_t bits) {
+  std::vector<uint64_t> words(word_count(bits), 0);
+  for (int32_t block = 0; block < CHUNK_VOLUME; block++) {
+    const uint64_t value = read_index(block);
+    const uint32_t bit = static_cast<uint32_t>(block) * bits;
+    words[bit / 64] |= value << (bit % 64);
+  }
+
+  _words.swap(words);
+  _bits = bits;
+}
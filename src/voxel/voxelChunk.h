@@ -0,0 +1,106 @@
+#ifndef E2B7C4A9_6F13_4D58_A1E0_3C9F5B2D8E71
+#define E2B7C4A9_6F13_4D58_A1E0_3C9F5B2D8E71
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Edge length of a chunk in blocks
+constexpr int32_t CHUNK_SIZE = 32;
+constexpr int32_t CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+
+// Index into the block type registry of the world, 0 is always air
+using BlockId = uint16_t;
+
+constexpr BlockId AIR_BLOCK = 0;
+
+// Position of a chunk in chunk units, block x lives in chunk floor(x / 32)
+struct ChunkCoord {
+  int32_t x, y, z;
+
+  bool operator==(const ChunkCoord& other) const {
+    return x == other.x && y == other.y && z == other.z;
+  }
+};
+
+struct ChunkCoordHash {
+  size_t operator()(const ChunkCoord& coord) const {
+    // Large odd multipliers spread neighbouring chunks over the buckets
+    return static_cast<size_t>(static_cast<uint32_t>(coord.x) * 73856093u ^
+                               static_cast<uint32_t>(coord.y) * 19349663u ^
+                               static_cast<uint32_t>(coord.z) * 83492791u);
+  }
+};
+
+// Block storage of one chunk. Every block is an index into a palette of the
+// block ids the chunk uses, packed into 64 bit words with 0, 1, 2, 4, 8 or 16
+// bits per block so no index straddles two words. A chunk of a single block
+// type stores no indices at all and a typical one needs 2 or 4 bits per
+// block instead of 16.
+//
+// x varies fastest, then z, then y, so a horizontal layer is contiguous.
+class Chunk {
+ public:
+  Chunk();
+
+  BlockId get(int32_t x, int32_t y, int32_t z) const {
+    return _palette[read_index(index(x, y, z))];
+  }
+
+  void set(int32_t x, int32_t y, int32_t z, BlockId block);
+
+  // Chunks without any solid block produce no mesh
+  bool empty(void) const { return _solidCount == 0; }
+
+  uint32_t solid_count(void) const { return _solidCount; }
+
+  // Palette entries, including ones no block uses anymore. Unused entries
+  // are dropped once the rest fit a narrower index width with room to spare.
+  uint32_t palette_size(void) const {
+    return static_cast<uint32_t>(_palette.size());
+  }
+
+  uint32_t bits_per_block(void) const { return _bits; }
+
+  // Bytes of the chunk including its palette and packed indices
+  size_t memory_usage(void) const;
+
+  // Set when a block changes, the world hands dirty chunks to the mesher
+  bool dirty(void) const { return _dirty; }
+  void set_dirty(bool dirty) { _dirty = dirty; }
+
+  static int32_t index(int32_t x, int32_t y, int32_t z) {
+    return x + (z + y * CHUNK_SIZE) * CHUNK_SIZE;
+  }
+
+ private:
+  uint32_t read_index(int32_t block) const {
+    if (_bits == 0) return 0;
+    const uint32_t bit = static_cast<uint32_t>(block) * _bits;
+    return static_cast<uint32_t>(_words[bit / 64] >> (bit % 64)) &
+           ((1u << _bits) - 1);
+  }
+
+  void write_index(int32_t block, uint32_t paletteIndex);
+
+  // Returns the palette entry of the block, adding it if needed
+  uint32_t find_or_add(BlockId block);
+
+  // Repacks every index with the given number of bits
+  void repack(uint32_t bits);
+
+  // Drops unused palette entries and narrows the indices to fit the rest
+  void compact(void);
+
+  std::vector<BlockId> _palette;
+  // Blocks using each palette entry, entries at 0 are reused first
+  std::vector<uint32_t> _paletteCounts;
+  std::vector<uint64_t> _words;
+  uint32_t _bits{0};
+  uint32_t _usedEntries{1};
+
+  uint32_t _solidCount{0};
+  bool _dirty{false};
+};
+
+#endif /* E2B7C4A9_6F13_4D58_A1E0_3C9F5B2D8E71 */
@@ -0,0 +1,54 @@
+#include "voxelEditStress.h"
+
+#include <algorithm>
+#include <tuple>
+
+void VoxelEditStress::init(const VoxelWorld& world, float editsPerSecond,
+                           uint32_t seed) {
+  _chunks.clear();
+  for (const auto& [coord, chunk] : world.chunks()) {
+    _chunks.push_back(coord);
+  }
+
+  // The map's iteration order is not part of the seed
+  std::sort(_chunks.begin(), _chunks.end(),
+            [](const ChunkCoord& a, const ChunkCoord& b) {
+              return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+            });
+
+  _blockTypes.clear();
+  for (uint32_t id = 1; id < world.block_type_count(); id++) {
+    if (world.block_type(static_cast<BlockId>(id)).visible) {
+      _blockTypes.push_back(static_cast<BlockId>(id));
+    }
+  }
+
+  _rng.seed(seed);
+  _editsPerSecond = editsPerSecond;
+  _pending = 0.0;
+}
+
+uint32_t VoxelEditStress::update(VoxelWorld* world, double deltaTime) {
+  if (_chunks.empty() || _blockTypes.empty()) return 0;
+
+  _pending += deltaTime * _editsPerSecond;
+  const uint32_t edits = static_cast<uint32_t>(_pending);
+  _pending -= edits;
+
+  for (uint32_t i = 0; i < edits; i++) {
+    // One draw per statement, argument order is unspecified
+    const ChunkCoord& coord = _chunks[_rng() % _chunks.size()];
+    glm::ivec3 position = VoxelWorld::chunk_origin(coord);
+    position.x += static_cast<int32_t>(_rng() % CHUNK_SIZE);
+    position.y += static_cast<int32_t>(_rng() % CHUNK_SIZE);
+    position.z += static_cast<int32_t>(_rng() % CHUNK_SIZE);
+
+    if (world->get_block(position) == AIR_BLOCK) {
+      world->set_block(position, _blockTypes[_rng() % _blockTypes.size()]);
+    } else {
+      world->set_block(position, AIR_BLOCK);
+    }
+  }
+
+  return edits;
+}
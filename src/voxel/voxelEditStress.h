@@ -0,0 +1,32 @@
+#ifndef D1A6F3C8_4E27_4B95_A2D7_5C8E1B4F9A36
+#define D1A6F3C8_4E27_4B95_A2D7_5C8E1B4F9A36
+
+#include "voxelWorld.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Toggles random blocks at a fixed rate to measure incremental remeshing. An
+// edit places a random visible block type into air or clears a solid block.
+// The edits only depend on the seed and the elapsed time, so benchmark runs
+// with a fixed timestep repeat them exactly.
+class VoxelEditStress {
+ public:
+  // Edits stay inside the chunks the world has at this point
+  void init(const VoxelWorld& world, float editsPerSecond, uint32_t seed);
+
+  // Makes the edits due over deltaTime, returns how many were made
+  uint32_t update(VoxelWorld* world, double deltaTime);
+
+ private:
+  std::vector<ChunkCoord> _chunks;
+  std::vector<BlockId> _blockTypes;
+  std::mt19937 _rng;
+
+  float _editsPerSecond{0.0f};
+  // Fraction of an edit carried over to the next update
+  double _pending{0.0};
+};
+
+#endif /* D1A6F3C8_4E27_4B95_A2D7_5C8E1B4F9A36 */
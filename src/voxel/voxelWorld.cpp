@@ -0,0 +1,109 @@
+#include "voxelWorld.h"
+
+// Rounds towards negative infinity, so block -1 lands in chunk -1
+static int32_t floor_div(int32_t value, int32_t divisor) {
+  return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+VoxelWorld::VoxelWorld() {
+  BlockType air;
+  air.name = "Air";
+  air.opaque = false;
+  air.visible = false;
+  _blockTypes.push_back(air);
+}
+
+BlockId VoxelWorld::add_block_type(const BlockType& type) {
+  _blockTypes.push_back(type);
+  return static_cast<BlockId>(_blockTypes.size() - 1);
+}
+
+BlockId VoxelWorld::get_block(const glm::ivec3& position) const {
+  const ChunkCoord coord = chunk_of(position);
+  const Chunk* chunk = find_chunk(coord);
+  if (!chunk) return AIR_BLOCK;
+
+  const glm::ivec3 local = position - chunk_origin(coord);
+  return chunk->get(local.x, local.y, local.z);
+}
+
+void VoxelWorld::set_block(const glm::ivec3& position, BlockId block) {
+  const ChunkCoord coord = chunk_of(position);
+
+  auto it = _chunks.find(coord);
+  if (it == _chunks.end()) {
+    // Clearing a block of a missing chunk changes nothing
+    if (block == AIR_BLOCK) return;
+    it = _chunks.emplace(coord, Chunk{}).first;
+  }
+
+  Chunk& chunk = it->second;
+  const glm::ivec3 local = position - chunk_origin(coord);
+  if (chunk.get(local.x, local.y, local.z) == block) return;
+
+  chunk.set(local.x, local.y, local.z, block);
+  mark_dirty(coord, chunk);
+
+  // Missing neighbours are all air and have no faces to update
+  for (uint32_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+    const uint32_t axis = face / 2;
+    const bool positive = face % 2 == 0;
+    if (local[axis] != (positive ? CHUNK_SIZE - 1 : 0)) continue;
+
+    const glm::ivec3 step = block_face_direction(face);
+    const ChunkCoord neighbourCoord = {coord.x + step.x, coord.y + step.y,
+                                       coord.z + step.z};
+    auto neighbour = _chunks.find(neighbourCoord);
+    if (neighbour != _chunks.end()) {
+      mark_dirty(neighbourCoord, neighbour->second);
+    }
+  }
+}
+
+const Chunk* VoxelWorld::find_chunk(const ChunkCoord& coord) const {
+  auto it = _chunks.find(coord);
+  return (it != _chunks.end()) ? &it->second : nullptr;
+}
+
+size_t VoxelWorld::block_count() const {
+  size_t count = 0;
+  for (const auto& [coord, chunk] : _chunks) {
+    count += chunk.solid_count();
+  }
+  return count;
+}
+
+size_t VoxelWorld::memory_usage() const {
+  size_t bytes = _chunks.bucket_count() * sizeof(void*);
+  for (const auto& [coord, chunk] : _chunks) {
+    // Key and next pointer of the map node
+    bytes += chunk.memory_usage() + sizeof(ChunkCoord) + sizeof(void*);
+  }
+  return bytes;
+}
+
+void VoxelWorld::take_dirty_chunks(std::vector<ChunkCoord>* outCoords) {
+  for (const ChunkCoord& coord : _dirtyChunks) {
+    auto it = _chunks.find(coord);
+    if (it != _chunks.end()) it->second.set_dirty(false);
+    outCoords->push_back(coord);
+  }
+  _dirtyChunks.clear();
+}
+
+void VoxelWorld::mark_dirty(const ChunkCoord& coord, Chunk& chunk) {
+  if (chunk.dirty()) return;
+  chunk.set_dirty(true);
+  _dirtyChunks.push_back(coord);
+}
+
+void VoxelWorld::clear() {
+  _chunks.clear();
+  _dirtyChunks.clear();
+  _blockTypes.resize(1);
+}
+
+ChunkCoord VoxelWorld::chunk_of(const glm::ivec3& position) {
+  return {floor_div(position.x, CHUNK_SIZE), floor_div(position.y, CHUNK_SIZE),
+          floor_div(position.z, CHUNK_SIZE)};
+}
@@ -0,0 +1,95 @@
+#ifndef A4D9F1B6_3C82_4E7A_B5D0_8E2C6F4A1B93
+#define A4D9F1B6_3C82_4E7A_B5D0_8E2C6F4A1B93
+
+#include "voxelChunk.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Faces of a block, in the order +x, -x, +y, -y, +z, -z. Face f points along
+// axis f / 2, towards positive when f is even.
+constexpr uint32_t BLOCK_FACE_COUNT = 6;
+
+inline glm::ivec3 block_face_direction(uint32_t face) {
+  glm::ivec3 direction(0);
+  direction[face / 2] = (face % 2 == 0) ? 1 : -1;
+  return direction;
+}
+
+// Square region of the texture atlas a block face samples, in uv units
+struct BlockTile {
+  glm::vec2 origin{0.0f};
+  float size{0.0f};
+};
+
+struct BlockType {
+  std::string name;
+  BlockTile tiles[BLOCK_FACE_COUNT];
+  // Faces of other blocks are hidden behind opaque blocks only
+  bool opaque{true};
+  // Invisible blocks hide their neighbours' faces but are never meshed
+  bool visible{true};
+};
+
+// Sparse grid of chunks in block units. Chunks are created on the first
+// write to them, reads of missing chunks return air.
+//
+// Edits mark the chunk dirty, and the neighbouring chunk too when the block
+// is on the border, since its faces against the block change as well. The
+// world itself is not thread safe, meshing threads work on copies of the
+// blocks but read the block types, which must not change once meshing runs.
+class VoxelWorld {
+ public:
+  VoxelWorld();
+
+  // Ids are handed out in order, starting after air
+  BlockId add_block_type(const BlockType& type);
+
+  const BlockType& block_type(BlockId id) const { return _blockTypes[id]; }
+  BlockType& block_type(BlockId id) { return _blockTypes[id]; }
+
+  uint32_t block_type_count(void) const {
+    return static_cast<uint32_t>(_blockTypes.size());
+  }
+
+  BlockId get_block(const glm::ivec3& position) const;
+  void set_block(const glm::ivec3& position, BlockId block);
+
+  const Chunk* find_chunk(const ChunkCoord& coord) const;
+
+  const std::unordered_map<ChunkCoord, Chunk, ChunkCoordHash>& chunks(
+      void) const {
+    return _chunks;
+  }
+
+  // Solid blocks over all chunks
+  size_t block_count(void) const;
+
+  // Bytes of all chunks and the chunk table
+  size_t memory_usage(void) const;
+
+  // Moves the chunks edited since the last call to outCoords and clears
+  // their dirty flag
+  void take_dirty_chunks(std::vector<ChunkCoord>* outCoords);
+
+  void clear(void);
+
+  static ChunkCoord chunk_of(const glm::ivec3& position);
+
+  // Block position of the chunk's minimum corner
+  static glm::ivec3 chunk_origin(const ChunkCoord& coord) {
+    return glm::ivec3(coord.x, coord.y, coord.z) * CHUNK_SIZE;
+  }
+
+ private:
+  void mark_dirty(const ChunkCoord& coord, Chunk& chunk);
+
+  std::vector<BlockType> _blockTypes;
+  std::unordered_map<ChunkCoord, Chunk, ChunkCoordHash> _chunks;
+  std::vector<ChunkCoord> _dirtyChunks;
+};
+
+#endif /* A4D9F1B6_3C82_4E7A_B5D0_8E2C6F4A1B93 */